@@ -28,8 +28,13 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <memory>
 
-#include <libKitsunemimiCommon/statemachine.h>
 #include <libKitsunemimiCommon/buffer/data_buffer.h>
 #include <libKitsunemimiCommon/buffer/stack_buffer.h>
 
@@ -45,12 +50,24 @@ class SessionHandler;
 class SessionController;
 class InternalSessionInterface;
 class MultiblockIO;
+class StripeSender;
 
 class Session
 {
 public:
     ~Session(); 
 
+    // delivery-assurance of single-block-messages (standalone, request and response). With a
+    // transport-reply the other side confirms each message, which is not necessary, if the
+    // application-protocol already confirms the delivery.
+    enum deliveryAssurances
+    {
+        SESSION_DEFAULT = 0,
+        TRANSPORT_REPLY = 1,
+        NO_TRANSPORT_REPLY = 2,
+    };
+    bool setDeliveryAssurance(const deliveryAssurances assurance);
+
     // send-messages
     bool sendStreamData(StackBuffer &stackBuffer,
                         const bool replyExpected = false);
@@ -60,15 +77,59 @@ public:
                         const bool replyExpected = false);
 
     uint64_t sendStandaloneData(const void* data,
-                                const uint64_t size);
+                                const uint64_t size,
+                                const deliveryAssurances assurance = SESSION_DEFAULT);
     void abortMessages(const uint64_t multiblockMessageId=0);
 
     DataBuffer* sendRequest(const void* data,
                             const uint64_t size,
-                            const uint64_t timeout);
+                            const uint64_t timeout = 0,
+                            const deliveryAssurances assurance = SESSION_DEFAULT);
+    DataBuffer* sendRpcRequest(const uint32_t methodId,
+                               const void* data,
+                               const uint64_t size,
+                               const uint64_t timeout = 0,
+                               const deliveryAssurances assurance = SESSION_DEFAULT);
+
+    // batch of independent requests, which are send together
+    enum requestStates
+    {
+        REQUEST_NOT_SEND = 0,
+        REQUEST_SUCCESSFUL = 1,
+        REQUEST_TIMEOUT = 2,
+        REQUEST_REJECTED = 3,
+    };
+    struct RequestItem
+    {
+        const void* data = nullptr;
+        uint64_t size = 0;
+        // id of the remote procedure or 0 for the standalone-callback
+        uint32_t methodId = 0;
+        DataBuffer* response = nullptr;
+        requestStates state = REQUEST_NOT_SEND;
+    };
+    uint64_t sendRequests(std::vector<RequestItem> &batch,
+                          const uint64_t timeout = 0,
+                          const deliveryAssurances assurance = SESSION_DEFAULT);
+
     uint64_t sendResponse(const void* data,
                           const uint64_t size,
-                          const uint64_t blockerId);
+                          const uint64_t blockerId,
+                          const deliveryAssurances assurance = SESSION_DEFAULT);
+    bool isRequestCancelled(const uint64_t blockerId);
+
+    // publish-subscribe
+    enum subscriberPolicies
+    {
+        DROP_WHEN_FULL = 0,
+        BLOCK_WHEN_FULL = 1,
+    };
+    bool subscribe(const std::string &topic,
+                   const subscriberPolicies policy = DROP_WHEN_FULL);
+    bool unsubscribe(const std::string &topic);
+    bool publish(const std::string &topic,
+                 const void* data,
+                 const uint64_t size);
 
     // setter for changing callbacks
     void setStreamMessageCallback(void (*processStreamData)(Session*,
@@ -80,13 +141,47 @@ public:
     void setErrorCallback(void (*processError)(Session*,
                                                const uint8_t,
                                                const std::string));
+    void setPublishMessageCallback(void (*processPublish)(Session*,
+                                                          const std::string,
+                                                          const void*,
+                                                          const uint64_t));
 
     // session-controlling functions
     bool closeSession(const bool replyExpected = false);
     uint32_t sessionId() const;
     bool isClientSide() const;
+    bool isActive();
+    uint32_t missedHeartbeats() const;
+
+    // latency to the other side, estimated by the heartbeats
+    struct LatencyInfo
+    {
+        // smoothed round-trip-time in microseconds
+        uint64_t rtt = 0;
+        // variance of the round-trip-time in microseconds
+        uint64_t rttVariance = 0;
+        // clock of the other side minus the own clock in microseconds
+        int64_t clockOffset = 0;
+        // number of measurements, 0 if there is no estimation yet
+        uint64_t numberOfSamples = 0;
+    };
+    LatencyInfo getLatencyInfo();
+
+    // adaptive timeouts
+    bool setTimeoutBounds(const uint32_t minTimeoutMs,
+                          const uint32_t maxTimeoutMs);
+    uint32_t getReplyTimeout();
+    uint32_t getRequestTimeout();
+    uint64_t getRequestLatencyPercentile(const uint32_t percentile,
+                                         const uint64_t minNumberOfSamples = 1);
     Session* getLinkedSession();
 
+    // channels
+    Session* openChannel(const std::string &channelIdentifier = "",
+                         const uint32_t timeoutMs = 10000);
+    bool isChannel() const;
+    std::vector<Session*> getLinkGroup();
+
     enum errorCodes
     {
         UNDEFINED_ERROR = 0,
@@ -95,6 +190,8 @@ public:
         INVALID_MESSAGE_SIZE = 3,
         MESSAGE_TIMEOUT = 4,
         MULTIBLOCK_FAILED = 5,
+        REQUEST_OVERLOADED = 6,
+        UNKNOWN_METHOD = 7,
     };
 
     uint32_t increaseMessageIdCounter();
@@ -107,12 +204,21 @@ public:
     //=====================================================================
     Session(Network::AbstractSocket* socket);
 
-    Kitsunemimi::Statemachine m_statemachine;
+    // lifecycle-state, which is a single atomic value instead of a statemachine-object to keep
+    // the state-check on the send-path cheap
+    std::atomic<uint8_t> m_state{0};
+    // number of internal handlers, which still hold a pointer to the session, so a closed session
+    // is not reused or deleted before all of them have released it
+    std::atomic<uint32_t> m_references{0};
     Network::AbstractSocket* m_socket = nullptr;
     MultiblockIO* m_multiblockIo = nullptr;
     uint32_t m_sessionId = 0;
+    // id within this process, which is the same like the session-id on server-side
+    uint32_t m_localSessionId = 0;
     std::string m_sessionIdentifier = "";
     Session* m_linkedSession = nullptr;
+    std::vector<Session*> m_linkGroup;
+    Session* m_linkGroupSource = nullptr;
 
     // wait for initialized
     std::mutex m_cvMutex;
@@ -120,27 +226,139 @@ public:
 
     // init session
     bool connectiSession(const uint32_t sessionId);
+    bool waitUntilReady(const std::chrono::steady_clock::time_point &deadline);
     bool makeSessionReady(const uint32_t sessionId,
                           const std::string &sessionIdentifier);
 
     // end session
     bool endSession();
     bool disconnectSession();
+    void resetSession(Network::AbstractSocket* socket);
+
+    bool checkHeartbeat(const uint64_t tick);
+    void scheduleHeartbeat(const uint64_t tick);
+    void updateLatency(const uint64_t originSendTime,
+                       const uint64_t remoteReceiveTime,
+                       const uint64_t remoteSendTime,
+                       const uint64_t receiveTime);
+    void addReplyLatency(const uint64_t latency);
+    void addRequestLatency(const uint64_t latency);
+    void backoffReplyTimeout();
+    void backoffRequestTimeout();
 
-    bool sendHeartbeat();
-    void initStatemachine();
+    // cancellation of requests
+    void cancelRequest(const uint64_t blockerId);
+    void addCancelledRequest(const uint64_t blockerId);
+    bool removeCancelledRequest(const uint64_t blockerId);
+
+    // deadlines of requests
+    std::chrono::steady_clock::time_point convertDeadline(const uint32_t timeBudget);
+    static uint32_t getTimeBudget(const std::chrono::steady_clock::time_point &deadline);
+    static bool isExpired(const std::chrono::steady_clock::time_point &deadline);
+    void addRequestDeadline(const uint64_t blockerId,
+                            const std::chrono::steady_clock::time_point &deadline);
+    std::chrono::steady_clock::time_point removeRequestDeadline(const uint64_t blockerId);
+
+    // references of internal handlers
+    void addReference();
+    void releaseReference();
+    bool isReferenced() const;
+
+    // state
+    bool isInState(const uint8_t state) const;
+    bool goToNextState(const uint8_t transition);
+
+    // channels
+    bool connectChannel(const uint32_t sessionId);
+    void addChannel(const uint32_t id, Session* channel);
+    Session* removeChannel(const uint32_t id);
+    Session* getChannel(const uint32_t id);
+    void closeChannels();
+    void acquireSendTurn();
+    void releaseSendTurn();
+
+    // stripes
+    void addStripe(Network::AbstractSocket* socket);
+    std::vector<std::shared_ptr<StripeSender>> getStripeSenders();
+    void closeStripes();
 
     // callbacks
-    void (*m_processCreateSession)(Session*, const std::string);
-    void (*m_processCloseSession)(Session*, const std::string);
-    void (*m_processStreamData)(Session*, const void*, const uint64_t);
-    void (*m_processStandaloneData)(Session*, const uint64_t, DataBuffer*);
-    void (*m_processError)(Session*, const uint8_t, const std::string);
+    void (*m_processCreateSession)(Session*, const std::string) = nullptr;
+    void (*m_processCloseSession)(Session*, const std::string) = nullptr;
+    void (*m_processStreamData)(Session*, const void*, const uint64_t) = nullptr;
+    void (*m_processStandaloneData)(Session*, const uint64_t, DataBuffer*) = nullptr;
+    void (*m_processError)(Session*, const uint8_t, const std::string) = nullptr;
+    void (*m_processPublish)(Session*, const std::string, const void*, const uint64_t) = nullptr;
 
     // counter
     std::atomic_flag m_messageIdCounter_lock = ATOMIC_FLAG_INIT;
     std::atomic_flag m_linkSession_lock = ATOMIC_FLAG_INIT;
     uint32_t m_messageIdCounter = 0;
+
+    // session-wide delivery-assurance of single-block-messages
+    std::atomic<uint8_t> m_deliveryAssurance{TRANSPORT_REPLY};
+    bool isReplyExpected(const deliveryAssurances assurance) const;
+
+    // deadlines and cancel-marks of requests of the other side, which are not answered yet
+    struct RequestState
+    {
+        std::chrono::steady_clock::time_point deadline;
+        // point in time, after which the state is not needed anymore
+        std::chrono::steady_clock::time_point expiry;
+        bool cancelled = false;
+    };
+    std::atomic_flag m_cancel_lock = ATOMIC_FLAG_INIT;
+    std::unordered_map<uint64_t, RequestState> m_requestStates;
+    uint64_t m_requestStatePurgeLimit = 0;
+
+    RequestState& getRequestState(const uint64_t blockerId);
+    void purgeRequestStates();
+
+    // number of send heartbeats since the last heartbeat-reply
+    std::atomic<uint32_t> m_missedHeartbeats{0};
+
+    // heartbeat-scheduling in ticks of the heartbeat-timer
+    std::atomic<bool> m_inboundTraffic{false};
+    uint64_t m_nextHeartbeatTick = 0;
+    uint32_t m_heartbeatInterval = 0;
+
+    // latency-estimation
+    std::atomic_flag m_latency_lock = ATOMIC_FLAG_INIT;
+    LatencyInfo m_latency;
+    LatencyInfo m_replyLatency;
+    LatencyInfo m_requestLatency;
+    std::vector<uint64_t> m_requestLatencyHistory;
+    uint64_t m_requestLatencyPos = 0;
+    bool m_hasClockOffset = false;
+    uint32_t m_minTimeout = 0;
+    uint32_t m_maxTimeout = 0;
+    // multipliers of the timeouts after timeouts, which are reset by the next measurement
+    uint32_t m_replyBackoff = 1;
+    uint32_t m_requestBackoff = 1;
+
+    void addRttSample(LatencyInfo &latency,
+                      const uint64_t sample);
+    uint32_t calculateTimeout(const LatencyInfo &latency,
+                              const uint32_t initialTimeout,
+                              const uint32_t backoff);
+
+    // additional connections to transfer multi-block-messages in parallel, which are only
+    // accepted with the secret stripe-token of the session
+    std::atomic_flag m_stripe_lock = ATOMIC_FLAG_INIT;
+    std::vector<std::shared_ptr<StripeSender>> m_stripeSenders;
+    uint64_t m_stripeToken = 0;
+
+    // logical sessions, which share the connection of this session
+    Session* m_parentSession = nullptr;
+    std::atomic_flag m_channel_lock = ATOMIC_FLAG_INIT;
+    std::map<uint32_t, Session*> m_channels;
+
+    // turns to send parts of multi-block-messages over the shared connection in the order of the
+    // requests, so the channels send their parts round-robin
+    std::mutex m_sendTurnMutex;
+    std::condition_variable m_sendTurnCv;
+    uint64_t m_nextSendTurn = 0;
+    uint64_t m_currentSendTurn = 0;
 };
 
 } // namespace Sakura
@@ -27,6 +27,8 @@
 #include <vector>
 #include <map>
 #include <atomic>
+#include <future>
+#include <chrono>
 
 #include <libKitsunemimiSakuraNetwork/session.h>
 
@@ -50,10 +52,13 @@ public:
 
     // server
     uint32_t addUnixDomainServer(const std::string &socketFile);
-    uint32_t addTcpServer(const uint16_t port);
+    uint32_t addTcpServer(const uint16_t port,
+                          const uint32_t numberOfAcceptors = 1,
+                          const bool bindAcceptorsToCores = false);
     uint32_t addTlsTcpServer(const uint16_t port,
                              const std::string &certFile,
-                             const std::string &keyFile);
+                             const std::string &keyFile,
+                             const bool useKernelTls = false);
     bool closeServer(const uint32_t id);
     void cloesAllServers();
 
@@ -63,24 +68,131 @@ public:
     Session* startTcpSession(const std::string &address,
                              const uint16_t port,
                              const std::string &sessionIdentifier = "");
+    std::future<Session*> startTcpSessionAsync(const std::string &address,
+                                               const uint16_t port,
+                                               const std::string &sessionIdentifier = "",
+                                               const uint32_t timeoutMs = 10000);
+
+    struct SessionTarget
+    {
+        std::string address = "";
+        uint16_t port = 0;
+        std::string sessionIdentifier = "";
+    };
+    std::vector<Session*> startTcpSessions(const std::vector<SessionTarget> &targets,
+                                           const uint32_t timeoutMs = 10000,
+                                           const uint32_t numberOfConnectThreads = 64);
+    Session* startTcpSessionWithRequest(const std::string &address,
+                                        const uint16_t port,
+                                        const void* data,
+                                        const uint64_t size,
+                                        DataBuffer* &response,
+                                        const std::string &sessionIdentifier = "",
+                                        const uint32_t timeoutMs = 10000);
+    Session* startTcpSessionWithStream(const std::string &address,
+                                       const uint16_t port,
+                                       const void* data,
+                                       const uint64_t size,
+                                       const std::string &sessionIdentifier = "",
+                                       const uint32_t timeoutMs = 10000);
     Session* startTlsTcpSession(const std::string &address,
                                 const uint16_t port,
                                 const std::string &certFile,
                                 const std::string &keyFile,
-                                const std::string &sessionIdentifier = "");
+                                const std::string &sessionIdentifier = "",
+                                const bool useKernelTls = false,
+                                const uint32_t numberOfStripes = 0);
     bool closeSession(const uint32_t id);
     Session* getSession(const uint32_t id);
     void closeAllSession();
 
+    // broadcast
+    enum broadcastTypes
+    {
+        STREAM_BROADCAST = 0,
+        STANDALONE_BROADCAST = 1,
+    };
+    uint32_t broadcast(const std::vector<Session*> &sessions,
+                       const void* data,
+                       const uint64_t size,
+                       const broadcastTypes type);
+
+    // hedged requests
+    DataBuffer* sendHedgedRequest(const std::vector<Session*> &sessions,
+                                  const void* data,
+                                  const uint64_t size,
+                                  const uint32_t hedgeDelayMs = 0,
+                                  const uint64_t timeout = 0);
+    bool setHedgeBudget(const uint32_t percent);
+
+    // publish-subscribe
+    uint32_t publish(const std::string &topic,
+                     const void* data,
+                     const uint64_t size);
+    void setTopicQueueSize(const uint32_t maxQueueSize);
+
+    // admission-control of incoming requests
+    bool setRequestLimits(const uint32_t maxConcurrentRequests,
+                          const uint32_t maxConcurrentRequestsPerSession = 0,
+                          const uint32_t maxQueuedRequests = 1024);
+
+    // remote procedure calls (the method-table is shared by all controllers of the process)
+    struct RpcMetrics
+    {
+        // number of processed requests
+        uint64_t numberOfCalls = 0;
+        // total size of all requests in bytes
+        uint64_t receivedBytes = 0;
+        // total and maximum time within the handler in microseconds
+        uint64_t totalProcessingTime = 0;
+        uint64_t maxProcessingTime = 0;
+    };
+    bool registerRpcMethod(const uint32_t methodId,
+                           void (*processRequest)(Session*, const uint64_t, DataBuffer*));
+    bool unregisterRpcMethod(const uint32_t methodId);
+    bool getRpcMetrics(const uint32_t methodId,
+                       RpcMetrics &metrics);
+
     // linking
     bool linkSessions(Session* session1, Session* session2);
     bool unlinkSession(Session* session);
+    bool addToLinkGroup(Session* source, Session* target);
+    bool removeFromLinkGroup(Session* source, Session* target);
 
 private:
     uint32_t m_serverIdCounter = 0;
 
+    // budget of hedged requests in hundredths of a duplicate, which grows with each hedged
+    // request by the allowed percentage and shrinks by 100 for each send duplicate
+    std::atomic_flag m_hedge_lock = ATOMIC_FLAG_INIT;
+    uint32_t m_hedgeBudget = 0;
+    uint64_t m_hedgeTokens = 0;
+
+    void addHedgeTokens();
+    bool takeHedgeToken();
+
     Session* startSession(Network::AbstractSocket* socket,
-                          const std::string &sessionIdentifier);
+                          const std::string &sessionIdentifier,
+                          const uint32_t timeoutMs = 10000);
+    // first message, which is send together with the init-message of a new session
+    struct EarlyData
+    {
+        const void* data = nullptr;
+        uint64_t size = 0;
+        bool isRequest = false;
+        uint64_t blockerId = 0;
+        // timeout of the request in milliseconds
+        uint64_t blockerTimeout = 0;
+    };
+
+    Session* initSession(Network::AbstractSocket* socket,
+                         const std::string &sessionIdentifier,
+                         EarlyData* earlyData = nullptr);
+    Session* finishSession(Session* session,
+                           const std::chrono::steady_clock::time_point &deadline);
+
+    void lockLinkSessions(Session* session1, Session* session2);
+    void unlockLinkSessions(Session* session1, Session* session2);
 };
 
 } // namespace Sakura
@@ -0,0 +1,118 @@
+/**
+ * @file       session_pool.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef SESSION_POOL_H
+#define SESSION_POOL_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class SessionController;
+
+class SessionPool
+        : public Kitsunemimi::Thread
+{
+public:
+    SessionPool(SessionController* sessionController,
+                const uint32_t minIdleSessions = 4,
+                const uint32_t maxSessions = 64,
+                const uint32_t maxMissedHeartbeats = 3,
+                const uint32_t idleTimeoutMs = 60000);
+    ~SessionPool();
+
+    bool addEndpoint(const std::string &address,
+                     const uint16_t port,
+                     const std::string &sessionIdentifier = "");
+    bool removeEndpoint(const std::string &address,
+                        const uint16_t port);
+
+    Session* lease(const std::string &address,
+                   const uint16_t port,
+                   const uint32_t timeoutMs = 10000);
+    bool release(Session* session,
+                 const bool broken = false);
+
+    uint32_t numberOfIdleSessions(const std::string &address,
+                                  const uint16_t port);
+    uint32_t numberOfLeasedSessions(const std::string &address,
+                                    const uint16_t port);
+
+protected:
+    void run();
+
+private:
+    struct IdleSession
+    {
+        Session* session = nullptr;
+        std::chrono::steady_clock::time_point idleSince;
+    };
+
+    struct Endpoint
+    {
+        std::string address = "";
+        uint16_t port = 0;
+        std::string sessionIdentifier = "";
+        std::vector<IdleSession> idleSessions;
+        uint32_t numberOfLeased = 0;
+        uint32_t numberOfStarting = 0;
+        uint32_t peakLeased = 0;
+        uint32_t numberOfPins = 0;
+        bool removed = false;
+    };
+
+    SessionController* m_sessionController = nullptr;
+    uint32_t m_minIdleSessions = 0;
+    uint32_t m_maxSessions = 0;
+    uint32_t m_maxMissedHeartbeats = 0;
+    std::chrono::milliseconds m_idleTimeout;
+
+    std::mutex m_poolMutex;
+    std::condition_variable m_poolCv;
+    std::map<std::string, Endpoint*> m_endpoints;
+    std::map<Session*, Endpoint*> m_leasedSessions;
+    // number of pins of all endpoints, which the destructor has to wait for
+    uint32_t m_numberOfPins = 0;
+
+    bool isHealthy(Session* session);
+    void maintainEndpoint(std::unique_lock<std::mutex> &lock,
+                          Endpoint* endpoint);
+    void closePooledSession(Session* session);
+    bool isUnused(Endpoint* endpoint);
+    Endpoint* getEndpoint(const std::string &address,
+                          const uint16_t port);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // SESSION_POOL_H
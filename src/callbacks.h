@@ -23,6 +23,9 @@
 #ifndef CALLBACKS_H
 #define CALLBACKS_H
 
+#include <algorithm>
+#include <vector>
+
 #include <libKitsunemimiNetwork/abstract_socket.h>
 #include <libKitsunemimiCommon/buffer/ring_buffer.h>
 
@@ -37,6 +40,7 @@
 #include <messages_processing/stream_data_processing.h>
 #include <messages_processing/multiblock_data_processing.h>
 #include <messages_processing/singleblock_data_processing.h>
+#include <messages_processing/pubsub_processing.h>
 
 using Kitsunemimi::RingBuffer;
 using Kitsunemimi::Network::AbstractSocket;
@@ -47,6 +51,128 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+/**
+ * @brief collect all complete and valid messages at the beginning of the ring-buffer as batch
+ *        for forwarding. The messages are not copied into a separate buffer. An invalid message
+ *        ends the batch and is handled as first message of the next call by the normal checks.
+ *
+ * @param recvBuffer data-buffer with the incoming data
+ * @param data reference for the pointer to the beginning of the batch
+ * @param messagePositions reference to the list, which is filled with the positions of the
+ *                         messages within the batch
+ *
+ * @return size of the batch in bytes
+ */
+inline uint64_t
+getForwardBatch(RingBuffer* recvBuffer,
+                uint8_t* &data,
+                std::vector<uint64_t> &messagePositions)
+{
+    const CommonMessageHeader* firstHeader = getObject_RingBuffer<CommonMessageHeader>(*recvBuffer);
+    if(firstHeader == nullptr) {
+        return 0;
+    }
+
+    // limit the size of the batch, but always allow at least one complete message
+    uint64_t batchLimit = MAX_FORWARD_BATCH_SIZE;
+    if(firstHeader->totalMessageSize > batchLimit) {
+        batchLimit = firstHeader->totalMessageSize;
+    }
+    const uint64_t availableSize = std::min(recvBuffer->usedSize, batchLimit);
+
+    data = getDataPointer_RingBuffer(*recvBuffer, availableSize);
+    if(data == nullptr) {
+        return 0;
+    }
+
+    uint64_t batchSize = 0;
+    while(batchSize + sizeof(CommonMessageHeader) <= availableSize)
+    {
+        const CommonMessageHeader* header =
+                reinterpret_cast<const CommonMessageHeader*>(&data[batchSize]);
+        const uint32_t totalMessageSize = header->totalMessageSize;
+        if(header->version != PROTOCOL_VERSION
+                || totalMessageSize < sizeof(CommonMessageHeader) + sizeof(CommonMessageFooter)
+                || batchSize + totalMessageSize > availableSize)
+        {
+            break;
+        }
+
+        const uint32_t* end = reinterpret_cast<const uint32_t*>(&data[batchSize
+                                                                      + totalMessageSize
+                                                                      - sizeof(uint32_t)]);
+        if(*end != MESSAGE_DELIMITER) {
+            break;
+        }
+
+        messagePositions.push_back(batchSize);
+        batchSize += totalMessageSize;
+    }
+
+    return batchSize;
+}
+
+/**
+ * @brief forward all complete messages within the ring-buffer to the given sessions. The
+ *        messages are validated only once. For each target the session-id within the headers is
+ *        rewritten in place and the whole batch is send with a single write. Because the write
+ *        is blocking, a slow target stalls the reading of the incoming connection, which brings
+ *        the back-pressure to the sender.
+ *
+ * @param source session, which has received the messages
+ * @param targets sessions, which should receive the messages
+ * @param recvBuffer data-buffer with the incoming data
+ *
+ * @return number of bytes, which were taken from the buffer
+ */
+inline uint64_t
+forwardMessages(Session* source,
+                const std::vector<Session*> &targets,
+                RingBuffer* recvBuffer)
+{
+    uint8_t* data = nullptr;
+    std::vector<uint64_t> messagePositions;
+    const uint64_t batchSize = getForwardBatch(recvBuffer, data, messagePositions);
+    if(batchSize == 0) {
+        return 0;
+    }
+
+    // reduce the time-budget of messages with deadline by the estimated transfer-time to this
+    // session, so the deadline stays valid over multiple forwardings. Expired messages keep a
+    // minimal budget and are dropped by the final receiver.
+    const uint32_t transferTime = static_cast<uint32_t>(source->getLatencyInfo().rtt / 2000);
+    if(transferTime > 0)
+    {
+        for(const uint64_t position : messagePositions)
+        {
+            CommonMessageHeader* header = reinterpret_cast<CommonMessageHeader*>(&data[position]);
+            if(header->additionalValues == 0) {
+                continue;
+            }
+
+            if(header->additionalValues > transferTime) {
+                header->additionalValues -= transferTime;
+            } else {
+                header->additionalValues = 1;
+            }
+        }
+    }
+
+    for(Session* target : targets)
+    {
+        const uint32_t targetSessionId = target->sessionId();
+        for(const uint64_t position : messagePositions)
+        {
+            CommonMessageHeader* header = reinterpret_cast<CommonMessageHeader*>(&data[position]);
+            header->sessionId = targetSessionId;
+        }
+
+        target->m_socket->sendMessage(data, batchSize);
+    }
+
+    return batchSize;
+}
+
 /**
  * process incoming data
  *
@@ -69,7 +195,7 @@ processMessage(void* target,
     }
 
     // check version in header
-    if(header->version != 0x1)
+    if(header->version != PROTOCOL_VERSION)
     {
         LOG_ERROR("false message-version");
         send_ErrorMessage(session, Session::errorCodes::FALSE_VERSION, "");
@@ -80,6 +206,22 @@ processMessage(void* target,
         return 0;
     }
 
+    // the message must at least contain header and delimiter, because the size is used to find
+    // the delimiter and the message-processing casts the message by its type
+    if(header->totalMessageSize < sizeof(CommonMessageHeader) + sizeof(CommonMessageFooter))
+    {
+        LOG_ERROR("message-size too small");
+        send_ErrorMessage(session, Session::errorCodes::INVALID_MESSAGE_SIZE, "");
+
+        // the following data can not be split into messages anymore, so the connection is closed
+        if(session->closeSession(false) == false)
+        {
+            SessionHandler::m_sessionHandler->removeSession(session->m_localSessionId);
+            session->disconnectSession();
+        }
+        return 0;
+    }
+
     // get complete message from the ringbuffer, if enough data are available
     void* rawMessage = static_cast<void*>(getDataPointer_RingBuffer(*recvBuffer,
                                                                     header->totalMessageSize));
@@ -102,20 +244,33 @@ processMessage(void* target,
         return 0;
     }
 
-    // use the linkes session to forward the message
-    if(session->m_linkedSession != nullptr)
+    // any incoming message shows, that the connection is alive, so no heartbeat is necessary
+    session->m_inboundTraffic.store(true, std::memory_order_relaxed);
+
+    // demultiplex the messages of the channels, which share the connection of the session
+    if(header->sessionId != session->m_sessionId)
     {
-        Session* linkedSession = session->getLinkedSession();
+        Session* channel = session->getChannel(header->sessionId);
+        if(channel != nullptr) {
+            session = channel;
+        }
+    }
 
-        header->sessionId = linkedSession->sessionId();
-        linkedSession->m_socket->sendMessage(rawMessage, header->totalMessageSize);
+    // use the linkes session to forward the message and all following complete messages
+    Session* linkedSession = session->getLinkedSession();
+    if(linkedSession != nullptr) {
+        return forwardMessages(session, std::vector<Session*>{linkedSession}, recvBuffer);
+    }
 
-        return header->totalMessageSize;
+    // forward the messages to all sessions of the link-group
+    const std::vector<Session*> linkGroup = session->getLinkGroup();
+    if(linkGroup.size() > 0) {
+        return forwardMessages(session, linkGroup, recvBuffer);
     }
 
     // remove from reply-handler if message is reply
     if(header->flags & 0x2) {
-        SessionHandler::m_replyHandler->removeMessage(header->sessionId, header->messageId);
+        SessionHandler::m_replyHandler->removeMessage(session->m_localSessionId, header->messageId);
     }
 
     // process message by type
@@ -139,6 +294,9 @@ processMessage(void* target,
         case ERROR_TYPE:
             process_Error_Type(session, header, rawMessage);
             break;
+        case PUBSUB_TYPE:
+            process_PubSub_Type(session, header, rawMessage);
+            break;
         default:
             // TODO: handle invalid case
             return 0;
@@ -172,7 +330,7 @@ void
 processConnection_Callback(void*,
                            AbstractSocket* socket)
 {
-    Session* newSession = new Session(socket);
+    Session* newSession = SessionHandler::m_sessionHandler->createSession(socket);
     socket->setMessageCallback(newSession, &processMessage_callback);
     socket->startThread();
 }
@@ -42,60 +42,225 @@ MessageBlockerHandler::~MessageBlockerHandler()
 }
 
 /**
- * @brief MessageBlockerHandler::blockMessage
+ * @brief register a new blocker before the request is send, so a fast response can not arrive
+ *        before the blocker exists
  *
  * @param blockerId id ot identify the entry within the blocker-handler
- * @param blockerTimeout time until a timeout appear for the message in seconds
+ * @param timeoutMs time until a timeout appear for the message in milliseconds
  * @param session pointer to the session for error-callback in case of a timeout
- * @return
  */
-DataBuffer*
-MessageBlockerHandler::blockMessage(const uint64_t blockerId,
-                                    const uint64_t blockerTimeout,
-                                    Session* session)
+void
+MessageBlockerHandler::registerBlocker(const uint64_t blockerId,
+                                       const uint64_t timeoutMs,
+                                       Session* session)
 {
     // init new blocker entry
     MessageBlocker* messageBlocker = new MessageBlocker();
     messageBlocker->blockerId = blockerId;
-    messageBlocker->timer = blockerTimeout;
+    messageBlocker->deadline = std::chrono::steady_clock::now()
+                               + std::chrono::milliseconds(timeoutMs);
     messageBlocker->session = session;
+    if(session != nullptr) {
+        session->addReference();
+    }
 
     // add to waiting-list
     spinLock();
     m_messageList.push_back(messageBlocker);
     spinUnlock();
+}
 
-    // release thread
-    std::unique_lock<std::mutex> lock(messageBlocker->cvMutex);
-    messageBlocker->cv.wait(lock);
+/**
+ * @brief register multiple blockers with the same deadline at once for a batch of requests
+ *
+ * @param blockerIds ids ot identify the entries within the blocker-handler
+ * @param timeoutMs time until a timeout appear for the messages in milliseconds
+ * @param session pointer to the session for error-callback in case of a timeout
+ */
+void
+MessageBlockerHandler::registerBlockers(const std::vector<uint64_t> &blockerIds,
+                                        const uint64_t timeoutMs,
+                                        Session* session)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+
+    // init new blocker entries
+    std::vector<MessageBlocker*> newBlockers;
+    newBlockers.reserve(blockerIds.size());
+    for(const uint64_t blockerId : blockerIds)
+    {
+        MessageBlocker* messageBlocker = new MessageBlocker();
+        messageBlocker->blockerId = blockerId;
+        messageBlocker->deadline = deadline;
+        messageBlocker->session = session;
+        if(session != nullptr) {
+            session->addReference();
+        }
+        newBlockers.push_back(messageBlocker);
+    }
+
+    // add to waiting-list
+    spinLock();
+    m_messageList.insert(m_messageList.end(), newBlockers.begin(), newBlockers.end());
+    spinUnlock();
+}
+
+/**
+ * @brief wait until an already registered blocker was released by the response or by a timeout
+ *
+ * @param blockerId id ot identify the entry within the blocker-handler
+ * @param rejected optional pointer, which is set to true, if the other side has rejected the
+ *                 request instead of a timeout
+ * @param responder optional pointer, which is set to the session, over which the response has
+ *                  arrived, or to nullptr without response
+ *
+ * @return response-data, if released by a response, else nullptr
+ */
+DataBuffer*
+MessageBlockerHandler::waitForBlocker(const uint64_t blockerId,
+                                      bool* rejected,
+                                      Session** responder)
+{
+    spinLock();
+    MessageBlocker* messageBlocker = getBlocker(blockerId, true);
+    spinUnlock();
+
+    if(messageBlocker == nullptr) {
+        return nullptr;
+    }
+
+    // wait until released. The entry is only deleted by this thread, so it stays valid.
+    DataBuffer* result = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(messageBlocker->cvMutex);
+        messageBlocker->cv.wait(lock, [messageBlocker] { return messageBlocker->released; });
+        result = messageBlocker->responseData;
+        messageBlocker->responseData = nullptr;
+        if(rejected != nullptr) {
+            *rejected = messageBlocker->rejected;
+        }
+        if(responder != nullptr) {
+            *responder = messageBlocker->responder;
+        }
+    }
 
-    // remove from list and return result
+    // remove from list
     spinLock();
-    DataBuffer* result = removeMessageFromList(blockerId);
+    removeMessageFromList(blockerId);
     spinUnlock();
 
+    if(messageBlocker->session != nullptr) {
+        messageBlocker->session->releaseReference();
+    }
+    delete messageBlocker;
+
     return result;
 }
 
+/**
+ * @brief wait a limited time for the release of a registered blocker without removing it, for
+ *        example to decide if a hedged request is necessary
+ *
+ * @param blockerId id ot identify the entry within the blocker-handler
+ * @param waitTimeMs maximum time to wait in milliseconds
+ *
+ * @return true, if the blocker was released within the time, else false
+ */
+bool
+MessageBlockerHandler::waitForRelease(const uint64_t blockerId,
+                                      const uint32_t waitTimeMs)
+{
+    spinLock();
+    MessageBlocker* messageBlocker = getBlocker(blockerId, true);
+    spinUnlock();
+
+    if(messageBlocker == nullptr) {
+        return true;
+    }
+
+    // the entry is only deleted by waitForBlocker, which is called by the same thread
+    std::unique_lock<std::mutex> lock(messageBlocker->cvMutex);
+    return messageBlocker->cv.wait_for(lock,
+                                       std::chrono::milliseconds(waitTimeMs),
+                                       [messageBlocker] { return messageBlocker->released; });
+}
+
+/**
+ * @brief MessageBlockerHandler::blockMessage
+ *
+ * @param blockerId id ot identify the entry within the blocker-handler
+ * @param timeoutMs time until a timeout appear for the message in milliseconds
+ * @param session pointer to the session for error-callback in case of a timeout
+ * @return
+ */
+DataBuffer*
+MessageBlockerHandler::blockMessage(const uint64_t blockerId,
+                                    const uint64_t timeoutMs,
+                                    Session* session)
+{
+    registerBlocker(blockerId, timeoutMs, session);
+    return waitForBlocker(blockerId);
+}
+
 /**
  * @brief MessageBlockerHandler::releaseMessage
  * @param blockerId
  * @param data data-buffer, which comes from the other side and should be returned by the
  *             blocked thread, which called the request-method within the session
+ * @param responder session, over which the response has arrived
  *
  * @return true, if blocker-id was found in the list of blocked threads
  */
 bool
 MessageBlockerHandler::releaseMessage(const uint64_t blockerId,
-                                      DataBuffer* data)
+                                      DataBuffer* data,
+                                      Session* responder)
 {
-    bool result = false;
+    spinLock();
+
+    MessageBlocker* messageBlocker = getBlocker(blockerId);
+    if(messageBlocker != nullptr)
+    {
+        messageBlocker->responder = responder;
+        releaseBlocker(messageBlocker, data);
+    }
+
+    spinUnlock();
 
+    // nobody waits for the response anymore, for example because of a timeout
+    if(messageBlocker == nullptr)
+    {
+        delete data;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief release a blocked thread without response, because the other side has rejected the
+ *        request
+ *
+ * @param blockerId id of the blocker
+ *
+ * @return true, if blocker-id was found in the list of blocked threads
+ */
+bool
+MessageBlockerHandler::rejectMessage(const uint64_t blockerId)
+{
     spinLock();
-    result = releaseMessageInList(blockerId, data);
+
+    MessageBlocker* messageBlocker = getBlocker(blockerId);
+    if(messageBlocker != nullptr)
+    {
+        messageBlocker->rejected = true;
+        releaseBlocker(messageBlocker, nullptr);
+    }
+
     spinUnlock();
 
-    return result;
+    return messageBlocker != nullptr;
 }
 
 /**
@@ -108,22 +273,22 @@ MessageBlockerHandler::run()
     {
         makeTimerStep();
 
-        // sleep for 1 second
-        sleepThread(1000000);
+        // sleep for 100 milliseconds, because the adaptive timeouts can be shorter than a second
+        sleepThread(100000);
     }
 }
 
 /**
- * @brief MessageBlockerHandler::releaseMessageInList
+ * @brief get a blocker by its id (must be called with held lock)
  *
- * @param blockerId
- * @param data
+ * @param blockerId id of the blocker
+ * @param includeReleased true to return also an already released blocker
  *
- * @return
+ * @return pointer to the blocker, if found, else nullptr
  */
-bool
-MessageBlockerHandler::releaseMessageInList(const uint64_t blockerId,
-                                            DataBuffer* data)
+MessageBlockerHandler::MessageBlocker*
+MessageBlockerHandler::getBlocker(const uint64_t blockerId,
+                                  const bool includeReleased)
 {
     std::vector<MessageBlocker*>::iterator it;
     for(it = m_messageList.begin();
@@ -131,15 +296,30 @@ MessageBlockerHandler::releaseMessageInList(const uint64_t blockerId,
         it++)
     {
         MessageBlocker* tempItem = *it;
-        if(tempItem->blockerId == blockerId)
+        if(tempItem->blockerId == blockerId
+                && (includeReleased || tempItem->released == false))
         {
-            tempItem->responseData = data;
-            tempItem->cv.notify_one();
-            return true;
+            return tempItem;
         }
     }
 
-    return false;
+    return nullptr;
+}
+
+/**
+ * @brief mark a blocker as released and wake up the waiting thread (must be called with held lock)
+ *
+ * @param blocker blocker to release
+ * @param data response-data or nullptr in case of a timeout
+ */
+void
+MessageBlockerHandler::releaseBlocker(MessageBlocker* blocker,
+                                      DataBuffer* data)
+{
+    std::lock_guard<std::mutex> guard(blocker->cvMutex);
+    blocker->responseData = data;
+    blocker->released = true;
+    blocker->cv.notify_one();
 }
 
 /**
@@ -147,7 +327,7 @@ MessageBlockerHandler::releaseMessageInList(const uint64_t blockerId,
  * @param blockerId
  * @return
  */
-DataBuffer*
+void
 MessageBlockerHandler::removeMessageFromList(const uint64_t blockerId)
 {
     std::vector<MessageBlocker*>::iterator it;
@@ -158,28 +338,14 @@ MessageBlockerHandler::removeMessageFromList(const uint64_t blockerId)
         MessageBlocker* tempItem = *it;
         if(tempItem->blockerId == blockerId)
         {
-            if(m_messageList.size() > 1)
-            {
-                // swap with last and remove the last instead of erase the element direct
-                // because this was is faster
-                std::iter_swap(it, m_messageList.end() - 1);
-                m_messageList.pop_back();
-            }
-            else
-            {
-                m_messageList.clear();
-            }
-
-            // get data-buffer from the blocker-entry and delete the entry afterwards
-            DataBuffer* result = tempItem->responseData;
-            tempItem->responseData = nullptr;
-            delete tempItem;
-
-            return result;
+            // swap with last and remove the last instead of erase the element direct
+            // because this was is faster
+            std::iter_swap(it, m_messageList.end() - 1);
+            m_messageList.pop_back();
+
+            return;
         }
     }
-
-    return nullptr;
 }
 
 /**
@@ -190,20 +356,18 @@ MessageBlockerHandler::clearList()
 {
     spinLock();
 
-    // release all threads
+    // release all threads, which delete their entries by themself
     std::vector<MessageBlocker*>::iterator it;
     for(it = m_messageList.begin();
         it != m_messageList.end();
         it++)
     {
         MessageBlocker* tempItem = *it;
-        tempItem->cv.notify_one();
-        delete tempItem;
+        if(tempItem->released == false) {
+            releaseBlocker(tempItem, nullptr);
+        }
     }
 
-    // clear list
-    m_messageList.clear();
-
     spinUnlock();
 }
 
@@ -213,28 +377,42 @@ MessageBlockerHandler::clearList()
 void
 MessageBlockerHandler::makeTimerStep()
 {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<std::pair<Session*, uint64_t>> timedOut;
+
     spinLock();
 
     for(uint64_t i = 0; i < m_messageList.size(); i++)
     {
         MessageBlocker* temp = m_messageList[i];
-        temp->timer -= 1;
+        if(temp->released) {
+            continue;
+        }
 
-        if(temp->timer == 0)
+        if(temp->deadline <= now
+                && temp->session != nullptr)
         {
-            removeMessageFromList(temp->blockerId);
-            releaseMessageInList(temp->blockerId, nullptr);
-
-            const std::string err = "TIMEOUT of request: "
-                                    + std::to_string(temp->blockerId);
-
-            temp->session->m_processError(temp->session,
-                                          Session::errorCodes::MESSAGE_TIMEOUT,
-                                          err);
+            // the released blocker can be deleted by the waiting thread, so the session needs an
+            // own reference for the error-callback
+            temp->session->addReference();
+            timedOut.push_back(std::make_pair(temp->session, temp->blockerId));
+            releaseBlocker(temp, nullptr);
+        }
+        else if(temp->deadline <= now)
+        {
+            releaseBlocker(temp, nullptr);
         }
     }
 
     spinUnlock();
+
+    // trigger error-callbacks without holding the lock
+    for(const std::pair<Session*, uint64_t> &entry : timedOut)
+    {
+        const std::string err = "TIMEOUT of request: " + std::to_string(entry.second);
+        entry.first->m_processError(entry.first, Session::errorCodes::MESSAGE_TIMEOUT, err);
+        entry.first->releaseReference();
+    }
 }
 
 } // namespace Sakura
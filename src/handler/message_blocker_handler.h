@@ -25,6 +25,9 @@
 
 #include <vector>
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include <libKitsunemimiCommon/threading/thread.h>
 
@@ -40,11 +43,24 @@ public:
     MessageBlockerHandler();
     ~MessageBlockerHandler();
 
+    void registerBlocker(const uint64_t blockerId,
+                         const uint64_t timeoutMs,
+                         Session* session);
+    void registerBlockers(const std::vector<uint64_t> &blockerIds,
+                          const uint64_t timeoutMs,
+                          Session* session);
+    DataBuffer* waitForBlocker(const uint64_t blockerId,
+                               bool* rejected = nullptr,
+                               Session** responder = nullptr);
+    bool waitForRelease(const uint64_t blockerId,
+                        const uint32_t waitTimeMs);
     DataBuffer* blockMessage(const uint64_t blockerId,
-                             const uint64_t blockerTimeout,
+                             const uint64_t timeoutMs,
                              Session* session);
     bool releaseMessage(const uint64_t blockerId,
-                        DataBuffer* data);
+                        DataBuffer* data,
+                        Session* responder = nullptr);
+    bool rejectMessage(const uint64_t blockerId);
 
 protected:
     void run();
@@ -54,7 +70,11 @@ private:
     {
         Session* session = nullptr;
         uint64_t blockerId = 0;
-        uint64_t timer = 0;
+        std::chrono::steady_clock::time_point deadline;
+        bool released = false;
+        bool rejected = false;
+        // session, over which the response has arrived (only compared, never dereferenced)
+        Session* responder = nullptr;
         std::mutex cvMutex;
         std::condition_variable cv;
         DataBuffer* responseData = nullptr;
@@ -62,9 +82,11 @@ private:
 
     std::vector<MessageBlocker*> m_messageList;
 
-    bool releaseMessageInList(const uint64_t blockerId,
-                              DataBuffer* data);
-    DataBuffer* removeMessageFromList(const uint64_t blockerId);
+    MessageBlocker* getBlocker(const uint64_t blockerId,
+                               const bool includeReleased = false);
+    void releaseBlocker(MessageBlocker* blocker,
+                        DataBuffer* data);
+    void removeMessageFromList(const uint64_t blockerId);
     void clearList();
     void makeTimerStep();
 };
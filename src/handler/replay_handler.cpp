@@ -45,6 +45,9 @@ ReplyHandler::ReplyHandler() {}
 ReplyHandler::~ReplyHandler()
 {
     spinLock();
+    for(const MessageTime &messageTime : m_messageList) {
+        messageTime.session->releaseReference();
+    }
     m_messageList.clear();
     spinUnlock();
 }
@@ -67,7 +70,8 @@ ReplyHandler::addMessage(const uint8_t messageType,
 }
 
 /**
- * @brief add a message to the internal timeout-queue
+ * @brief add a message to the internal timeout-queue. The timeout is taken from the session,
+ *        which adapts it to the measured round-trip-time.
  *
  * @param messageType type of the message
  * @param completeMessageId completed id of the message, which should be added
@@ -78,10 +82,15 @@ ReplyHandler::addMessage(const uint8_t messageType,
                          const uint64_t completeMessageId,
                          Session* session)
 {
+    const uint32_t timeout = session->getReplyTimeout();
+
     MessageTime messageTime;
     messageTime.completeMessageId = completeMessageId;
     messageTime.messageType = messageType;
     messageTime.session = session;
+    messageTime.sendTime = std::chrono::steady_clock::now();
+    messageTime.deadline = messageTime.sendTime + std::chrono::milliseconds(timeout);
+    session->addReference();
 
     spinLock();
     m_messageList.push_back(messageTime);
@@ -104,7 +113,8 @@ ReplyHandler::removeMessage(const uint32_t sessionId,
 }
 
 /**
- * @brief remove a message from the internal list
+ * @brief remove a message from the internal list, because its reply has arrived, and use the
+ *        time since sending as new latency-sample for the session
  *
  * @param completeMessageId id of the message, which should be removed
  *
@@ -114,46 +124,73 @@ bool
 ReplyHandler::removeMessage(const uint64_t completeMessageId)
 {
     bool result = false;
+    MessageTime removedMessage;
 
     spinLock();
-    result = removeMessageFromList(completeMessageId);
+    result = removeMessageFromList(completeMessageId, &removedMessage);
     spinUnlock();
 
+    if(result)
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - removedMessage.sendTime).count();
+        removedMessage.session->addReplyLatency(static_cast<uint64_t>(latency));
+    }
+
+    if(result) {
+        removedMessage.session->releaseReference();
+    }
+
     return result;
 }
 
 /**
- * @brief remove all messages from the internal message, which are related to a specific session
+ * @brief remove all messages from the internal list, which are related to a specific session,
+ *        and release their references, because the session is closed
  *
- * @param sessionId id of the session
+ * @param session pointer to the session
  */
 void
-ReplyHandler::removeAllOfSession(const uint32_t sessionId)
+ReplyHandler::removeAllOfSession(Session* session)
 {
+    uint64_t numberOfRemoved = 0;
+
     spinLock();
 
-    std::vector<MessageTime>::iterator it;
-    for(it = m_messageList.begin();
-        it != m_messageList.end();
-        it++)
+    uint64_t i = 0;
+    while(i < m_messageList.size())
     {
-        if((it->completeMessageId & 0xFFFFFFFF) == sessionId) {
-            it->ignoreResult = true;
+        if(m_messageList[i].session == session)
+        {
+            // the removal moves the last entry to the current position
+            removeMessageFromList(m_messageList[i].completeMessageId);
+            numberOfRemoved++;
+        }
+        else
+        {
+            i++;
         }
     }
 
     spinUnlock();
+
+    for(uint64_t i = 0; i < numberOfRemoved; i++) {
+        session->releaseReference();
+    }
 }
 
 /**
  * @brief remove a message from the internal list
  *
  * @param messageId id of the message, which should be removed
+ * @param removedMessage optional pointer to get a copy of the removed entry
  *
  * @return false, if message-id doesn't exist in the list, else true
  */
 bool
-ReplyHandler::removeMessageFromList(const uint64_t completeMessageId)
+ReplyHandler::removeMessageFromList(const uint64_t completeMessageId,
+                                    MessageTime* removedMessage)
 {
     std::vector<MessageTime>::iterator it;
     for(it = m_messageList.begin();
@@ -162,6 +199,10 @@ ReplyHandler::removeMessageFromList(const uint64_t completeMessageId)
     {
         if(it->completeMessageId == completeMessageId)
         {
+            if(removedMessage != nullptr) {
+                *removedMessage = *it;
+            }
+
             if(m_messageList.size() > 1)
             {
                 // swap with last and remove the last instead of erase the element direct
@@ -187,12 +228,12 @@ ReplyHandler::removeMessageFromList(const uint64_t completeMessageId)
 void
 ReplyHandler::run()
 {
-    uint32_t counter = 0;
+    uint64_t tick = 0;
 
     while(!m_abort)
     {
         sleepThread(100000);
-        counter += 1;
+        tick += 1;
 
         if(m_abort) {
             break;
@@ -200,50 +241,55 @@ ReplyHandler::run()
 
         makeTimerStep();
 
-        if(counter % 10 == 0)
-        {
-            SessionHandler::m_sessionHandler->sendHeartBeats();
-            counter = 0;
-        }
+        // each due session decides by itself, if a heartbeat is necessary in this tick
+        SessionHandler::m_sessionHandler->sendHeartBeats(tick);
     }
 }
 
 /**
- * @brief Increase the timer of all messages and handle timeouts
+ * @brief remove all messages with passed deadline and handle their timeouts
  */
 void
 ReplyHandler::makeTimerStep()
 {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<MessageTime> timedOut;
+
     spinLock();
 
-    for(uint64_t i = 0; i < m_messageList.size(); i++)
+    uint64_t i = 0;
+    while(i < m_messageList.size())
     {
-        MessageTime* temp = &m_messageList[i];
-        temp->timer += 0.1f;
-
-        if(temp->timer >= m_timeoutValue)
+        if(m_messageList[i].deadline <= now)
         {
-            spinUnlock();
-            removeMessage(temp->completeMessageId);
-            if(temp->ignoreResult == false)
-            {
-                const std::string err = "TIMEOUT of message: "
-                                        + std::to_string(temp->completeMessageId)
-                                        + " with type: "
-                                        + std::to_string(temp->messageType);
-
-                temp->session->m_processError(temp->session,
-                                              Session::errorCodes::MESSAGE_TIMEOUT,
-                                              err);
-            }
-
-            spinLock();
-
-            break;
+            // the removal moves the last entry to the current position
+            MessageTime temp;
+            removeMessageFromList(m_messageList[i].completeMessageId, &temp);
+            timedOut.push_back(temp);
+        }
+        else
+        {
+            i++;
         }
     }
 
     spinUnlock();
+
+    // trigger error-callbacks without holding the lock
+    for(const MessageTime &temp : timedOut)
+    {
+        temp.session->backoffReplyTimeout();
+
+        const std::string err = "TIMEOUT of message: "
+                                + std::to_string(temp.completeMessageId)
+                                + " with type: "
+                                + std::to_string(temp.messageType);
+
+        temp.session->m_processError(temp.session,
+                                     Session::errorCodes::MESSAGE_TIMEOUT,
+                                     err);
+        temp.session->releaseReference();
+    }
 }
 
 } // namespace Sakura
@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <iostream>
+#include <chrono>
 
 #include <libKitsunemimiCommon/threading/thread.h>
 
@@ -53,7 +54,7 @@ public:
     bool removeMessage(const uint32_t sessionId,
                        const uint64_t messageId);
     bool removeMessage(const uint64_t completeMessageId);
-    void removeAllOfSession(const uint32_t sessionId);
+    void removeAllOfSession(Session* session);
 
 protected:
     void run();
@@ -62,17 +63,17 @@ private:
     struct MessageTime
     {
         uint64_t completeMessageId = 0;
-        float timer = 0.0f;
+        std::chrono::steady_clock::time_point sendTime;
+        std::chrono::steady_clock::time_point deadline;
         uint8_t messageType = 0;
         Session* session = nullptr;
-        bool ignoreResult = false;
     };
 
-    float m_timeoutValue = 2.0f;
     std::vector<MessageTime> m_messageList;
 
     void makeTimerStep();
-    bool removeMessageFromList(const uint64_t completeMessageId);
+    bool removeMessageFromList(const uint64_t completeMessageId,
+                               MessageTime* removedMessage = nullptr);
 };
 
 } // namespace Sakura
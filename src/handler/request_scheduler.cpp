@@ -0,0 +1,441 @@
+/**
+ * @file       request_scheduler.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <handler/request_scheduler.h>
+#include <handler/request_worker.h>
+#include <handler/session_handler.h>
+#include <handler/rpc_dispatcher.h>
+#include <messages_processing/singleblock_data_processing.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+RequestScheduler::RequestScheduler() {}
+
+/**
+ * @brief destructor
+ */
+RequestScheduler::~RequestScheduler()
+{
+    std::vector<RequestWorker*> workers;
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+        m_enabled = false;
+        workers.swap(m_workers);
+        m_queueCv.notify_all();
+    }
+
+    // the workers use the scheduler, so they have to be stopped before
+    for(RequestWorker* worker : workers)
+    {
+        worker->stopThread();
+        delete worker;
+    }
+
+    for(SessionQueue* queue : m_activeQueues)
+    {
+        for(const Request &request : queue->requests)
+        {
+            request.session->releaseReference();
+            delete request.data;
+        }
+    }
+}
+
+/**
+ * @brief set the limits of the request-processing. Incoming requests are processed by a pool of
+ *        worker-threads instead of the socket-threads. Waiting requests are queued per session
+ *        and the queues are served by deficit-round-robin with the size of the requests as cost,
+ *        so a single session with many requests can not starve the others. If the queue is full,
+ *        requests of the session with the longest queue are rejected immediately, so a single
+ *        session can not fill the queue for all others.
+ *
+ * @param maxConcurrentRequests maximum number of requests, which are processed at the same time,
+ *                              which is the number of worker-threads, or 0 to process requests
+ *                              directly on the socket-threads again
+ * @param maxConcurrentRequestsPerSession maximum number of requests of a single session, which
+ *                                        are processed at the same time, or 0 for no own limit
+ * @param maxQueuedRequests maximum number of waiting requests of all sessions
+ *
+ * @return false, if the limits are invalid, else true
+ */
+bool
+RequestScheduler::setLimits(const uint32_t maxConcurrentRequests,
+                            const uint32_t maxConcurrentRequestsPerSession,
+                            const uint32_t maxQueuedRequests)
+{
+    if(maxConcurrentRequests != 0
+            && maxQueuedRequests == 0)
+    {
+        return false;
+    }
+
+    std::vector<Request> rejected;
+    std::vector<RequestWorker*> stoppedWorkers;
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+
+        m_enabled = maxConcurrentRequests != 0;
+        m_maxQueuedRequests = maxQueuedRequests;
+        m_maxConcurrentRequestsPerSession = maxConcurrentRequestsPerSession;
+        if(m_maxConcurrentRequestsPerSession == 0
+                || m_maxConcurrentRequestsPerSession > maxConcurrentRequests)
+        {
+            m_maxConcurrentRequestsPerSession = maxConcurrentRequests;
+        }
+
+        // adjust the number of workers
+        while(m_workers.size() < maxConcurrentRequests)
+        {
+            RequestWorker* worker = new RequestWorker(this);
+            worker->startThread();
+            m_workers.push_back(worker);
+        }
+        while(m_workers.size() > maxConcurrentRequests)
+        {
+            stoppedWorkers.push_back(m_workers.back());
+            m_workers.pop_back();
+        }
+
+        // without workers nobody would process the waiting requests anymore
+        if(m_enabled == false)
+        {
+            for(SessionQueue* queue : m_activeQueues)
+            {
+                rejected.insert(rejected.end(), queue->requests.begin(), queue->requests.end());
+                queue->requests.clear();
+                queue->deficit = 0;
+            }
+            m_activeQueues.clear();
+            m_numberOfQueued = 0;
+        }
+
+        m_queueCv.notify_all();
+    }
+
+    // a worker can be within a long callback or can be the calling thread, so it is not joined
+    for(RequestWorker* worker : stoppedWorkers) {
+        worker->scheduleThreadForDeletion();
+    }
+
+    rejectRequests(rejected);
+
+    return true;
+}
+
+/**
+ * @brief check if requests are processed by the scheduler
+ *
+ * @return true, if enabled, else false
+ */
+bool
+RequestScheduler::isEnabled() const
+{
+    return m_enabled;
+}
+
+/**
+ * @brief add a request to the queue of its session. If the queue is full, the newest request of
+ *        the longest session-queue is rejected with an overload-message to the other side, so it
+ *        doesn't have to wait for its timeout. If the queue of the session is already one of the
+ *        longest, the new request itself is rejected.
+ *
+ * @param session session, which has received the request
+ * @param methodId id of the remote procedure or 0 for the standalone-callback
+ * @param blockerId id of the request
+ * @param data payload of the request, which is deleted, if the request is rejected
+ * @param deadline deadline of the request or default-value for no deadline
+ *
+ * @return false, if the request was rejected, else true
+ */
+bool
+RequestScheduler::addRequest(Session* session,
+                             const uint32_t methodId,
+                             const uint64_t blockerId,
+                             DataBuffer* data,
+                             const std::chrono::steady_clock::time_point &deadline)
+{
+    Request request;
+    request.session = session;
+    request.methodId = methodId;
+    request.blockerId = blockerId;
+    request.data = data;
+    request.deadline = deadline;
+
+    // the session is referenced until the request is finished, dropped or rejected
+    session->addReference();
+
+    std::vector<Request> rejected;
+    bool accepted = false;
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+
+        if(m_enabled)
+        {
+            SessionQueue &queue = m_queues[session];
+            queue.session = session;
+
+            // make space by dropping the newest request of the longest queue, as long as it stays
+            // longer than the queue of the session with the new request
+            if(m_numberOfQueued >= m_maxQueuedRequests)
+            {
+                SessionQueue* longestQueue = &queue;
+                for(SessionQueue* activeQueue : m_activeQueues)
+                {
+                    if(activeQueue->requests.size() > longestQueue->requests.size()) {
+                        longestQueue = activeQueue;
+                    }
+                }
+
+                if(longestQueue->requests.size() > queue.requests.size() + 1)
+                {
+                    rejected.push_back(longestQueue->requests.back());
+                    longestQueue->requests.pop_back();
+                    m_numberOfQueued--;
+                }
+            }
+
+            if(m_numberOfQueued < m_maxQueuedRequests)
+            {
+                // a session with new waiting requests joins the round-robin
+                if(queue.requests.size() == 0) {
+                    m_activeQueues.push_back(&queue);
+                }
+
+                queue.requests.push_back(request);
+                m_numberOfQueued++;
+                m_queueCv.notify_one();
+                accepted = true;
+            }
+            else if(queue.requests.size() == 0
+                    && queue.numberOfRunning == 0)
+            {
+                m_queues.erase(session);
+            }
+        }
+    }
+
+    if(accepted == false) {
+        rejected.push_back(request);
+    }
+    rejectRequests(rejected);
+
+    return accepted;
+}
+
+/**
+ * @brief drop all waiting requests of a closed session. Running requests are not waited for,
+ *        because they hold a reference to the session, so it is not reused before they are
+ *        finished. The entry of the session is removed by the last running request in this case.
+ *
+ * @param session session, which should be removed
+ */
+void
+RequestScheduler::removeSession(Session* session)
+{
+    std::vector<Request> dropped;
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+
+        std::map<Session*, SessionQueue>::iterator it = m_queues.find(session);
+        if(it == m_queues.end()) {
+            return;
+        }
+
+        SessionQueue* queue = &it->second;
+        dropped.insert(dropped.end(), queue->requests.begin(), queue->requests.end());
+        m_numberOfQueued -= queue->requests.size();
+        queue->requests.clear();
+        queue->deficit = 0;
+        m_activeQueues.erase(std::remove(m_activeQueues.begin(), m_activeQueues.end(), queue),
+                             m_activeQueues.end());
+
+        if(queue->numberOfRunning == 0) {
+            m_queues.erase(it);
+        }
+    }
+
+    for(const Request &request : dropped)
+    {
+        request.session->releaseReference();
+        delete request.data;
+    }
+}
+
+/**
+ * @brief process the next request of the queues. Called by the worker-threads in a loop.
+ *
+ * @return false, if there was no request within a short time, else true
+ */
+bool
+RequestScheduler::processNextRequest()
+{
+    // wait with timeout to give the worker the chance to check its abort-flag
+    Request request;
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        if(getNextRequest(request) == false)
+        {
+            m_queueCv.wait_for(lock, std::chrono::milliseconds(10));
+            if(getNextRequest(request) == false) {
+                return false;
+            }
+        }
+    }
+
+    // drop requests, which were cancelled or expired while waiting in the queue
+    Session* session = request.session;
+    if(session->removeCancelledRequest(request.blockerId)
+            || Session::isExpired(request.deadline))
+    {
+        session->removeRequestDeadline(request.blockerId);
+        delete request.data;
+    }
+    else
+    {
+        SessionHandler::m_rpcDispatcher->dispatch(session,
+                                                  request.methodId,
+                                                  request.blockerId,
+                                                  request.data);
+    }
+
+    finishRequest(request);
+
+    return true;
+}
+
+/**
+ * @brief get the next request by deficit-round-robin over the sessions with waiting requests.
+ *        Must be called while holding the queue-mutex.
+ *
+ * @param request reference for the next request
+ *
+ * @return false, if there is no request or all sessions with requests have reached their limit
+ */
+bool
+RequestScheduler::getNextRequest(Request &request)
+{
+    uint64_t numberOfBlocked = 0;
+    while(m_activeQueues.size() > numberOfBlocked)
+    {
+        SessionQueue* queue = m_activeQueues.front();
+        m_activeQueues.pop_front();
+
+        // skip sessions, which have already reached their own limit
+        if(queue->numberOfRunning >= m_maxConcurrentRequestsPerSession)
+        {
+            m_activeQueues.push_back(queue);
+            numberOfBlocked++;
+            continue;
+        }
+
+        // if the deficit is too low for the next request, the session gets a new quantum for its
+        // next turn. Large requests need multiple turns.
+        const uint64_t cost = REQUEST_BASE_COST + queue->requests.front().data->bufferPosition;
+        if(queue->deficit < cost)
+        {
+            queue->deficit += REQUEST_QUANTUM;
+            m_activeQueues.push_back(queue);
+            numberOfBlocked = 0;
+            continue;
+        }
+
+        queue->deficit -= cost;
+        request = queue->requests.front();
+        queue->requests.pop_front();
+        queue->numberOfRunning++;
+        m_numberOfQueued--;
+
+        // the session keeps its turn, as long as its deficit is enough. A session without waiting
+        // requests leaves the round-robin and loses its deficit.
+        if(queue->requests.size() > 0) {
+            m_activeQueues.push_front(queue);
+        } else {
+            queue->deficit = 0;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief release the slot of a processed request
+ *
+ * @param request processed request
+ */
+void
+RequestScheduler::finishRequest(const Request &request)
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+
+    std::map<Session*, SessionQueue>::iterator it = m_queues.find(request.session);
+    if(it != m_queues.end())
+    {
+        SessionQueue &queue = it->second;
+        queue.numberOfRunning--;
+        if(queue.numberOfRunning == 0
+                && queue.requests.size() == 0)
+        {
+            m_queues.erase(it);
+        }
+    }
+
+    // wake up workers, which are blocked by the limit of the session
+    m_queueCv.notify_all();
+
+    request.session->releaseReference();
+}
+
+/**
+ * @brief reject requests with an overload-message to the other side
+ *
+ * @param requests requests to reject
+ */
+void
+RequestScheduler::rejectRequests(const std::vector<Request> &requests)
+{
+    for(const Request &request : requests)
+    {
+        request.session->removeRequestDeadline(request.blockerId);
+        send_Data_SingleBlock_Reject(request.session,
+                                     request.blockerId,
+                                     Data_SingleBlockReject_Message::OVERLOAD);
+        request.session->releaseReference();
+        delete request.data;
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
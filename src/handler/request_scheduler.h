@@ -0,0 +1,102 @@
+/**
+ * @file       request_scheduler.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <iostream>
+#include <deque>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/buffer/data_buffer.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class RequestWorker;
+
+class RequestScheduler
+{
+public:
+    RequestScheduler();
+    ~RequestScheduler();
+
+    bool setLimits(const uint32_t maxConcurrentRequests,
+                   const uint32_t maxConcurrentRequestsPerSession,
+                   const uint32_t maxQueuedRequests);
+    bool isEnabled() const;
+
+    bool addRequest(Session* session,
+                    const uint32_t methodId,
+                    const uint64_t blockerId,
+                    DataBuffer* data,
+                    const std::chrono::steady_clock::time_point &deadline
+                        = std::chrono::steady_clock::time_point());
+    void removeSession(Session* session);
+
+    bool processNextRequest();
+
+private:
+    struct Request
+    {
+        Session* session = nullptr;
+        uint32_t methodId = 0;
+        uint64_t blockerId = 0;
+        DataBuffer* data = nullptr;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    struct SessionQueue
+    {
+        Session* session = nullptr;
+        std::deque<Request> requests;
+        uint64_t deficit = 0;
+        uint32_t numberOfRunning = 0;
+    };
+
+    std::atomic<bool> m_enabled{false};
+    uint32_t m_maxConcurrentRequestsPerSession = 0;
+    uint32_t m_maxQueuedRequests = 0;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::map<Session*, SessionQueue> m_queues;
+    // queues with waiting requests in the order of the round-robin
+    std::deque<SessionQueue*> m_activeQueues;
+    uint64_t m_numberOfQueued = 0;
+    std::vector<RequestWorker*> m_workers;
+
+    bool getNextRequest(Request &request);
+    void finishRequest(const Request &request);
+    void rejectRequests(const std::vector<Request> &requests);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // REQUEST_SCHEDULER_H
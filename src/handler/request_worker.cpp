@@ -0,0 +1,54 @@
+/**
+ * @file       request_worker.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <handler/request_worker.h>
+#include <handler/request_scheduler.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param scheduler scheduler, which provides the requests
+ */
+RequestWorker::RequestWorker(RequestScheduler* scheduler)
+    : Kitsunemimi::Thread()
+{
+    m_scheduler = scheduler;
+}
+
+/**
+ * @brief Main-loop to process the requests of the scheduler
+ */
+void
+RequestWorker::run()
+{
+    while(m_abort == false) {
+        m_scheduler->processNextRequest();
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
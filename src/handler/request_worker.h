@@ -0,0 +1,50 @@
+/**
+ * @file       request_worker.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef REQUEST_WORKER_H
+#define REQUEST_WORKER_H
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class RequestScheduler;
+
+class RequestWorker
+        : public Kitsunemimi::Thread
+{
+public:
+    RequestWorker(RequestScheduler* scheduler);
+
+protected:
+    void run();
+
+private:
+    RequestScheduler* m_scheduler = nullptr;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // REQUEST_WORKER_H
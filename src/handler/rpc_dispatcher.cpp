@@ -0,0 +1,210 @@
+/**
+ * @file       rpc_dispatcher.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <handler/rpc_dispatcher.h>
+#include <handler/session_handler.h>
+#include <messages_processing/singleblock_data_processing.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+RpcDispatcher::RpcDispatcher() {}
+
+/**
+ * @brief register the handler of a remote procedure
+ *
+ * @param methodId id of the remote procedure, which must not be 0
+ * @param processRequest handler, which gets the session, the blocker-id for the response and the
+ *                       request-data like the standalone-callback
+ *
+ * @return false, if the id is 0 or already registered, else true
+ */
+bool
+RpcDispatcher::registerMethod(const uint32_t methodId,
+                              void (*processRequest)(Session*, const uint64_t, DataBuffer*))
+{
+    if(methodId == 0
+            || processRequest == nullptr)
+    {
+        return false;
+    }
+
+    RpcMethod newMethod;
+    newMethod.methodId = methodId;
+    newMethod.processRequest = processRequest;
+
+    while(m_method_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::vector<RpcMethod>::iterator it = findMethod(methodId);
+    const bool found = it != m_methods.end() && it->methodId == methodId;
+    if(found == false) {
+        m_methods.insert(it, newMethod);
+    }
+
+    m_method_lock.clear(std::memory_order_release);
+
+    return found == false;
+}
+
+/**
+ * @brief remove the handler of a remote procedure
+ *
+ * @param methodId id of the remote procedure
+ *
+ * @return false, if the id was not registered, else true
+ */
+bool
+RpcDispatcher::unregisterMethod(const uint32_t methodId)
+{
+    while(m_method_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::vector<RpcMethod>::iterator it = findMethod(methodId);
+    const bool found = it != m_methods.end() && it->methodId == methodId;
+    if(found) {
+        m_methods.erase(it);
+    }
+
+    m_method_lock.clear(std::memory_order_release);
+
+    return found;
+}
+
+/**
+ * @brief get the metrics of a remote procedure
+ *
+ * @param methodId id of the remote procedure
+ * @param metrics reference for the result
+ *
+ * @return false, if the id is not registered, else true
+ */
+bool
+RpcDispatcher::getMetrics(const uint32_t methodId,
+                          SessionController::RpcMetrics &metrics)
+{
+    while(m_method_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::vector<RpcMethod>::iterator it = findMethod(methodId);
+    const bool found = it != m_methods.end() && it->methodId == methodId;
+    if(found) {
+        metrics = it->metrics;
+    }
+
+    m_method_lock.clear(std::memory_order_release);
+
+    return found;
+}
+
+/**
+ * @brief forward incoming data to the handler of its remote procedure. Data without method-id go
+ *        to the standalone-callback of the session. A request for an unknown method is rejected
+ *        immediately.
+ *
+ * @param session session, which has received the data
+ * @param methodId id of the remote procedure or 0 for the standalone-callback
+ * @param blockerId id of the request
+ * @param data received data, which are given to the handler
+ */
+void
+RpcDispatcher::dispatch(Session* session,
+                        const uint32_t methodId,
+                        const uint64_t blockerId,
+                        DataBuffer* data)
+{
+    if(methodId == 0)
+    {
+        session->m_processStandaloneData(session, blockerId, data);
+        return;
+    }
+
+    void (*processRequest)(Session*, const uint64_t, DataBuffer*) = nullptr;
+
+    while(m_method_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<RpcMethod>::iterator it = findMethod(methodId);
+    if(it != m_methods.end()
+            && it->methodId == methodId)
+    {
+        processRequest = it->processRequest;
+    }
+    m_method_lock.clear(std::memory_order_release);
+
+    if(processRequest == nullptr)
+    {
+        session->removeRequestDeadline(blockerId);
+        send_Data_SingleBlock_Reject(session,
+                                     blockerId,
+                                     Data_SingleBlockReject_Message::UNKNOWN_METHOD);
+        delete data;
+        return;
+    }
+
+    // the data belong to the handler after the call
+    const uint64_t size = data->bufferPosition;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    processRequest(session, blockerId, data);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    const uint64_t duration = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+
+    // the method can be removed while the handler was running
+    while(m_method_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    it = findMethod(methodId);
+    if(it != m_methods.end()
+            && it->methodId == methodId)
+    {
+        SessionController::RpcMetrics &metrics = it->metrics;
+        metrics.numberOfCalls++;
+        metrics.receivedBytes += size;
+        metrics.totalProcessingTime += duration;
+        metrics.maxProcessingTime = std::max(metrics.maxProcessingTime, duration);
+    }
+    m_method_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief get the position of a method within the sorted table (must be called with held lock)
+ *
+ * @param methodId id of the remote procedure
+ *
+ * @return iterator to the method or to the position, where it would have to be inserted
+ */
+std::vector<RpcDispatcher::RpcMethod>::iterator
+RpcDispatcher::findMethod(const uint32_t methodId)
+{
+    return std::lower_bound(m_methods.begin(),
+                            m_methods.end(),
+                            methodId,
+                            [](const RpcMethod &method, const uint32_t id) {
+                                return method.methodId < id;
+                            });
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,73 @@
+/**
+ * @file       rpc_dispatcher.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef RPC_DISPATCHER_H
+#define RPC_DISPATCHER_H
+
+#include <iostream>
+#include <atomic>
+#include <vector>
+
+#include <libKitsunemimiCommon/buffer/data_buffer.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class RpcDispatcher
+{
+public:
+    RpcDispatcher();
+
+    bool registerMethod(const uint32_t methodId,
+                        void (*processRequest)(Session*, const uint64_t, DataBuffer*));
+    bool unregisterMethod(const uint32_t methodId);
+    bool getMetrics(const uint32_t methodId,
+                    SessionController::RpcMetrics &metrics);
+
+    void dispatch(Session* session,
+                  const uint32_t methodId,
+                  const uint64_t blockerId,
+                  DataBuffer* data);
+
+private:
+    struct RpcMethod
+    {
+        uint32_t methodId = 0;
+        void (*processRequest)(Session*, const uint64_t, DataBuffer*) = nullptr;
+        SessionController::RpcMetrics metrics;
+    };
+
+    // flat table, which is sorted by the method-ids
+    std::atomic_flag m_method_lock = ATOMIC_FLAG_INIT;
+    std::vector<RpcMethod> m_methods;
+
+    std::vector<RpcMethod>::iterator findMethod(const uint32_t methodId);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // RPC_DISPATCHER_H
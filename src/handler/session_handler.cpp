@@ -24,6 +24,9 @@
 
 #include <handler/reply_handler.h>
 #include <handler/message_blocker_handler.h>
+#include <handler/topic_handler.h>
+#include <handler/request_scheduler.h>
+#include <handler/rpc_dispatcher.h>
 #include <handler/session_handler.h>
 
 #include <libKitsunemimiSakuraNetwork/session.h>
@@ -40,6 +43,9 @@ namespace Sakura
 // init static variables
 ReplyHandler* SessionHandler::m_replyHandler = nullptr;
 MessageBlockerHandler* SessionHandler::m_blockerHandler = nullptr;
+TopicHandler* SessionHandler::m_topicHandler = nullptr;
+RequestScheduler* SessionHandler::m_requestScheduler = nullptr;
+RpcDispatcher* SessionHandler::m_rpcDispatcher = nullptr;
 SessionHandler* SessionHandler::m_sessionHandler = nullptr;
 
 /**
@@ -65,6 +71,18 @@ SessionHandler::SessionHandler(void (*processCreateSession)(Session*, const std:
         m_blockerHandler->startThread();
     }
 
+    if(m_topicHandler == nullptr) {
+        m_topicHandler = new TopicHandler();
+    }
+
+    if(m_requestScheduler == nullptr) {
+        m_requestScheduler = new RequestScheduler();
+    }
+
+    if(m_rpcDispatcher == nullptr) {
+        m_rpcDispatcher = new RpcDispatcher();
+    }
+
     // check if messages have the size of a multiple of 8
     assert(sizeof(CommonMessageHeader) % 8 == 0);
     assert(sizeof(CommonMessageFooter) % 8 == 0);
@@ -72,6 +90,7 @@ SessionHandler::SessionHandler(void (*processCreateSession)(Session*, const std:
     assert(sizeof(Session_Init_Reply_Message) % 8 == 0);
     assert(sizeof(Session_Close_Start_Message) % 8 == 0);
     assert(sizeof(Session_Close_Reply_Message) % 8 == 0);
+    assert(sizeof(Session_Stripe_Join_Message) % 8 == 0);
     assert(sizeof(Heartbeat_Start_Message) % 8 == 0);
     assert(sizeof(Heartbeat_Reply_Message) % 8 == 0);
     assert(sizeof(Error_FalseVersion_Message) % 8 == 0);
@@ -79,10 +98,15 @@ SessionHandler::SessionHandler(void (*processCreateSession)(Session*, const std:
     assert(sizeof(Error_InvalidMessage_Message) % 8 == 0);
     assert(sizeof(Data_StreamReply_Message) % 8 == 0);
     assert(sizeof(Data_SingleBlockReply_Message) % 8 == 0);
+    assert(sizeof(Data_SingleBlockCancel_Message) % 8 == 0);
+    assert(sizeof(Data_SingleBlockReject_Message) % 8 == 0);
     assert(sizeof(Data_MultiInit_Message) % 8 == 0);
     assert(sizeof(Data_MultiInitReply_Message) % 8 == 0);
     assert(sizeof(Data_MultiFinish_Message) % 8 == 0);
     assert(sizeof(Data_MultiAbortInit_Message) % 8 == 0);
+    assert(sizeof(PubSub_Subscribe_Message) % 8 == 0);
+    assert(sizeof(PubSub_Unsubscribe_Message) % 8 == 0);
+    assert(sizeof(PubSub_Publish_Header) % 8 == 0);
 }
 
 /**
@@ -94,15 +118,49 @@ SessionHandler::~SessionHandler()
     m_servers.clear();
     unlockServerMap();
 
-    lockSessionMap();
-    m_sessions.clear();
-    unlockSessionMap();
-
+    // stop the heartbeats and the reply-tracking before the sessions are deleted, so their
+    // references are released
     if(m_replyHandler != nullptr)
     {
         delete m_replyHandler;
         m_replyHandler = nullptr;
     }
+
+    m_sessions.clear();
+
+    while(m_heartbeat_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_heartbeatQueue.clear();
+    m_heartbeatEntries.clear();
+    m_heartbeat_lock.clear(std::memory_order_release);
+
+    // stop the processing of requests before the sessions are deleted
+    if(m_requestScheduler != nullptr)
+    {
+        delete m_requestScheduler;
+        m_requestScheduler = nullptr;
+    }
+
+    while(m_recycle_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<Session*> sessionsToDelete = m_recycledSessions;
+    for(const QuarantinedSession &quarantined : m_quarantine) {
+        sessionsToDelete.push_back(quarantined.session);
+    }
+    m_recycledSessions.clear();
+    m_quarantine.clear();
+    m_recycle_lock.clear(std::memory_order_release);
+    deleteSessions(sessionsToDelete);
+
+    if(m_topicHandler != nullptr)
+    {
+        delete m_topicHandler;
+        m_topicHandler = nullptr;
+    }
+
+    if(m_rpcDispatcher != nullptr)
+    {
+        delete m_rpcDispatcher;
+        m_rpcDispatcher = nullptr;
+    }
 }
 
 /**
@@ -118,77 +176,229 @@ SessionHandler::addSession(const uint32_t id, Session* session)
     session->m_processCloseSession = m_processCloseSession;
     session->m_processError = m_processError;
 
-    lockSessionMap();
-    m_sessions.insert(std::make_pair(id, session));
-    unlockSessionMap();
+    if(m_sessions.addSession(id, session) == false) {
+        return;
+    }
+
+    HeartbeatEntry entry;
+    entry.sessionId = id;
+    entry.session = session;
+
+    while(m_heartbeat_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_heartbeatQueue.insert(entry);
+    m_heartbeatEntries[session] = entry;
+    m_heartbeat_lock.clear(std::memory_order_release);
 }
 
 /**
- * @brief remove a session from the internal list, but doesn't close the session
+ * @brief remove a session from the internal list, but doesn't close the session. The id of the
+ *        session is given back to be reused later. The heartbeat-entry and the tracked messages
+ *        of the session are removed too, so no handler points to the session after it was
+ *        deleted by its owner.
  *
  * @param id id of the session, which should be removed
  */
 Session*
 SessionHandler::removeSession(const uint32_t id)
 {
-    Session* ret = nullptr;
+    Session* ret = m_sessions.removeSession(id);
+    if(ret != nullptr)
+    {
+        while(m_sessionIdCounter_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+        m_freeSessionIds.push_back(id);
+        m_sessionIdCounter_lock.clear(std::memory_order_release);
+
+        while(m_heartbeat_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+        std::unordered_map<Session*, HeartbeatEntry>::iterator it;
+        it = m_heartbeatEntries.find(ret);
+        if(it != m_heartbeatEntries.end())
+        {
+            m_heartbeatQueue.erase(it->second);
+            m_heartbeatEntries.erase(it);
+        }
+        m_heartbeat_lock.clear(std::memory_order_release);
+
+        if(m_replyHandler != nullptr) {
+            m_replyHandler->removeAllOfSession(ret);
+        }
+    }
 
-    lockSessionMap();
+    return ret;
+}
 
-    std::map<uint32_t, Session*>::iterator it;
-    it = m_sessions.find(id);
+/**
+ * @brief get a session-object for a new incoming connection. A closed session is reused, if
+ *        one is available after its quarantine, so the common case of an accept doesn't allocate
+ *        a new session and its resources.
+ *
+ * @param socket socket of the new connection
+ *
+ * @return session for the socket
+ */
+Session*
+SessionHandler::createSession(Network::AbstractSocket* socket)
+{
+    std::vector<Session*> sessionsToDelete;
+    Session* session = nullptr;
 
-    if(it != m_sessions.end())
+    while(m_recycle_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    releaseQuarantine(sessionsToDelete);
+    if(m_recycledSessions.size() > 0)
     {
-        ret = it->second;
-        m_sessions.erase(it);
+        session = m_recycledSessions.back();
+        m_recycledSessions.pop_back();
     }
+    m_recycle_lock.clear(std::memory_order_release);
 
-    unlockSessionMap();
+    deleteSessions(sessionsToDelete);
 
-    return ret;
+    if(session == nullptr) {
+        return new Session(socket);
+    }
+
+    session->resetSession(socket);
+
+    return session;
 }
 
 /**
- * @brief increase the internal counter by one and returns the new counter-value
+ * @brief give a closed session, which was created by the library, back to be reused for another
+ *        connection after the quarantine-time
  *
- * @return id for the new session
+ * @param session closed session
  */
-uint16_t
-SessionHandler::increaseSessionIdCounter()
+void
+SessionHandler::recycleSession(Session* session)
 {
-    uint16_t tempId = 0;
+    std::vector<Session*> sessionsToDelete;
 
-    while (m_sessionIdCounter_lock.test_and_set(std::memory_order_acquire)) {
-        asm("");
-    }
+    QuarantinedSession quarantined;
+    quarantined.session = session;
+    quarantined.closeTime = std::chrono::steady_clock::now();
 
-    m_sessionIdCounter++;
-    tempId = m_sessionIdCounter;
+    while(m_recycle_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_quarantine.push_back(quarantined);
+    releaseQuarantine(sessionsToDelete);
+    m_recycle_lock.clear(std::memory_order_release);
 
-    m_sessionIdCounter_lock.clear(std::memory_order_release);
+    deleteSessions(sessionsToDelete);
+}
 
-    return tempId;
+/**
+ * @brief move all sessions with expired quarantine, which are not referenced anymore by the
+ *        internal handlers, into the list of reusable sessions. If this list is full, the
+ *        sessions are returned to be deleted. The quarantine-time is still necessary for the
+ *        receive-thread of the socket, which can not be counted. Must be called while holding the
+ *        recycle-lock.
+ *
+ * @param sessionsToDelete reference to the list for the sessions, which are not needed anymore
+ */
+void
+SessionHandler::releaseQuarantine(std::vector<Session*> &sessionsToDelete)
+{
+    const std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now()
+                                                        - std::chrono::seconds(SESSION_QUARANTINE_TIME);
+
+    std::deque<QuarantinedSession>::iterator it = m_quarantine.begin();
+    while(it != m_quarantine.end()
+          && it->closeTime <= limit)
+    {
+        Session* session = it->session;
+        if(session->isReferenced())
+        {
+            it++;
+            continue;
+        }
+        it = m_quarantine.erase(it);
+
+        if(m_recycledSessions.size() < MAX_RECYCLED_SESSIONS) {
+            m_recycledSessions.push_back(session);
+        } else {
+            sessionsToDelete.push_back(session);
+        }
+    }
 }
 
 /**
- * @brief SessionHandler::lockSessionMap
+ * @brief delete closed sessions
+ *
+ * @param sessions sessions to delete
  */
 void
-SessionHandler::lockSessionMap()
+SessionHandler::deleteSessions(const std::vector<Session*> &sessions)
 {
-    while (m_sessionMap_lock.test_and_set(std::memory_order_acquire)) {
-        asm("");
+    for(Session* session : sessions) {
+        delete session;
     }
 }
 
 /**
- * @brief SessionHandler::unlockSessionMap
+ * @brief get a registered session
+ *
+ * @param id id of the session
+ *
+ * @return pointer to the session, if found, else nullptr
+ */
+Session*
+SessionHandler::getSession(const uint32_t id)
+{
+    return m_sessions.getSession(id);
+}
+
+/**
+ * @brief get a snapshot of all registered sessions. The sessions are referenced until the
+ *        snapshot is given back with releaseSessions.
+ *
+ * @return list of all registered sessions
+ */
+std::vector<Session*>
+SessionHandler::getSessions()
+{
+    return m_sessions.getSnapshot();
+}
+
+/**
+ * @brief release the references of a snapshot, which was returned by getSessions
+ *
+ * @param sessions snapshot of sessions
  */
 void
-SessionHandler::unlockSessionMap()
+SessionHandler::releaseSessions(const std::vector<Session*> &sessions)
 {
-    m_sessionMap_lock.clear(std::memory_order_release);
+    m_sessions.releaseSnapshot(sessions);
+}
+
+/**
+ * @brief get a new id for a session, which is unique within this process. Ids of removed
+ *        sessions are reused in the order of their release, but only when enough of them are
+ *        waiting, so a released id is not reused before many other sessions were closed.
+ *
+ * @return id for the new session, or 0, if all ids are in use
+ */
+uint32_t
+SessionHandler::allocateSessionId()
+{
+    uint32_t tempId = 0;
+
+    while (m_sessionIdCounter_lock.test_and_set(std::memory_order_acquire)) {
+        asm("");
+    }
+
+    if(m_freeSessionIds.size() > MIN_FREE_SESSION_IDS
+            || (m_sessionIdCounter == 0xFFFFFFFF && m_freeSessionIds.size() > 0))
+    {
+        tempId = m_freeSessionIds.front();
+        m_freeSessionIds.pop_front();
+    }
+    else if(m_sessionIdCounter < 0xFFFFFFFF)
+    {
+        m_sessionIdCounter++;
+        tempId = m_sessionIdCounter;
+    }
+
+    m_sessionIdCounter_lock.clear(std::memory_order_release);
+
+    return tempId;
 }
 
 /**
@@ -212,22 +422,55 @@ SessionHandler::unlockServerMap()
 }
 
 /**
- * @brief send a heartbeat to all registered sessions
+ * @brief let all sessions, which are due in this tick, check, if they have to send a heartbeat.
+ *        The due sessions are taken from a queue ordered by the tick of their next check, so the
+ *        timer-step doesn't visit all sessions. The due sessions are referenced, while they are
+ *        checked without holding the lock of the queue.
+ *
+ * @param tick current tick of the heartbeat-timer
  */
 void
-SessionHandler::sendHeartBeats()
+SessionHandler::sendHeartBeats(const uint64_t tick)
 {
-    lockSessionMap();
+    std::vector<HeartbeatEntry> dueEntries;
 
-    std::map<uint32_t, Session*>::iterator it;
-    for(it = m_sessions.begin();
-        it != m_sessions.end();
-        it++)
+    while(m_heartbeat_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_heartbeatQueue.empty() == false
+          && m_heartbeatQueue.begin()->tick <= tick)
     {
-        it->second->sendHeartbeat();
+        const HeartbeatEntry entry = *m_heartbeatQueue.begin();
+        entry.session->addReference();
+        dueEntries.push_back(entry);
+        m_heartbeatQueue.erase(m_heartbeatQueue.begin());
+        m_heartbeatEntries.erase(entry.session);
     }
+    m_heartbeat_lock.clear(std::memory_order_release);
 
-    unlockSessionMap();
+    for(HeartbeatEntry &entry : dueEntries)
+    {
+        Session* session = entry.session;
+
+        // channels are covered by the heartbeats of their parent and are not checked again
+        if(session->m_parentSession == nullptr)
+        {
+            session->checkHeartbeat(tick);
+
+            // sessions, which are not ready yet, are checked again in the next tick
+            entry.tick = std::max(session->m_nextHeartbeatTick, tick + 1);
+
+            // a session, which was removed in the meantime, doesn't get a new entry. Otherwise
+            // the removal comes after this and removes the new entry.
+            while(m_heartbeat_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+            if(m_sessions.getSession(entry.sessionId) == session)
+            {
+                m_heartbeatQueue.insert(entry);
+                m_heartbeatEntries[session] = entry;
+            }
+            m_heartbeat_lock.clear(std::memory_order_release);
+        }
+
+        session->releaseReference();
+    }
 }
 
 /**
@@ -249,7 +492,7 @@ SessionHandler::sendMessage(Session* session,
     if(header.flags & 0x1)
     {
         SessionHandler::m_replyHandler->addMessage(header.type,
-                                                   header.sessionId,
+                                                   session->m_localSessionId,
                                                    header.messageId,
                                                    session);
     }
@@ -257,5 +500,57 @@ SessionHandler::sendMessage(Session* session,
     return session->m_socket->sendMessage(data, size);
 }
 
+/**
+ * @brief send already built messages, which are shared between multiple sessions. Only the
+ *        session- and message-ids and the reply-flag within the headers are set for the session,
+ *        before all messages are send with a single write.
+ *
+ * @param session pointer to the session
+ * @param data buffer with the complete messages
+ * @param size total number of bytes of all messages
+ * @param messagePositions positions of the messages within the buffer
+ * @param deliveryAssurance delivery-assurance of single-block-messages or 0 to use the one of
+ *                          the session
+ *
+ * @return false, if send failed, else true
+ */
+bool
+SessionHandler::sendPreparedMessages(Session* session,
+                                     uint8_t* data,
+                                     const uint64_t size,
+                                     const std::vector<uint64_t> &messagePositions,
+                                     const uint8_t deliveryAssurance)
+{
+    const Session::deliveryAssurances assurance =
+            static_cast<Session::deliveryAssurances>(deliveryAssurance);
+
+    for(const uint64_t position : messagePositions)
+    {
+        CommonMessageHeader* header = reinterpret_cast<CommonMessageHeader*>(&data[position]);
+        header->sessionId = session->sessionId();
+        header->messageId = session->increaseMessageIdCounter();
+
+        // the delivery-assurance of single-block-messages depends on the target-session
+        if(header->type == SINGLEBLOCK_DATA_TYPE)
+        {
+            if(session->isReplyExpected(assurance)) {
+                header->flags |= 0x1;
+            } else {
+                header->flags &= ~0x1;
+            }
+        }
+
+        if(header->flags & 0x1)
+        {
+            SessionHandler::m_replyHandler->addMessage(header->type,
+                                                       session->m_localSessionId,
+                                                       header->messageId,
+                                                       session);
+        }
+    }
+
+    return session->m_socket->sendMessage(data, size);
+}
+
 } // namespace Sakura
 } // namespace Kitsunemimi
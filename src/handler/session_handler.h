@@ -27,18 +27,78 @@
 #include <vector>
 #include <map>
 #include <atomic>
+#include <deque>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <chrono>
 #include <message_definitions.h>
+#include <handler/session_registry.h>
+
+// time in seconds, which a closed server-side session is held back, until it is reused, because
+// other threads can still have a pointer to it
+#define SESSION_QUARANTINE_TIME 10
+#define MAX_RECYCLED_SESSIONS 1024
+
+// minimum and maximum interval of the heartbeats in ticks of the heartbeat-timer (100 ms)
+#define HEARTBEAT_MIN_INTERVAL 10u
+#define HEARTBEAT_MAX_INTERVAL 300u
+
+// default bounds of the adaptive timeouts and the timeout of the reply-tracking before the first
+// measurement in milliseconds
+#define DEFAULT_MIN_TIMEOUT 200u
+#define DEFAULT_MAX_TIMEOUT 60000u
+#define INITIAL_REPLY_TIMEOUT 2000u
+// minimum variance-part of the adaptive timeouts in microseconds, which is the resolution of the
+// timer-threads
+#define TIMEOUT_GRANULARITY 100000u
+// upper bound of the backoff-multiplier of the adaptive timeouts after consecutive timeouts
+#define MAX_TIMEOUT_BACKOFF 64u
+
+// number of latest request-latencies of a session, which are used for percentiles
+#define REQUEST_LATENCY_HISTORY 128
+// minimum number of latencies, before a percentile is used as delay of hedged requests
+#define MIN_HEDGE_SAMPLES 20
+// default percentage of hedged requests, which are allowed to send a duplicate, and the maximum
+// number of duplicates, which can be saved up by requests without duplicate
+#define DEFAULT_HEDGE_BUDGET 10u
+#define MAX_HEDGE_BURST 10u
+
+// time in milliseconds, how long the cancel-mark of a request of the other side is kept and how
+// long the state of a request is kept after its deadline, if the request is never answered
+#define REQUEST_STATE_LIFETIME 60000u
+// number of request-states of a session, from which on expired states are purged, and the maximum
+// number of states, from which on the states with the earliest expiry are dropped
+#define MIN_REQUEST_STATE_PURGE 4096u
+#define MAX_REQUEST_STATES 65536u
+
+// cost of a request for the deficit-round-robin of the request-scheduler is a base-cost plus its
+// size in bytes. Each session gets the quantum per turn.
+#define REQUEST_BASE_COST 4096u
+#define REQUEST_QUANTUM 65536u
+
+// number of worker-threads, which send the published messages to the subscribers, and maximum
+// number of messages, which are send to one subscriber before the next one is served
+#define TOPIC_WORKER_THREADS 4
+#define TOPIC_MESSAGES_PER_TURN 16
+
+// number of released session-ids, which are held back before the first one is reused
+#define MIN_FREE_SESSION_IDS 65536
 
 namespace Kitsunemimi
 {
 namespace Network {
 class AbstractServer;
+class AbstractSocket;
 }
 namespace Sakura
 {
 class Session;
 class ReplyHandler;
 class MessageBlockerHandler;
+class TopicHandler;
+class RequestScheduler;
+class RpcDispatcher;
 class SessionController;
 
 class SessionHandler
@@ -47,6 +107,9 @@ public:
 
     static Kitsunemimi::Sakura::ReplyHandler* m_replyHandler;
     static Kitsunemimi::Sakura::MessageBlockerHandler* m_blockerHandler;
+    static Kitsunemimi::Sakura::TopicHandler* m_topicHandler;
+    static Kitsunemimi::Sakura::RequestScheduler* m_requestScheduler;
+    static Kitsunemimi::Sakura::RpcDispatcher* m_rpcDispatcher;
     static Kitsunemimi::Sakura::SessionController* m_sessionController;
     static Kitsunemimi::Sakura::SessionHandler* m_sessionHandler;
 
@@ -58,31 +121,75 @@ public:
     // session-control
     void addSession(const uint32_t id, Session* session);
     Session* removeSession(const uint32_t id);
-    void sendHeartBeats();
+    Session* getSession(const uint32_t id);
+    std::vector<Session*> getSessions();
+    void releaseSessions(const std::vector<Session*> &sessions);
+    void sendHeartBeats(const uint64_t tick);
+
+    // recycling of server-side sessions
+    Session* createSession(Network::AbstractSocket* socket);
+    void recycleSession(Session* session);
 
-    // counter
-    uint16_t increaseSessionIdCounter();
+    // session-ids
+    uint32_t allocateSessionId();
 
-    void lockSessionMap();
-    void unlockSessionMap();
     void lockServerMap();
     void unlockServerMap();
 
     // object-holder
-    std::map<uint32_t, Session*> m_sessions;
-    std::map<uint32_t, Network::AbstractServer*> m_servers;
+    SessionRegistry m_sessions;
+    std::map<uint32_t, std::vector<Network::AbstractServer*>> m_servers;
 
     bool sendMessage(Session *session,
                      const CommonMessageHeader &header,
                      const void* data,
                      const uint64_t size);
+    bool sendPreparedMessages(Session* session,
+                              uint8_t* data,
+                              const uint64_t size,
+                              const std::vector<uint64_t> &messagePositions,
+                              const uint8_t deliveryAssurance = 0);
 private:
-    // counter
-    uint16_t m_sessionIdCounter = 0;
-    std::atomic_flag m_sessionMap_lock = ATOMIC_FLAG_INIT;
+    // session-ids
+    uint32_t m_sessionIdCounter = 0;
+    std::deque<uint32_t> m_freeSessionIds;
     std::atomic_flag m_serverMap_lock = ATOMIC_FLAG_INIT;
     std::atomic_flag m_sessionIdCounter_lock = ATOMIC_FLAG_INIT;
 
+    // closed server-side sessions
+    struct QuarantinedSession
+    {
+        Session* session = nullptr;
+        std::chrono::steady_clock::time_point closeTime;
+    };
+    std::atomic_flag m_recycle_lock = ATOMIC_FLAG_INIT;
+    std::deque<QuarantinedSession> m_quarantine;
+    std::vector<Session*> m_recycledSessions;
+
+    void releaseQuarantine(std::vector<Session*> &sessionsToDelete);
+    void deleteSessions(const std::vector<Session*> &sessions);
+
+    // registered sessions ordered by the tick of their next heartbeat-check, so each timer-step
+    // only visits the sessions, which are due. The entry of a session is removed together with
+    // its registration, so the queue never points to a deleted session.
+    struct HeartbeatEntry
+    {
+        uint64_t tick = 0;
+        uint32_t sessionId = 0;
+        Session* session = nullptr;
+
+        bool operator<(const HeartbeatEntry &other) const
+        {
+            if(tick != other.tick) {
+                return tick < other.tick;
+            }
+            return session < other.session;
+        }
+    };
+    std::atomic_flag m_heartbeat_lock = ATOMIC_FLAG_INIT;
+    std::set<HeartbeatEntry> m_heartbeatQueue;
+    std::unordered_map<Session*, HeartbeatEntry> m_heartbeatEntries;
+
     // callbacks
     void (*m_processCreateSession)(Session*, const std::string);
     void (*m_processCloseSession)(Session*, const std::string);
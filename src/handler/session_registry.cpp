@@ -0,0 +1,200 @@
+/**
+ * @file       session_registry.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "session_registry.h"
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+SessionRegistry::SessionRegistry() {}
+
+/**
+ * @brief destructor
+ */
+SessionRegistry::~SessionRegistry()
+{
+    clear();
+}
+
+/**
+ * @brief add a session to the registry
+ *
+ * @param id id of the session
+ * @param session pointer to the session
+ *
+ * @return false, if id is already registered, else true
+ */
+bool
+SessionRegistry::addSession(const uint32_t id, Session* session)
+{
+    Shard* shard = lockShard(id);
+    const bool ret = shard->sessions.insert(std::make_pair(id, session)).second;
+    unlockShard(shard);
+
+    return ret;
+}
+
+/**
+ * @brief remove a session from the registry
+ *
+ * @param id id of the session
+ *
+ * @return pointer to the removed session, if found, else nullptr
+ */
+Session*
+SessionRegistry::removeSession(const uint32_t id)
+{
+    Session* ret = nullptr;
+
+    Shard* shard = lockShard(id);
+    std::unordered_map<uint32_t, Session*>::iterator it;
+    it = shard->sessions.find(id);
+    if(it != shard->sessions.end())
+    {
+        ret = it->second;
+        shard->sessions.erase(it);
+    }
+    unlockShard(shard);
+
+    return ret;
+}
+
+/**
+ * @brief get a session by its id. Only the shard of the id is locked and only for the lookup, so
+ *        lookups of different sessions don't block each other.
+ *
+ * @param id id of the session
+ *
+ * @return pointer to the session, if found, else nullptr
+ */
+Session*
+SessionRegistry::getSession(const uint32_t id)
+{
+    Session* ret = nullptr;
+
+    Shard* shard = lockShard(id);
+    std::unordered_map<uint32_t, Session*>::const_iterator it;
+    it = shard->sessions.find(id);
+    if(it != shard->sessions.end()) {
+        ret = it->second;
+    }
+    unlockShard(shard);
+
+    return ret;
+}
+
+/**
+ * @brief get a copy of all registered sessions for maintenance-tasks. The shards are locked one
+ *        after another and only while copying, so the work on the sessions of the snapshot
+ *        doesn't block any other access to the registry. Each session gets a reference while its
+ *        shard is locked, so it is not reused or deleted, even if it is closed in the meantime.
+ *        The caller has to release the references with releaseSnapshot.
+ *
+ * @return list with all registered sessions
+ */
+std::vector<Session*>
+SessionRegistry::getSnapshot()
+{
+    std::vector<Session*> result;
+
+    for(uint32_t i = 0; i < NUMBER_OF_REGISTRY_SHARDS; i++)
+    {
+        Shard* shard = lockShard(i);
+        std::unordered_map<uint32_t, Session*>::const_iterator it;
+        for(it = shard->sessions.begin();
+            it != shard->sessions.end();
+            it++)
+        {
+            it->second->addReference();
+            result.push_back(it->second);
+        }
+        unlockShard(shard);
+    }
+
+    return result;
+}
+
+/**
+ * @brief release the references of the sessions of a snapshot
+ *
+ * @param snapshot list of sessions, which was returned by getSnapshot
+ */
+void
+SessionRegistry::releaseSnapshot(const std::vector<Session*> &snapshot)
+{
+    for(Session* session : snapshot) {
+        session->releaseReference();
+    }
+}
+
+/**
+ * @brief remove all sessions from the registry
+ */
+void
+SessionRegistry::clear()
+{
+    for(uint32_t i = 0; i < NUMBER_OF_REGISTRY_SHARDS; i++)
+    {
+        Shard* shard = lockShard(i);
+        shard->sessions.clear();
+        unlockShard(shard);
+    }
+}
+
+/**
+ * @brief lock the shard of an id
+ *
+ * @param id session-id
+ *
+ * @return locked shard
+ */
+SessionRegistry::Shard*
+SessionRegistry::lockShard(const uint32_t id)
+{
+    Shard* shard = &m_shards[id % NUMBER_OF_REGISTRY_SHARDS];
+    while(shard->lock.test_and_set(std::memory_order_acquire)) {
+        asm("");
+    }
+
+    return shard;
+}
+
+/**
+ * @brief unlock a shard
+ *
+ * @param shard shard to unlock
+ */
+void
+SessionRegistry::unlockShard(Shard* shard)
+{
+    shard->lock.clear(std::memory_order_release);
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,369 @@
+/**
+ * @file       topic_handler.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <handler/topic_handler.h>
+#include <handler/topic_subscriber.h>
+#include <handler/topic_worker.h>
+#include <handler/session_handler.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ */
+TopicHandler::TopicHandler()
+{
+    for(uint32_t i = 0; i < TOPIC_WORKER_THREADS; i++)
+    {
+        TopicWorker* worker = new TopicWorker(this);
+        worker->startThread();
+        m_workers.push_back(worker);
+    }
+}
+
+/**
+ * @brief destructor
+ */
+TopicHandler::~TopicHandler()
+{
+    // the workers use the handler, so they have to be stopped before
+    for(TopicWorker* worker : m_workers)
+    {
+        worker->stopThread();
+        delete worker;
+    }
+    m_workers.clear();
+    m_readySubscribers.clear();
+
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<Session*, std::shared_ptr<TopicSubscriber>>::iterator it;
+    for(it = m_subscribers.begin();
+        it != m_subscribers.end();
+        it++)
+    {
+        it->second->close();
+    }
+
+    m_topics.clear();
+    m_subscribers.clear();
+
+    m_topic_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief subscribe a session to a topic. Each subscribed session gets its own bounded queue,
+ *        which is send by the shared worker-threads of the topic-handler.
+ *
+ * @param session session of the subscriber
+ * @param topic name of the topic
+ * @param blockWhenFull true to block the publisher, while the queue of the subscriber is full,
+ *                      false to drop messages for the subscriber in this case
+ *
+ * @return false, if session is already subscribed to the topic, else true
+ */
+bool
+TopicHandler::subscribe(Session* session,
+                        const std::string &topic,
+                        const bool blockWhenFull)
+{
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    // get or create sender of the session
+    std::shared_ptr<TopicSubscriber> subscriber;
+    std::map<Session*, std::shared_ptr<TopicSubscriber>>::iterator subscriberIt;
+    subscriberIt = m_subscribers.find(session);
+    if(subscriberIt != m_subscribers.end())
+    {
+        subscriber = subscriberIt->second;
+    }
+    else
+    {
+        subscriber = std::make_shared<TopicSubscriber>(session, m_maxQueueSize);
+        m_subscribers.insert(std::make_pair(session, subscriber));
+    }
+
+    // check if already subscribed
+    std::vector<Subscription>& subscriptions = m_topics[topic];
+    for(const Subscription &subscription : subscriptions)
+    {
+        if(subscription.subscriber == subscriber)
+        {
+            m_topic_lock.clear(std::memory_order_release);
+            return false;
+        }
+    }
+
+    Subscription newSubscription;
+    newSubscription.subscriber = subscriber;
+    newSubscription.blockWhenFull = blockWhenFull;
+    subscriptions.push_back(newSubscription);
+
+    m_topic_lock.clear(std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief unsubscribe a session from a topic
+ *
+ * @param session session of the subscriber
+ * @param topic name of the topic
+ *
+ * @return false, if session was not subscribed to the topic, else true
+ */
+bool
+TopicHandler::unsubscribe(Session* session,
+                          const std::string &topic)
+{
+    bool result = false;
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<std::string, std::vector<Subscription>>::iterator topicIt;
+    topicIt = m_topics.find(topic);
+    if(topicIt != m_topics.end())
+    {
+        std::vector<Subscription>::iterator it;
+        for(it = topicIt->second.begin();
+            it != topicIt->second.end();
+            it++)
+        {
+            if(it->subscriber->m_session == session)
+            {
+                topicIt->second.erase(it);
+                result = true;
+                break;
+            }
+        }
+
+        if(topicIt->second.size() == 0) {
+            m_topics.erase(topicIt);
+        }
+    }
+
+    // remove sender of the session, if there are no other subscriptions
+    if(result
+            && isSubscribed(session) == false)
+    {
+        std::map<Session*, std::shared_ptr<TopicSubscriber>>::iterator subscriberIt;
+        subscriberIt = m_subscribers.find(session);
+        if(subscriberIt != m_subscribers.end())
+        {
+            subscriberIt->second->close();
+            m_subscribers.erase(subscriberIt);
+        }
+    }
+
+    m_topic_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief remove all subscriptions of a session
+ *
+ * @param session session of the subscriber
+ */
+void
+TopicHandler::removeSession(Session* session)
+{
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<Session*, std::shared_ptr<TopicSubscriber>>::iterator subscriberIt;
+    subscriberIt = m_subscribers.find(session);
+    if(subscriberIt == m_subscribers.end())
+    {
+        m_topic_lock.clear(std::memory_order_release);
+        return;
+    }
+
+    std::shared_ptr<TopicSubscriber> subscriber = subscriberIt->second;
+    subscriber->close();
+    m_subscribers.erase(subscriberIt);
+
+    // remove session from all topics
+    std::map<std::string, std::vector<Subscription>>::iterator topicIt;
+    topicIt = m_topics.begin();
+    while(topicIt != m_topics.end())
+    {
+        std::vector<Subscription>::iterator it;
+        for(it = topicIt->second.begin();
+            it != topicIt->second.end();
+            it++)
+        {
+            if(it->subscriber == subscriber)
+            {
+                topicIt->second.erase(it);
+                break;
+            }
+        }
+
+        if(topicIt->second.size() == 0) {
+            topicIt = m_topics.erase(topicIt);
+        } else {
+            topicIt++;
+        }
+    }
+
+    m_topic_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief send a message to all subscribers of a topic. The encoded message is shared between the
+ *        queues of all subscribers. The lock is only held to get the subscribers, so blocking
+ *        subscribers don't prevent changes of the subscriptions.
+ *
+ * @param topic name of the topic
+ * @param message complete encoded message
+ *
+ * @return number of subscribers, which got the message
+ */
+uint32_t
+TopicHandler::publish(const std::string &topic,
+                      const std::shared_ptr<const std::vector<uint8_t>> &message)
+{
+    uint32_t result = 0;
+    std::vector<Subscription> subscriptions;
+
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::map<std::string, std::vector<Subscription>>::const_iterator topicIt;
+    topicIt = m_topics.find(topic);
+    if(topicIt != m_topics.end()) {
+        subscriptions = topicIt->second;
+    }
+    m_topic_lock.clear(std::memory_order_release);
+
+    for(const Subscription &subscription : subscriptions)
+    {
+        if(subscription.subscriber->addMessage(message, subscription.blockWhenFull))
+        {
+            scheduleSubscriber(subscription.subscriber);
+            result++;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief add a subscriber with waiting messages to the queue of the worker-threads, if it is not
+ *        already scheduled
+ *
+ * @param subscriber subscriber with waiting messages
+ */
+void
+TopicHandler::scheduleSubscriber(const std::shared_ptr<TopicSubscriber> &subscriber)
+{
+    if(subscriber->markScheduled() == false) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(m_readyMutex);
+    m_readySubscribers.push_back(subscriber);
+    m_readyCv.notify_one();
+}
+
+/**
+ * @brief send a limited number of waiting messages of the next scheduled subscriber. Called by
+ *        the worker-threads in a loop. A subscriber with more waiting messages is added to the
+ *        end of the queue again, so all subscribers are served round-robin and a subscriber is
+ *        never send by two workers at the same time.
+ *
+ * @param sendBuffer buffer of the worker to build the messages for the subscriber
+ */
+void
+TopicHandler::sendNextMessages(std::vector<uint8_t> &sendBuffer)
+{
+    std::shared_ptr<TopicSubscriber> subscriber;
+
+    // wait with timeout to give the worker the chance to check its abort-flag
+    {
+        std::unique_lock<std::mutex> lock(m_readyMutex);
+        if(m_readySubscribers.empty())
+        {
+            m_readyCv.wait_for(lock, std::chrono::milliseconds(10));
+            if(m_readySubscribers.empty()) {
+                return;
+            }
+        }
+
+        subscriber = m_readySubscribers.front();
+        m_readySubscribers.pop_front();
+    }
+
+    if(subscriber->sendMessages(TOPIC_MESSAGES_PER_TURN, sendBuffer))
+    {
+        std::lock_guard<std::mutex> guard(m_readyMutex);
+        m_readySubscribers.push_back(subscriber);
+        m_readyCv.notify_one();
+    }
+}
+
+/**
+ * @brief set maximum number of messages, which can wait to be send to a subscriber. This affects
+ *        only subscribers, which are created afterwards.
+ *
+ * @param maxQueueSize new maximum queue-size
+ */
+void
+TopicHandler::setMaxQueueSize(const uint32_t maxQueueSize)
+{
+    while(m_topic_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_maxQueueSize = maxQueueSize;
+    m_topic_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief check if a session has at least one subscription (must be called with held lock)
+ *
+ * @param session session of the subscriber
+ *
+ * @return true, if subscribed to at least one topic, else false
+ */
+bool
+TopicHandler::isSubscribed(Session* session)
+{
+    std::map<std::string, std::vector<Subscription>>::const_iterator topicIt;
+    for(topicIt = m_topics.begin();
+        topicIt != m_topics.end();
+        topicIt++)
+    {
+        for(const Subscription &subscription : topicIt->second)
+        {
+            if(subscription.subscriber->m_session == session) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,94 @@
+/**
+ * @file       topic_handler.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef TOPIC_HANDLER_H
+#define TOPIC_HANDLER_H
+
+#include <iostream>
+#include <atomic>
+#include <map>
+#include <vector>
+#include <memory>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+class TopicSubscriber;
+class TopicWorker;
+
+class TopicHandler
+{
+public:
+    TopicHandler();
+    ~TopicHandler();
+
+    // subscriptions
+    bool subscribe(Session* session,
+                   const std::string &topic,
+                   const bool blockWhenFull);
+    bool unsubscribe(Session* session,
+                     const std::string &topic);
+    void removeSession(Session* session);
+
+    // publish
+    uint32_t publish(const std::string &topic,
+                     const std::shared_ptr<const std::vector<uint8_t>> &message);
+
+    void setMaxQueueSize(const uint32_t maxQueueSize);
+
+    // called by the worker-threads
+    void sendNextMessages(std::vector<uint8_t> &sendBuffer);
+
+private:
+    struct Subscription
+    {
+        std::shared_ptr<TopicSubscriber> subscriber;
+        bool blockWhenFull = false;
+    };
+
+    uint32_t m_maxQueueSize = 1024;
+
+    std::atomic_flag m_topic_lock = ATOMIC_FLAG_INIT;
+    std::map<std::string, std::vector<Subscription>> m_topics;
+    std::map<Session*, std::shared_ptr<TopicSubscriber>> m_subscribers;
+
+    // subscribers with waiting messages, which are served round-robin by a shared pool of
+    // worker-threads
+    std::vector<TopicWorker*> m_workers;
+    std::mutex m_readyMutex;
+    std::condition_variable m_readyCv;
+    std::deque<std::shared_ptr<TopicSubscriber>> m_readySubscribers;
+
+    bool isSubscribed(Session* session);
+    void scheduleSubscriber(const std::shared_ptr<TopicSubscriber> &subscriber);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // TOPIC_HANDLER_H
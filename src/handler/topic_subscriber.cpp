@@ -0,0 +1,183 @@
+/**
+ * @file       topic_subscriber.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <handler/topic_subscriber.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <message_definitions.h>
+
+#include <libKitsunemimiNetwork/abstract_socket.h>
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param session session of the subscriber
+ * @param maxQueueSize maximum number of messages, which can wait to be send to the subscriber
+ */
+TopicSubscriber::TopicSubscriber(Session* session,
+                                 const uint32_t maxQueueSize)
+{
+    m_session = session;
+    m_maxQueueSize = maxQueueSize;
+    m_session->addReference();
+}
+
+/**
+ * @brief destructor, which is called, when the last publisher and worker has released the
+ *        subscriber
+ */
+TopicSubscriber::~TopicSubscriber()
+{
+    m_session->releaseReference();
+}
+
+/**
+ * @brief add a published message to the queue of the subscriber
+ *
+ * @param message encoded message, which is shared between all subscribers of the topic
+ * @param blockWhenFull true to wait until there is space in the queue, false to drop the
+ *                      message, if the queue is full
+ *
+ * @return false, if the message was dropped, else true
+ */
+bool
+TopicSubscriber::addMessage(const std::shared_ptr<const std::vector<uint8_t>> &message,
+                            const bool blockWhenFull)
+{
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    if(blockWhenFull)
+    {
+        m_queueCv.wait(lock, [this] {
+            return m_closed || m_queue.size() < m_maxQueueSize;
+        });
+    }
+
+    if(m_closed
+            || m_queue.size() >= m_maxQueueSize)
+    {
+        return false;
+    }
+
+    m_queue.push_back(message);
+
+    return true;
+}
+
+/**
+ * @brief mark the subscriber as scheduled for the worker-threads of the topic-handler
+ *
+ * @return true, if the subscriber has waiting messages and was not already scheduled, else false
+ */
+bool
+TopicSubscriber::markScheduled()
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+
+    if(m_scheduled
+            || m_closed
+            || m_queue.empty())
+    {
+        return false;
+    }
+
+    m_scheduled = true;
+
+    return true;
+}
+
+/**
+ * @brief send waiting messages of the queue. Called by the worker-threads of the topic-handler.
+ *        Each message is copied into the send-buffer of the worker, to replace the session-id
+ *        and message-id of the publisher by the values of the subscriber.
+ *
+ * @param maxMessages maximum number of messages to send in this turn
+ * @param sendBuffer buffer of the worker to build the message for the subscriber
+ *
+ * @return true, if there are still waiting messages and the subscriber stays scheduled, else
+ *         false
+ */
+bool
+TopicSubscriber::sendMessages(const uint32_t maxMessages,
+                              std::vector<uint8_t> &sendBuffer)
+{
+    for(uint32_t i = 0; i < maxMessages; i++)
+    {
+        std::shared_ptr<const std::vector<uint8_t>> message;
+
+        {
+            std::lock_guard<std::mutex> guard(m_queueMutex);
+            if(m_closed
+                    || m_queue.empty())
+            {
+                break;
+            }
+
+            message = m_queue.front();
+            m_queue.pop_front();
+
+            // release publishers, which are waiting for space in the queue
+            m_queueCv.notify_all();
+        }
+
+        sendBuffer.assign(message->begin(), message->end());
+        CommonMessageHeader* header = reinterpret_cast<CommonMessageHeader*>(&sendBuffer[0]);
+        header->sessionId = m_session->sessionId();
+        header->messageId = m_session->increaseMessageIdCounter();
+
+        if(m_session->m_socket->sendMessage(&sendBuffer[0], sendBuffer.size()) == false) {
+            LOG_WARNING("failed to send published message to session "
+                        + std::to_string(m_session->sessionId()));
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    if(m_closed
+            || m_queue.empty())
+    {
+        m_scheduled = false;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief close the queue, drop all waiting messages and release all blocked publishers
+ */
+void
+TopicSubscriber::close()
+{
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_closed = true;
+    m_queue.clear();
+    m_queueCv.notify_all();
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,69 @@
+/**
+ * @file       topic_subscriber.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef TOPIC_SUBSCRIBER_H
+#define TOPIC_SUBSCRIBER_H
+
+#include <iostream>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class Session;
+
+class TopicSubscriber
+{
+public:
+    TopicSubscriber(Session* session,
+                    const uint32_t maxQueueSize);
+    ~TopicSubscriber();
+
+    Session* m_session = nullptr;
+
+    bool addMessage(const std::shared_ptr<const std::vector<uint8_t>> &message,
+                    const bool blockWhenFull);
+    bool markScheduled();
+    bool sendMessages(const uint32_t maxMessages,
+                      std::vector<uint8_t> &sendBuffer);
+    void close();
+
+private:
+    uint32_t m_maxQueueSize = 0;
+    bool m_closed = false;
+    // true, while the subscriber is within the queue of the topic-handler or sending
+    bool m_scheduled = false;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::deque<std::shared_ptr<const std::vector<uint8_t>>> m_queue;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // TOPIC_SUBSCRIBER_H
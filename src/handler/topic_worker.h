@@ -0,0 +1,54 @@
+/**
+ * @file       topic_worker.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef TOPIC_WORKER_H
+#define TOPIC_WORKER_H
+
+#include <vector>
+#include <stdint.h>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+class TopicHandler;
+
+class TopicWorker
+        : public Kitsunemimi::Thread
+{
+public:
+    TopicWorker(TopicHandler* topicHandler);
+
+protected:
+    void run();
+
+private:
+    TopicHandler* m_topicHandler = nullptr;
+    std::vector<uint8_t> m_sendBuffer;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // TOPIC_WORKER_H
@@ -0,0 +1,150 @@
+/**
+ * @file       kernel_tls.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "kernel_tls.h"
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <openssl/opensslv.h>
+#include <openssl/ssl.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+namespace
+{
+std::mutex g_kernelTlsMutex;
+bool g_kernelTlsChecked = false;
+bool g_kernelTlsSupported = false;
+
+/**
+ * @brief check if the kernel provides the tls upper-layer-protocol. On an unconnected socket the
+ *        kernel answers with ENOTCONN, if the tls-module is available, and with ENOENT if not.
+ *
+ * @return true, if the kernel supports kTLS, else false
+ */
+bool
+checkKernelSupport()
+{
+    const int testSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(testSocket < 0) {
+        return false;
+    }
+
+    const int ret = setsockopt(testSocket, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+    const int error = errno;
+    close(testSocket);
+
+    return ret == 0 || error == ENOTCONN;
+}
+}
+
+/**
+ * @brief check if kTLS can be used by the sessions. This requires an openssl-library with
+ *        kTLS-support and a kernel, which provides the tls upper-layer-protocol. The result is
+ *        checked only once and cached afterwards.
+ *
+ * @return true, if kTLS is supported, else false
+ */
+bool
+isKernelTlsSupported()
+{
+    std::lock_guard<std::mutex> guard(g_kernelTlsMutex);
+
+    if(g_kernelTlsChecked) {
+        return g_kernelTlsSupported;
+    }
+    g_kernelTlsChecked = true;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+    g_kernelTlsSupported = checkKernelSupport();
+    if(g_kernelTlsSupported == false) {
+        LOG_WARNING("kTLS is not supported by the kernel");
+    }
+#else
+    LOG_WARNING("kTLS is not supported by the used openssl-library");
+    g_kernelTlsSupported = false;
+#endif
+
+    return g_kernelTlsSupported;
+}
+
+/**
+ * @brief create a new ssl-context with kTLS enabled. The option is set only for this context, so
+ *        other tls-contexts of the process and the openssl-config of the application are not
+ *        affected. After the handshake openssl installs the negotiated keys into the kernel. If
+ *        the kernel doesn't accept the keys for a specific connection, for example because of an
+ *        unsupported cipher, openssl falls back to user-space encryption for this connection.
+ *
+ * @param isServerSide true to create a context for accepted connections
+ * @param certFile certificate-file for tls-encryption
+ * @param keyFile key-file for tls-encryption
+ *
+ * @return new context or nullptr, if the context could not be created
+ */
+SSL_CTX*
+createKernelTlsContext(const bool isServerSide,
+                       const std::string &certFile,
+                       const std::string &keyFile)
+{
+    OPENSSL_init_ssl(0, nullptr);
+
+    SSL_CTX* ctx = SSL_CTX_new(isServerSide ? TLS_server_method() : TLS_client_method());
+    if(ctx == nullptr)
+    {
+        LOG_ERROR("Failed to create ssl-context for kTLS");
+        return nullptr;
+    }
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+    if(SSL_CTX_use_certificate_file(ctx, certFile.c_str(), SSL_FILETYPE_PEM) <= 0
+            || SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) <= 0)
+    {
+        LOG_ERROR("Failed to load certificate or key for kTLS");
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+
+    return ctx;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,42 @@
+/**
+ * @file       kernel_tls.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef KERNEL_TLS_H
+#define KERNEL_TLS_H
+
+#include <string>
+#include <openssl/ssl.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+bool isKernelTlsSupported();
+SSL_CTX* createKernelTlsContext(const bool isServerSide,
+                                const std::string &certFile,
+                                const std::string &keyFile);
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // KERNEL_TLS_H
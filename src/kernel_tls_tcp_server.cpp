@@ -0,0 +1,117 @@
+/**
+ * @file       kernel_tls_tcp_server.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "kernel_tls_tcp_server.h"
+#include "kernel_tls_tcp_socket.h"
+#include "kernel_tls.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param target target for the callback, which is triggered for each new connection
+ * @param processConnection callback for new incoming connections
+ * @param certFile certificate-file for tls-encryption
+ * @param keyFile key-file for tls-encryption
+ */
+KernelTlsTcpServer::KernelTlsTcpServer(void* target,
+                                       void (*processConnection)(void*,
+                                                                 Network::AbstractSocket*),
+                                       const std::string &certFile,
+                                       const std::string &keyFile)
+    : Network::TcpServer(target, processConnection)
+{
+    m_certFile = certFile;
+    m_keyFile = keyFile;
+}
+
+/**
+ * @brief destructor. Accepted connections keep their own reference to the ssl-context.
+ */
+KernelTlsTcpServer::~KernelTlsTcpServer()
+{
+    if(m_ctx != nullptr) {
+        SSL_CTX_free(m_ctx);
+    }
+}
+
+/**
+ * @brief create the ssl-context and the listen-socket
+ *
+ * @param port port where the server should listen
+ *
+ * @return false, if the ssl-context or the listen-socket could not be created, else true
+ */
+bool
+KernelTlsTcpServer::initServer(const uint16_t port)
+{
+    m_ctx = createKernelTlsContext(true, m_certFile, m_keyFile);
+    if(m_ctx == nullptr) {
+        return false;
+    }
+
+    return Network::TcpServer::initServer(port);
+}
+
+/**
+ * @brief accept a new connection and run the tls-handshake
+ *
+ * @return new socket or nullptr, if accept or handshake failed
+ */
+Network::AbstractSocket*
+KernelTlsTcpServer::waitForIncomingConnection()
+{
+    struct sockaddr_in client;
+    socklen_t length = sizeof(client);
+    const int fd = accept(m_serverSocket, reinterpret_cast<struct sockaddr*>(&client), &length);
+    if(m_abort) {
+        return nullptr;
+    }
+    if(fd < 0)
+    {
+        LOG_ERROR("Failed accept incoming connection on kTLS-server");
+        return nullptr;
+    }
+
+    KernelTlsTcpSocket* tlsSocket = new KernelTlsTcpSocket(fd, m_ctx);
+    if(tlsSocket->initServerSide() == false)
+    {
+        delete tlsSocket;
+        return nullptr;
+    }
+
+    m_processConnection(m_target, tlsSocket);
+
+    return tlsSocket;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
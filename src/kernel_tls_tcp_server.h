@@ -0,0 +1,62 @@
+/**
+ * @file       kernel_tls_tcp_server.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef KERNEL_TLS_TCP_SERVER_H
+#define KERNEL_TLS_TCP_SERVER_H
+
+#include <string>
+#include <openssl/ssl.h>
+
+#include <libKitsunemimiNetwork/tcp/tcp_server.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief tls-server, whose accepted connections share an ssl-context with kTLS enabled. Listening
+ *        is inherited from the normal tcp-server.
+ */
+class KernelTlsTcpServer
+        : public Network::TcpServer
+{
+public:
+    KernelTlsTcpServer(void* target,
+                       void (*processConnection)(void*, Network::AbstractSocket*),
+                       const std::string &certFile,
+                       const std::string &keyFile);
+    ~KernelTlsTcpServer();
+
+    bool initServer(const uint16_t port);
+    Network::AbstractSocket* waitForIncomingConnection();
+
+private:
+    std::string m_certFile = "";
+    std::string m_keyFile = "";
+    SSL_CTX* m_ctx = nullptr;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // KERNEL_TLS_TCP_SERVER_H
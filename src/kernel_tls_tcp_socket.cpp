@@ -0,0 +1,185 @@
+/**
+ * @file       kernel_tls_tcp_socket.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "kernel_tls_tcp_socket.h"
+#include "kernel_tls.h"
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor for the client-side
+ *
+ * @param address address of the server
+ * @param port port of the server
+ * @param certFile certificate-file for tls-encryption
+ * @param keyFile key-file for tls-encryption
+ */
+KernelTlsTcpSocket::KernelTlsTcpSocket(const std::string &address,
+                                       const uint16_t port,
+                                       const std::string &certFile,
+                                       const std::string &keyFile)
+    : Network::TcpSocket(address, port)
+{
+    m_certFile = certFile;
+    m_keyFile = keyFile;
+}
+
+/**
+ * @brief constructor for the server-side
+ *
+ * @param socketFd file-descriptor of the accepted connection
+ * @param ctx ssl-context of the server, which is referenced by the ssl-object of the connection
+ */
+KernelTlsTcpSocket::KernelTlsTcpSocket(const int socketFd,
+                                       SSL_CTX* ctx)
+    : Network::TcpSocket(socketFd)
+{
+    SSL_CTX_up_ref(ctx);
+    m_ctx = ctx;
+}
+
+/**
+ * @brief destructor
+ */
+KernelTlsTcpSocket::~KernelTlsTcpSocket()
+{
+    if(m_ssl != nullptr)
+    {
+        SSL_shutdown(m_ssl);
+        SSL_free(m_ssl);
+    }
+
+    if(m_ctx != nullptr) {
+        SSL_CTX_free(m_ctx);
+    }
+}
+
+/**
+ * @brief connect to the server and run the client-side of the tls-handshake
+ *
+ * @return false, if connecting or the handshake failed, else true
+ */
+bool
+KernelTlsTcpSocket::initClientSide()
+{
+    if(m_ssl != nullptr) {
+        return true;
+    }
+
+    if(Network::TcpSocket::initClientSide() == false) {
+        return false;
+    }
+
+    m_ctx = createKernelTlsContext(false, m_certFile, m_keyFile);
+    if(m_ctx == nullptr) {
+        return false;
+    }
+
+    return initSsl(m_socket, false);
+}
+
+/**
+ * @brief run the server-side of the tls-handshake for an accepted connection
+ *
+ * @return false, if the handshake failed, else true
+ */
+bool
+KernelTlsTcpSocket::initServerSide()
+{
+    if(m_ssl != nullptr) {
+        return true;
+    }
+
+    return initSsl(m_socket, true);
+}
+
+/**
+ * @brief create the ssl-object of the connection and run the handshake
+ *
+ * @param socketFd file-descriptor of the connection
+ * @param isServerSide true to accept the handshake, false to initiate it
+ *
+ * @return false, if the handshake failed, else true
+ */
+bool
+KernelTlsTcpSocket::initSsl(const int socketFd,
+                            const bool isServerSide)
+{
+    m_ssl = SSL_new(m_ctx);
+    if(m_ssl == nullptr)
+    {
+        LOG_ERROR("Failed to create ssl-object for kTLS-connection");
+        return false;
+    }
+
+    SSL_set_fd(m_ssl, socketFd);
+    const int ret = isServerSide ? SSL_accept(m_ssl) : SSL_connect(m_ssl);
+    if(ret <= 0)
+    {
+        LOG_ERROR("Failed tls-handshake of kTLS-connection");
+        SSL_free(m_ssl);
+        m_ssl = nullptr;
+        return false;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+    // the kernel can reject the keys, for example because of an unsupported cipher, in which case
+    // openssl stays with the user-space encryption for this connection
+    if(BIO_get_ktls_send(SSL_get_wbio(m_ssl)) == 0) {
+        LOG_WARNING("kTLS not used for connection. Fallback to user-space encryption.");
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * @brief read decrypted data from the connection
+ */
+long
+KernelTlsTcpSocket::recvData(int,
+                             void* bufferPosition,
+                             const size_t bufferSize,
+                             int)
+{
+    return SSL_read(m_ssl, bufferPosition, static_cast<int>(bufferSize));
+}
+
+/**
+ * @brief write data, which are encrypted by the kernel or by openssl, to the connection
+ */
+ssize_t
+KernelTlsTcpSocket::sendData(int,
+                             const void* bufferPosition,
+                             const size_t bufferSize,
+                             int)
+{
+    return SSL_write(m_ssl, bufferPosition, static_cast<int>(bufferSize));
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
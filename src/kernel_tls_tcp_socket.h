@@ -0,0 +1,80 @@
+/**
+ * @file       kernel_tls_tcp_socket.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef KERNEL_TLS_TCP_SOCKET_H
+#define KERNEL_TLS_TCP_SOCKET_H
+
+#include <string>
+#include <openssl/ssl.h>
+
+#include <libKitsunemimiNetwork/tcp/tcp_socket.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief tls-socket with its own ssl-context, which has kTLS enabled. After the handshake openssl
+ *        installs the negotiated keys into the kernel, so the encryption of the records is done
+ *        by the kernel. The option is set only for this context and doesn't affect other
+ *        tls-contexts of the process. The socket-handling is inherited from the normal tcp-socket.
+ */
+class KernelTlsTcpSocket
+        : public Network::TcpSocket
+{
+public:
+    KernelTlsTcpSocket(const std::string &address,
+                       const uint16_t port,
+                       const std::string &certFile,
+                       const std::string &keyFile);
+    KernelTlsTcpSocket(const int socketFd,
+                       SSL_CTX* ctx);
+    ~KernelTlsTcpSocket();
+
+    bool initClientSide();
+    bool initServerSide();
+
+protected:
+    long recvData(int,
+                  void* bufferPosition,
+                  const size_t bufferSize,
+                  int);
+    ssize_t sendData(int,
+                     const void* bufferPosition,
+                     const size_t bufferSize,
+                     int);
+
+private:
+    std::string m_certFile = "";
+    std::string m_keyFile = "";
+    SSL_CTX* m_ctx = nullptr;
+    SSL* m_ssl = nullptr;
+
+    bool initSsl(const int socketFd,
+                 const bool isServerSide);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // KERNEL_TLS_TCP_SOCKET_H
@@ -39,8 +39,12 @@ namespace Sakura
 {
 
 #define MESSAGE_DELIMITER 1314472257
+// version 0x2: heartbeat-messages carry a timestamp, session-init-reply and stripe-join carry a
+//              stripe-token and multiblock-init carries a request-id
+#define PROTOCOL_VERSION 0x2
 #define MESSAGE_CACHE_SIZE (1024*1024)
 #define MAX_SINGLE_MESSAGE_SIZE (128*1024)
+#define MAX_FORWARD_BATCH_SIZE (256*1024)
 
 enum types
 {
@@ -51,6 +55,7 @@ enum types
     STREAM_DATA_TYPE = 4,
     SINGLEBLOCK_DATA_TYPE = 5,
     MULTIBLOCK_DATA_TYPE = 6,
+    PUBSUB_TYPE = 7,
 };
 
 enum session_subTypes
@@ -60,6 +65,9 @@ enum session_subTypes
 
     SESSION_CLOSE_START_SUBTYPE = 3,
     SESSION_CLOSE_REPLY_SUBTYPE = 4,
+
+    SESSION_STRIPE_JOIN_SUBTYPE = 5,
+    SESSION_CHANNEL_INIT_START_SUBTYPE = 6,
 };
 
 enum heartbeat_subTypes
@@ -85,6 +93,8 @@ enum singleblock_data_subTypes
 {
     DATA_SINGLE_DATA_SUBTYPE = 1,
     DATA_SINGLE_REPLY_SUBTYPE = 2,
+    DATA_SINGLE_CANCEL_SUBTYPE = 3,
+    DATA_SINGLE_REJECT_SUBTYPE = 4,
 };
 
 enum multiblock_data_subTypes
@@ -97,6 +107,13 @@ enum multiblock_data_subTypes
     DATA_MULTI_ABORT_REPLY_SUBTYPE = 6,
 };
 
+enum pubsub_subTypes
+{
+    PUBSUB_SUBSCRIBE_SUBTYPE = 1,
+    PUBSUB_UNSUBSCRIBE_SUBTYPE = 2,
+    PUBSUB_PUBLISH_SUBTYPE = 3,
+};
+
 //==================================================================================================
 
 /**
@@ -106,12 +123,13 @@ enum multiblock_data_subTypes
  */
 struct CommonMessageHeader
 {
-    uint8_t version = 0x1;
+    uint8_t version = PROTOCOL_VERSION;
     uint8_t type = 0;
     uint8_t subType = 0;
     uint8_t flags = 0;   // 0x1 = reply required; 0x2 = is reply;
                          // 0x4 = is request; 0x8 = is response
-    uint32_t additionalValues = 0;  // not used at the momment
+    uint32_t additionalValues = 0;  // remaining time-budget of a request or response in
+                                    // milliseconds at sending (0 = no deadline)
     uint32_t sessionId = 0;
     uint32_t messageId = 0;
     uint32_t totalMessageSize = 0;
@@ -125,7 +143,8 @@ struct CommonMessageHeader
  */
 struct CommonMessageFooter
 {
-    uint32_t additionalValues = 0;  // not used at the momment
+    uint32_t additionalValues = 0;  // reserved, because it is only available after the complete
+                                    // message was received, which is too late for a deadline
     const uint32_t delimiter = MESSAGE_DELIMITER;
 } __attribute__((packed));
 
@@ -133,6 +152,9 @@ struct CommonMessageFooter
 
 /**
  * @brief Session_Init_Start_Message
+ *
+ * also used with subtype SESSION_CHANNEL_INIT_START_SUBTYPE to open a new channel over the
+ * connection of an already existing session
  */
 struct Session_Init_Start_Message
 {
@@ -163,6 +185,7 @@ struct Session_Init_Reply_Message
     char sessionIdentifier[64];
     uint32_t sessionIdentifierSize = 0;
     uint8_t padding[4];
+    uint64_t stripeToken = 0;
     CommonMessageFooter commonEnd;
 
     Session_Init_Reply_Message()
@@ -216,6 +239,30 @@ struct Session_Close_Reply_Message
 
 } __attribute__((packed));
 
+/**
+ * @brief Session_Stripe_Join_Message
+ *
+ * first message on an additional connection of an already existing session, which is used as
+ * stripe to transfer parts of multi-block-messages in parallel to the other connections. The
+ * stripe-token was given by the server within the init-reply of the session.
+ */
+struct Session_Stripe_Join_Message
+{
+    CommonMessageHeader commonHeader;
+    uint32_t sessionId = 0;
+    uint8_t padding[4];
+    uint64_t stripeToken = 0;
+    CommonMessageFooter commonEnd;
+
+    Session_Stripe_Join_Message()
+    {
+        commonHeader.type = SESSION_TYPE;
+        commonHeader.subType = SESSION_STRIPE_JOIN_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Session_Stripe_Join_Message);
+    }
+
+} __attribute__((packed));
+
 //==================================================================================================
 
 /**
@@ -224,6 +271,7 @@ struct Session_Close_Reply_Message
 struct Heartbeat_Start_Message
 {
     CommonMessageHeader commonHeader;
+    uint64_t sendTime = 0;
     CommonMessageFooter commonEnd;
 
     Heartbeat_Start_Message()
@@ -242,6 +290,9 @@ struct Heartbeat_Start_Message
 struct Heartbeat_Reply_Message
 {
     CommonMessageHeader commonHeader;
+    uint64_t originSendTime = 0;
+    uint64_t receiveTime = 0;
+    uint64_t replySendTime = 0;
     CommonMessageFooter commonEnd;
 
     Heartbeat_Reply_Message()
@@ -359,7 +410,8 @@ struct Data_SingleBlock_Header
     CommonMessageHeader commonHeader;
     uint64_t multiblockId = 0;
     uint64_t blockerId = 0;
-    uint8_t padding[4];
+    // id of the remote procedure of a request or 0 for the standalone-callback
+    uint32_t methodId = 0;
 
     Data_SingleBlock_Header()
     {
@@ -388,6 +440,49 @@ struct Data_SingleBlockReply_Message
 
 } __attribute__((packed));
 
+/**
+ * @brief Data_SingleBlockCancel_Message
+ */
+struct Data_SingleBlockCancel_Message
+{
+    CommonMessageHeader commonHeader;
+    uint64_t blockerId = 0;
+    CommonMessageFooter commonEnd;
+
+    Data_SingleBlockCancel_Message()
+    {
+        commonHeader.type = SINGLEBLOCK_DATA_TYPE;
+        commonHeader.subType = DATA_SINGLE_CANCEL_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Data_SingleBlockCancel_Message);
+    }
+
+} __attribute__((packed));
+
+/**
+ * @brief Data_SingleBlockReject_Message
+ */
+struct Data_SingleBlockReject_Message
+{
+    enum reasons {
+        OVERLOAD = 0,
+        UNKNOWN_METHOD = 1,
+    };
+
+    CommonMessageHeader commonHeader;
+    uint64_t blockerId = 0;
+    uint8_t reason = OVERLOAD;
+    uint8_t padding[7];
+    CommonMessageFooter commonEnd;
+
+    Data_SingleBlockReject_Message()
+    {
+        commonHeader.type = SINGLEBLOCK_DATA_TYPE;
+        commonHeader.subType = DATA_SINGLE_REJECT_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(Data_SingleBlockReject_Message);
+    }
+
+} __attribute__((packed));
+
 //==================================================================================================
 
 /**
@@ -398,6 +493,9 @@ struct Data_MultiInit_Message
     CommonMessageHeader commonHeader;
     uint64_t multiblockId = 0;
     uint64_t totalSize = 0;
+    // id of the remote procedure of a request or 0 for the standalone-callback
+    uint32_t methodId = 0;
+    uint8_t padding[4];
     CommonMessageFooter commonEnd;
 
     Data_MultiInit_Message()
@@ -514,6 +612,70 @@ struct Data_MultiAbortReply_Message
 
 //==================================================================================================
 
+/**
+ * @brief PubSub_Subscribe_Message
+ */
+struct PubSub_Subscribe_Message
+{
+    CommonMessageHeader commonHeader;
+    char topic[64];
+    uint32_t topicSize = 0;
+    uint8_t policy = 0;
+    uint8_t padding[3];
+    CommonMessageFooter commonEnd;
+
+    PubSub_Subscribe_Message()
+    {
+        commonHeader.type = PUBSUB_TYPE;
+        commonHeader.subType = PUBSUB_SUBSCRIBE_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(PubSub_Subscribe_Message);
+    }
+
+} __attribute__((packed));
+
+/**
+ * @brief PubSub_Unsubscribe_Message
+ */
+struct PubSub_Unsubscribe_Message
+{
+    CommonMessageHeader commonHeader;
+    char topic[64];
+    uint32_t topicSize = 0;
+    uint8_t padding[4];
+    CommonMessageFooter commonEnd;
+
+    PubSub_Unsubscribe_Message()
+    {
+        commonHeader.type = PUBSUB_TYPE;
+        commonHeader.subType = PUBSUB_UNSUBSCRIBE_SUBTYPE;
+        commonHeader.totalMessageSize = sizeof(PubSub_Unsubscribe_Message);
+    }
+
+} __attribute__((packed));
+
+/**
+ * @brief PubSub_Publish_Header
+ *
+ * the same encoded message is send to all subscribers of the topic, so the session- and
+ * message-id within the header are the values of the publisher
+ */
+struct PubSub_Publish_Header
+{
+    CommonMessageHeader commonHeader;
+    char topic[64];
+    uint32_t topicSize = 0;
+    uint8_t padding[4];
+
+    PubSub_Publish_Header()
+    {
+        commonHeader.type = PUBSUB_TYPE;
+        commonHeader.subType = PUBSUB_PUBLISH_SUBTYPE;
+    }
+
+} __attribute__((packed));
+
+//==================================================================================================
+
 } // namespace Sakura
 } // namespace Kitsunemimi
 
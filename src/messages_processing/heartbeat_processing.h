@@ -46,6 +46,22 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+/**
+ * @brief get the current wall-clock-time for the timestamps of the heartbeats. The wall-clock is
+ *        used instead of a monotonic clock, because the timestamps are compared with the clock of
+ *        the other side to estimate the clock-offset.
+ *
+ * @return microseconds since epoch
+ */
+inline uint64_t
+getHeartbeatTimestamp()
+{
+    const std::chrono::system_clock::duration sinceEpoch =
+            std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count());
+}
+
 /**
  * @brief send the initial message
  *
@@ -59,6 +75,7 @@ send_Heartbeat_Start(Session* session)
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.sendTime = getHeartbeatTimestamp();
 
     // send
     SessionHandler::m_sessionHandler->sendMessage(session,
@@ -72,16 +89,23 @@ send_Heartbeat_Start(Session* session)
  *
  * @param session pointer to the session
  * @param id of the message of the initial heartbeat
+ * @param originSendTime timestamp of the initial heartbeat
+ * @param receiveTime timestamp, when the initial heartbeat was received
  */
 inline void
 send_Heartbeat_Reply(Session* session,
-                     const uint32_t messageId)
+                     const uint32_t messageId,
+                     const uint64_t originSendTime,
+                     const uint64_t receiveTime)
 {
     Heartbeat_Reply_Message message;
 
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = messageId;
+    message.originSendTime = originSendTime;
+    message.receiveTime = receiveTime;
+    message.replySendTime = getHeartbeatTimestamp();
 
     // send
     SessionHandler::m_sessionHandler->sendMessage(session,
@@ -100,18 +124,31 @@ inline void
 process_Heartbeat_Start(Session* session,
                         const Heartbeat_Start_Message* message)
 {
-    send_Heartbeat_Reply(session, message->commonHeader.messageId);
+    const uint64_t receiveTime = getHeartbeatTimestamp();
+    send_Heartbeat_Reply(session,
+                         message->commonHeader.messageId,
+                         message->sendTime,
+                         receiveTime);
 }
 
 /**
- * @brief handle the reply-message, but do nothing here, because it is only important, that the
- *        message is arrived to be handled by the timer-thread
+ * @brief handle the reply-message by resetting the counter of missed heartbeats and updating
+ *        the latency-estimation with the timestamps of the message. The timeout is handled by the
+ *        timer-thread.
+ *
+ * @param session pointer to the session
+ * @param message incoming message
  */
 inline void
-process_Heartbeat_Reply(Session*,
-                        const Heartbeat_Reply_Message*)
+process_Heartbeat_Reply(Session* session,
+                        const Heartbeat_Reply_Message* message)
 {
-    return;
+    const uint64_t receiveTime = getHeartbeatTimestamp();
+    session->m_missedHeartbeats.store(0, std::memory_order_relaxed);
+    session->updateLatency(message->originSendTime,
+                           message->receiveTime,
+                           message->replySendTime,
+                           receiveTime);
 }
 
 /**
@@ -131,6 +168,10 @@ process_Heartbeat_Type(Session* session,
         //------------------------------------------------------------------------------------------
         case HEARTBEAT_START_SUBTYPE:
             {
+                // size of this message has changed with protocol-version 0x2
+                if(header->totalMessageSize < sizeof(Heartbeat_Start_Message)) {
+                    break;
+                }
                 const Heartbeat_Start_Message* message =
                     static_cast<const Heartbeat_Start_Message*>(rawMessage);
                 process_Heartbeat_Start(session, message);
@@ -139,6 +180,10 @@ process_Heartbeat_Type(Session* session,
         //------------------------------------------------------------------------------------------
         case HEARTBEAT_REPLY_SUBTYPE:
             {
+                // size of this message has changed with protocol-version 0x2
+                if(header->totalMessageSize < sizeof(Heartbeat_Reply_Message)) {
+                    break;
+                }
                 const Heartbeat_Reply_Message* message =
                     static_cast<const Heartbeat_Reply_Message*>(rawMessage);
                 process_Heartbeat_Reply(session, message);
@@ -25,6 +25,8 @@
 
 #include <message_definitions.h>
 #include <handler/session_handler.h>
+#include <handler/request_scheduler.h>
+#include <handler/rpc_dispatcher.h>
 #include <multiblock_io.h>
 
 #include <libKitsunemimiNetwork/abstract_socket.h>
@@ -45,20 +47,26 @@ namespace Sakura
 
 /**
  * @brief send_Data_Multi_Init
+ *
+ * @param methodId id of the remote procedure of a request or 0 for the standalone-callback
  */
 inline void
 send_Data_Multi_Init(Session* session,
                      const uint64_t multiblockId,
                      const uint64_t requestedSize,
-                     const bool answerExpected)
+                     const bool answerExpected,
+                     const uint32_t timeBudget = 0,
+                     const uint32_t methodId = 0)
 {
     Data_MultiInit_Message message;
 
     // fill message
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.commonHeader.additionalValues = timeBudget;
     message.multiblockId = multiblockId;
     message.totalSize = requestedSize;
+    message.methodId = methodId;
     if(answerExpected) {
         message.commonHeader.flags |= 0x4;
     }
@@ -94,14 +102,20 @@ send_Data_Multi_Init_Reply(Session* session,
 
 /**
  * @brief send_Data_Multi_Static
+ *
+ * @param socket stripe-socket to send the part over an additional connection of the session.
+ *               If nullptr, the message is send over the main-socket of the session.
+ *
+ * @return false, if sending over the stripe-socket failed, else true
  */
-inline void
+inline bool
 send_Data_Multi_Static(Session* session,
                        const uint64_t multiblockId,
                        const uint32_t totalPartNumber,
                        const uint32_t partId,
                        const void* data,
-                       const uint32_t size)
+                       const uint32_t size,
+                       Network::AbstractSocket* socket = nullptr)
 {
     uint8_t messageBuffer[MESSAGE_CACHE_SIZE];
 
@@ -130,10 +144,15 @@ send_Data_Multi_Static(Session* session,
            &end,
            sizeof(CommonMessageFooter));
 
+    if(socket != nullptr) {
+        return socket->sendMessage(messageBuffer, totalMessageSize);
+    }
+
     SessionHandler::m_sessionHandler->sendMessage(session,
                                                   message.commonHeader,
                                                   messageBuffer,
                                                   totalMessageSize);
+    return true;
 }
 
 /**
@@ -206,8 +225,19 @@ inline void
 process_Data_Multi_Init(Session* session,
                         const Data_MultiInit_Message* message)
 {
-    const bool ret = session->m_multiblockIo->createIncomingBuffer(message->multiblockId,
-                                                                   message->totalSize);
+    // reject the transfer of an already expired message
+    const std::chrono::steady_clock::time_point deadline =
+            session->convertDeadline(message->commonHeader.additionalValues);
+    bool ret = false;
+    if(Session::isExpired(deadline) == false)
+    {
+        ret = session->m_multiblockIo->createIncomingBuffer(message->multiblockId,
+                                                            message->totalSize,
+                                                            deadline,
+                                                            message->commonHeader.flags & 0x4,
+                                                            message->methodId);
+    }
+
     if(ret)
     {
         send_Data_Multi_Init_Reply(session,
@@ -237,6 +267,8 @@ process_Data_Multi_Init_Reply(Session* session,
     }
     else
     {
+        session->m_multiblockIo->removeOutgoingMessage(message->multiblockId);
+
         // trigger callback
         session->m_processError(session,
                                 Session::errorCodes::MULTIBLOCK_FAILED,
@@ -244,6 +276,59 @@ process_Data_Multi_Init_Reply(Session* session,
     }
 }
 
+/**
+ * @brief deliver a completely received multiblock-message
+ *
+ * @param session pointer to the session
+ * @param completedMessage complete message
+ */
+inline void
+deliver_Data_Multi(Session* session,
+                   const MultiblockIO::MultiblockMessage &completedMessage)
+{
+    // check if normal standalone-message or if message is response
+    if(completedMessage.isResponse)
+    {
+        // release thread, which is related to the blocker-id
+        SessionHandler::m_blockerHandler->releaseMessage(completedMessage.blockerId,
+                                                         completedMessage.multiBlockBuffer,
+                                                         session);
+    }
+    else
+    {
+        // drop expired work before the callback
+        if(Session::isExpired(completedMessage.deadline))
+        {
+            delete completedMessage.multiBlockBuffer;
+            return;
+        }
+
+        // keep the deadline for the response
+        if(completedMessage.deadline != std::chrono::steady_clock::time_point()) {
+            session->addRequestDeadline(completedMessage.multiblockId, completedMessage.deadline);
+        }
+
+        // requests go over the request-scheduler, if enabled, which rejects them, if its queue
+        // is full
+        if(completedMessage.isRequest
+                && SessionHandler::m_requestScheduler->isEnabled())
+        {
+            SessionHandler::m_requestScheduler->addRequest(session,
+                                                           completedMessage.methodId,
+                                                           completedMessage.multiblockId,
+                                                           completedMessage.multiBlockBuffer,
+                                                           completedMessage.deadline);
+        }
+        else
+        {
+            SessionHandler::m_rpcDispatcher->dispatch(session,
+                                                      completedMessage.methodId,
+                                                      completedMessage.multiblockId,
+                                                      completedMessage.multiBlockBuffer);
+        }
+    }
+}
+
 /**
  * @brief process_Data_Multi_Static
  */
@@ -253,10 +338,18 @@ process_Data_Multiblock(Session* session,
                         const void* rawMessage)
 {
     const uint8_t* payloadData = static_cast<const uint8_t*>(rawMessage)
-                                 + sizeof(Data_SingleBlock_Header);
+                                 + sizeof(Data_MultiBlock_Header);
+
+    // parts, which are transfered over stripes, can be completed after the finish-message
+    MultiblockIO::MultiblockMessage completedMessage;
     session->m_multiblockIo->writeIntoIncomingBuffer(message->multiblockId,
+                                                     message->partId,
                                                      payloadData,
-                                                     message->commonHeader.payloadSize);
+                                                     message->commonHeader.payloadSize,
+                                                     completedMessage);
+    if(completedMessage.multiBlockBuffer != nullptr) {
+        deliver_Data_Multi(session, completedMessage);
+    }
 }
 
 /**
@@ -266,25 +359,14 @@ inline void
 process_Data_Multi_Finish(Session* session,
                           const Data_MultiFinish_Message* message)
 {
-    MultiblockIO::MultiblockMessage buffer =
-            session->m_multiblockIo->getIncomingBuffer(message->multiblockId);
-
-    // check if normal standalone-message or if message is response
-    if(message->commonHeader.flags & 0x8)
-    {
-        // release thread, which is related to the blocker-id
-        SessionHandler::m_blockerHandler->releaseMessage(message->blockerId,
-                                                         buffer.multiBlockBuffer);
+    MultiblockIO::MultiblockMessage completedMessage;
+    session->m_multiblockIo->finishIncomingBuffer(message->multiblockId,
+                                                  message->blockerId,
+                                                  message->commonHeader.flags & 0x8,
+                                                  completedMessage);
+    if(completedMessage.multiBlockBuffer != nullptr) {
+        deliver_Data_Multi(session, completedMessage);
     }
-    else
-    {
-        // trigger callback
-        session->m_processStandaloneData(session,
-                                         message->multiblockId,
-                                         buffer.multiBlockBuffer);
-    }
-
-    session->m_multiblockIo->removeIncomingMessage(message->multiblockId);
 }
 
 /**
@@ -329,6 +411,10 @@ process_MultiBlock_Data_Type(Session* session,
         //------------------------------------------------------------------------------------------
         case DATA_MULTI_INIT_SUBTYPE:
             {
+                // size of this message has changed with protocol-version 0x2
+                if(header->totalMessageSize < sizeof(Data_MultiInit_Message)) {
+                    break;
+                }
                 const Data_MultiInit_Message* message =
                     static_cast<const Data_MultiInit_Message*>(rawMessage);
                 process_Data_Multi_Init(session, message);
@@ -0,0 +1,264 @@
+/**
+ * @file       pubsub_processing.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef PUBSUB_PROCESSING_H
+#define PUBSUB_PROCESSING_H
+
+#include <message_definitions.h>
+#include <handler/session_handler.h>
+#include <handler/topic_handler.h>
+
+#include <libKitsunemimiNetwork/abstract_socket.h>
+#include <libKitsunemimiCommon/buffer/ring_buffer.h>
+
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+using Kitsunemimi::RingBuffer;
+using Kitsunemimi::Network::AbstractSocket;
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief send_PubSub_Subscribe
+ *
+ * @param session pointer to the session
+ * @param topic name of the topic
+ * @param policy behavior of the server, if the queue of the subscriber is full
+ *
+ * @return false, if send failed, else true
+ */
+inline bool
+send_PubSub_Subscribe(Session* session,
+                      const std::string &topic,
+                      const uint8_t policy)
+{
+    PubSub_Subscribe_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.topicSize = static_cast<uint32_t>(topic.size());
+    message.policy = policy;
+    memcpy(message.topic, topic.c_str(), topic.size());
+
+    // send
+    return SessionHandler::m_sessionHandler->sendMessage(session,
+                                                         message.commonHeader,
+                                                         &message,
+                                                         sizeof(message));
+}
+
+/**
+ * @brief send_PubSub_Unsubscribe
+ *
+ * @param session pointer to the session
+ * @param topic name of the topic
+ *
+ * @return false, if send failed, else true
+ */
+inline bool
+send_PubSub_Unsubscribe(Session* session,
+                        const std::string &topic)
+{
+    PubSub_Unsubscribe_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.topicSize = static_cast<uint32_t>(topic.size());
+    memcpy(message.topic, topic.c_str(), topic.size());
+
+    // send
+    return SessionHandler::m_sessionHandler->sendMessage(session,
+                                                         message.commonHeader,
+                                                         &message,
+                                                         sizeof(message));
+}
+
+/**
+ * @brief build a publish-message, which can be send unchanged to all subscribers of the topic
+ *
+ * @param sessionId id of the publishing session or 0, if published by the server itself
+ * @param messageId message-id of the publishing session or 0
+ * @param topic name of the topic
+ * @param data data-pointer
+ * @param size number of bytes
+ *
+ * @return reference-counted buffer with the complete message
+ */
+inline std::shared_ptr<const std::vector<uint8_t>>
+build_PubSub_Publish(const uint32_t sessionId,
+                     const uint32_t messageId,
+                     const std::string &topic,
+                     const void* data,
+                     const uint32_t size)
+{
+    // bring message-size to a multiple of 8
+    const uint32_t totalMessageSize = sizeof(PubSub_Publish_Header)
+                                      + size
+                                      + (8-(size % 8)) % 8  // fill up to a multiple of 8
+                                      + sizeof(CommonMessageFooter);
+
+    CommonMessageFooter end;
+    PubSub_Publish_Header header;
+
+    // fill message
+    header.commonHeader.sessionId = sessionId;
+    header.commonHeader.messageId = messageId;
+    header.commonHeader.totalMessageSize = totalMessageSize;
+    header.commonHeader.payloadSize = size;
+    header.topicSize = static_cast<uint32_t>(topic.size());
+    memcpy(header.topic, topic.c_str(), topic.size());
+
+    // fill buffer with all parts of the message
+    std::vector<uint8_t>* messageBuffer = new std::vector<uint8_t>(totalMessageSize, 0);
+    memcpy(&(*messageBuffer)[0], &header, sizeof(PubSub_Publish_Header));
+    memcpy(&(*messageBuffer)[sizeof(PubSub_Publish_Header)], data, size);
+    memcpy(&(*messageBuffer)[totalMessageSize - sizeof(CommonMessageFooter)],
+           &end,
+           sizeof(CommonMessageFooter));
+
+    return std::shared_ptr<const std::vector<uint8_t>>(messageBuffer);
+}
+
+/**
+ * @brief process_PubSub_Subscribe
+ */
+inline void
+process_PubSub_Subscribe(Session* session,
+                         const PubSub_Subscribe_Message* message)
+{
+    if(message->topicSize > 64) {
+        return;
+    }
+
+    const std::string topic(message->topic, message->topicSize);
+    SessionHandler::m_topicHandler->subscribe(session,
+                                              topic,
+                                              message->policy == Session::BLOCK_WHEN_FULL);
+}
+
+/**
+ * @brief process_PubSub_Unsubscribe
+ */
+inline void
+process_PubSub_Unsubscribe(Session* session,
+                           const PubSub_Unsubscribe_Message* message)
+{
+    if(message->topicSize > 64) {
+        return;
+    }
+
+    const std::string topic(message->topic, message->topicSize);
+    SessionHandler::m_topicHandler->unsubscribe(session, topic);
+}
+
+/**
+ * @brief process_PubSub_Publish
+ */
+inline void
+process_PubSub_Publish(Session* session,
+                       const PubSub_Publish_Header* header,
+                       const void* rawMessage)
+{
+    if(header->topicSize > 64) {
+        return;
+    }
+
+    const std::string topic(header->topic, header->topicSize);
+    const uint8_t* payloadData = static_cast<const uint8_t*>(rawMessage)
+                                 + sizeof(PubSub_Publish_Header);
+
+    // on server-side the received message is forwarded unchanged to all subscribers
+    if(session->isClientSide() == false)
+    {
+        const uint8_t* rawData = static_cast<const uint8_t*>(rawMessage);
+        std::shared_ptr<const std::vector<uint8_t>> frame(
+                    new std::vector<uint8_t>(rawData,
+                                             rawData + header->commonHeader.totalMessageSize));
+        SessionHandler::m_topicHandler->publish(topic, frame);
+    }
+
+    // trigger callback
+    if(session->m_processPublish != nullptr)
+    {
+        session->m_processPublish(session,
+                                  topic,
+                                  static_cast<const void*>(payloadData),
+                                  header->commonHeader.payloadSize);
+    }
+}
+
+/**
+ * @brief process messages of pubsub-type
+ *
+ * @param session pointer to the session
+ * @param header pointer to the common header of the message within the message-ring-buffer
+ * @param rawMessage pointer to the raw data of the complete message (header + payload + end)
+ */
+inline void
+process_PubSub_Type(Session* session,
+                    const CommonMessageHeader* header,
+                    const void* rawMessage)
+{
+    switch(header->subType)
+    {
+        //------------------------------------------------------------------------------------------
+        case PUBSUB_SUBSCRIBE_SUBTYPE:
+            {
+                const PubSub_Subscribe_Message* message =
+                    static_cast<const PubSub_Subscribe_Message*>(rawMessage);
+                process_PubSub_Subscribe(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        case PUBSUB_UNSUBSCRIBE_SUBTYPE:
+            {
+                const PubSub_Unsubscribe_Message* message =
+                    static_cast<const PubSub_Unsubscribe_Message*>(rawMessage);
+                process_PubSub_Unsubscribe(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        case PUBSUB_PUBLISH_SUBTYPE:
+            {
+                const PubSub_Publish_Header* message =
+                    static_cast<const PubSub_Publish_Header*>(rawMessage);
+                process_PubSub_Publish(session, message, rawMessage);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        default:
+            break;
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // PUBSUB_PROCESSING_H
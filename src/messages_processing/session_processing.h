@@ -25,8 +25,13 @@
 
 #include <message_definitions.h>
 #include <handler/session_handler.h>
+#include <handler/reply_handler.h>
 #include <multiblock_io.h>
 
+#include <random>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
 #include <libKitsunemimiNetwork/abstract_socket.h>
 
 #include <libKitsunemimiSakuraNetwork/session_controller.h>
@@ -42,22 +47,114 @@ namespace Kitsunemimi
 namespace Sakura
 {
 
+uint64_t processMessage_callback(void* target,
+                                 RingBuffer* recvBuffer,
+                                 AbstractSocket*);
+
+/**
+ * @brief helper to read the file-descriptor of a socket, which is only accessible for derived
+ *        classes of the abstract socket
+ */
+struct SocketDescriptor
+        : public AbstractSocket
+{
+    static int get(AbstractSocket* socket)
+    {
+        return socket->*(&SocketDescriptor::m_socket);
+    }
+};
+
+/**
+ * @brief check if the remote-side of two sockets is on the same host
+ *
+ * @param socket1 first socket
+ * @param socket2 second socket
+ *
+ * @return true, if the ip-addresses of the remote-sides are equal, else false
+ */
+inline bool
+hasSamePeerAddress(AbstractSocket* socket1,
+                   AbstractSocket* socket2)
+{
+    sockaddr_storage address1;
+    sockaddr_storage address2;
+    socklen_t addressSize1 = sizeof(address1);
+    socklen_t addressSize2 = sizeof(address2);
+    memset(&address1, 0, sizeof(address1));
+    memset(&address2, 0, sizeof(address2));
+
+    if(getpeername(SocketDescriptor::get(socket1),
+                   reinterpret_cast<sockaddr*>(&address1),
+                   &addressSize1) != 0
+            || getpeername(SocketDescriptor::get(socket2),
+                           reinterpret_cast<sockaddr*>(&address2),
+                           &addressSize2) != 0)
+    {
+        return false;
+    }
+
+    if(address1.ss_family != address2.ss_family) {
+        return false;
+    }
+
+    // compare only the ip-address, because each stripe comes from another port
+    if(address1.ss_family == AF_INET)
+    {
+        const sockaddr_in* ipv4_1 = reinterpret_cast<const sockaddr_in*>(&address1);
+        const sockaddr_in* ipv4_2 = reinterpret_cast<const sockaddr_in*>(&address2);
+        return ipv4_1->sin_addr.s_addr == ipv4_2->sin_addr.s_addr;
+    }
+    if(address1.ss_family == AF_INET6)
+    {
+        const sockaddr_in6* ipv6_1 = reinterpret_cast<const sockaddr_in6*>(&address1);
+        const sockaddr_in6* ipv6_2 = reinterpret_cast<const sockaddr_in6*>(&address2);
+        return memcmp(&ipv6_1->sin6_addr, &ipv6_2->sin6_addr, sizeof(in6_addr)) == 0;
+    }
+
+    // unix-domain-sockets are always local
+    return address1.ss_family == AF_UNIX;
+}
+
+/**
+ * @brief create a random token, which is not 0, to authorize the stripes of a session
+ *
+ * @return new token
+ */
+inline uint64_t
+createStripeToken()
+{
+    std::random_device randomDevice;
+    uint64_t token = 0;
+    while(token == 0)
+    {
+        token = (static_cast<uint64_t>(randomDevice()) << 32)
+                | static_cast<uint64_t>(randomDevice());
+    }
+
+    return token;
+}
+
 /**
  * @brief send_Session_Init_Start
  *
  * @param session pointer to the session
  * @param sessionIdentifier custom value, which is sended within the init-message to pre-identify
  *                          the message on server-side
+ * @param isChannel true, if the session is a channel over the connection of another session
  */
 inline void
 send_Session_Init_Start(Session* session,
-                        const std::string &sessionIdentifier)
+                        const std::string &sessionIdentifier,
+                        const bool isChannel = false)
 {
     LOG_DEBUG("SEND session init start");
 
     Session_Init_Start_Message message;
 
     // fill message
+    if(isChannel) {
+        message.commonHeader.subType = SESSION_CHANNEL_INIT_START_SUBTYPE;
+    }
     message.commonHeader.sessionId = session->sessionId();
     message.commonHeader.messageId = session->increaseMessageIdCounter();
     message.clientSessionId = session->sessionId();
@@ -73,6 +170,62 @@ send_Session_Init_Start(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief send_Session_Init_Start together with already built messages (early data) in a single
+ *        write. The other side processes the messages directly after the session is ready, so
+ *        the first payload needs no additional round-trip.
+ *
+ * @param session pointer to the session
+ * @param sessionIdentifier custom value, which is sended within the init-message to pre-identify
+ *                          the message on server-side
+ * @param earlyMessages buffer with the complete messages, which should follow the init-message
+ * @param messagePositions positions of the messages within the buffer
+ *
+ * @return false, if send failed, else true
+ */
+inline bool
+send_Session_Init_Start_With_Data(Session* session,
+                                  const std::string &sessionIdentifier,
+                                  std::vector<uint8_t> &earlyMessages,
+                                  const std::vector<uint64_t> &messagePositions)
+{
+    LOG_DEBUG("SEND session init start with early data");
+
+    Session_Init_Start_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.clientSessionId = session->sessionId();
+    message.sessionIdentifierSize = static_cast<uint32_t>(sessionIdentifier.size());
+    memcpy(message.sessionIdentifier,
+           sessionIdentifier.c_str(),
+           sessionIdentifier.size());
+
+    // the early messages are send without reply-flag, because their replies would use the
+    // complete session-id, which doesn't exist yet on this side
+    for(const uint64_t position : messagePositions)
+    {
+        CommonMessageHeader* header =
+                reinterpret_cast<CommonMessageHeader*>(&earlyMessages[position]);
+        header->sessionId = session->sessionId();
+        header->messageId = session->increaseMessageIdCounter();
+        header->flags &= ~0x1;
+    }
+
+    // build single buffer
+    std::vector<uint8_t> messageBuffer(sizeof(message) + earlyMessages.size());
+    memcpy(&messageBuffer[0], &message, sizeof(message));
+    memcpy(&messageBuffer[sizeof(message)], &earlyMessages[0], earlyMessages.size());
+
+    SessionHandler::m_replyHandler->addMessage(message.commonHeader.type,
+                                               session->m_localSessionId,
+                                               message.commonHeader.messageId,
+                                               session);
+
+    return session->m_socket->sendMessage(&messageBuffer[0], messageBuffer.size());
+}
+
 /**
  * @brief send_Session_Init_Reply
  *
@@ -82,13 +235,16 @@ send_Session_Init_Start(Session* session,
  * @param completeSessionId completed session-id based on the id of the server and the client
  * @param sessionIdentifier custom value, which is sended within the init-message to pre-identify
  *                          the message on server-side
+ * @param stripeToken secret token, which must be send by the client to join additional stripes
+ *                    to the session
  */
 inline void
 send_Session_Init_Reply(Session* session,
                         const uint32_t initialSessionId,
                         const uint32_t messageId,
                         const uint32_t completeSessionId,
-                        const std::string &sessionIdentifier)
+                        const std::string &sessionIdentifier,
+                        const uint64_t stripeToken = 0)
 {
     LOG_DEBUG("SEND session init reply");
 
@@ -99,6 +255,7 @@ send_Session_Init_Reply(Session* session,
     message.commonHeader.messageId = messageId;
     message.completeSessionId = completeSessionId;
     message.clientSessionId = initialSessionId;
+    message.stripeToken = stripeToken;
 
     message.sessionIdentifierSize = static_cast<uint32_t>(sessionIdentifier.size());
     memcpy(message.sessionIdentifier,
@@ -165,6 +322,32 @@ send_Session_Close_Reply(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief send_Session_Stripe_Join
+ *
+ * @param session pointer to the session, which should be extended by the stripe
+ * @param stripeSocket already connected socket of the new stripe
+ *
+ * @return true, if successful, else false
+ */
+inline bool
+send_Session_Stripe_Join(Session* session,
+                         Network::AbstractSocket* stripeSocket)
+{
+    LOG_DEBUG("SEND session stripe join");
+
+    Session_Stripe_Join_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.sessionId = session->sessionId();
+    message.stripeToken = session->m_stripeToken;
+
+    // send over the new stripe and not over the main-socket of the session
+    return stripeSocket->sendMessage(&message, sizeof(message));
+}
+
 /**
  * @brief process_Session_Init_Start
  *
@@ -177,19 +360,53 @@ process_Session_Init_Start(Session* session,
 {
     LOG_DEBUG("process session init start");
 
-    // get and calculate session-id
+    // the id of the session is given by the server-side and is unique within this process
     const uint32_t clientSessionId = message->clientSessionId;
-    const uint16_t serverSessionId = SessionHandler::m_sessionHandler->increaseSessionIdCounter();
-    const uint32_t sessionId = clientSessionId + (serverSessionId * 0x10000);
+    const uint32_t sessionId = SessionHandler::m_sessionHandler->allocateSessionId();
     const std::string sessionIdentifier(message->sessionIdentifier, message->sessionIdentifierSize);
 
     // create new session and make it ready
     SessionHandler::m_sessionHandler->addSession(sessionId, session);
     session->connectiSession(sessionId);
+    session->m_stripeToken = createStripeToken();
     session->makeSessionReady(sessionId, sessionIdentifier);
 
     // send
     send_Session_Init_Reply(session,
+                            clientSessionId,
+                            message->commonHeader.messageId,
+                            sessionId,
+                            sessionIdentifier,
+                            session->m_stripeToken);
+}
+
+/**
+ * @brief process_Session_Channel_Init_Start
+ *
+ * @param session pointer to the session, which owns the connection for the new channel
+ * @param message pointer to the complete message within the message-ring-buffer
+ */
+inline void
+process_Session_Channel_Init_Start(Session* session,
+                                   const Session_Init_Start_Message* message)
+{
+    LOG_DEBUG("process session channel init start");
+
+    // the id of the session is given by the server-side and is unique within this process
+    const uint32_t clientSessionId = message->clientSessionId;
+    const uint32_t sessionId = SessionHandler::m_sessionHandler->allocateSessionId();
+    const std::string sessionIdentifier(message->sessionIdentifier, message->sessionIdentifierSize);
+
+    // create new channel, which shares the socket of the session
+    Session* channel = SessionHandler::m_sessionHandler->createSession(session->m_socket);
+    channel->m_parentSession = session;
+    SessionHandler::m_sessionHandler->addSession(sessionId, channel);
+    session->addChannel(sessionId, channel);
+    channel->connectChannel(sessionId);
+    channel->makeSessionReady(sessionId, sessionIdentifier);
+
+    // send
+    send_Session_Init_Reply(channel,
                             clientSessionId,
                             message->commonHeader.messageId,
                             sessionId,
@@ -211,10 +428,17 @@ process_Session_Init_Reply(Session* session,
     const uint32_t completeSessionId = message->completeSessionId;
     const uint32_t initialId = message->clientSessionId;
     const std::string sessionIdentifier(message->sessionIdentifier, message->sessionIdentifierSize);
+    session->m_stripeToken = message->stripeToken;
+
+    // register channel under the new complete session-id for the demultiplexing
+    if(session->m_parentSession != nullptr)
+    {
+        session->m_parentSession->removeChannel(initialId);
+        session->m_parentSession->addChannel(completeSessionId, session);
+    }
 
-    // readd session under the new complete session-id and make session ready
-    SessionHandler::m_sessionHandler->removeSession(initialId);
-    SessionHandler::m_sessionHandler->addSession(completeSessionId, session);
+    // the session stays registered under its local id, because the complete session-id is
+    // given by the server and so it is only unique on the server-side
     // TODO: handle return-value of makeSessionReady
     session->makeSessionReady(completeSessionId, sessionIdentifier);
 }
@@ -235,7 +459,7 @@ process_Session_Close_Start(Session* session,
                              message->commonHeader.messageId);
 
     // close session and disconnect session
-    SessionHandler::m_sessionHandler->removeSession(message->sessionId);
+    SessionHandler::m_sessionHandler->removeSession(session->m_localSessionId);
     session->endSession();
     session->disconnectSession();
 }
@@ -244,19 +468,59 @@ process_Session_Close_Start(Session* session,
  * @brief process_Session_Close_Reply
  *
  * @param session pointer to the session
- * @param message pointer to the complete message within the message-ring-buffer
  */
 inline void
 process_Session_Close_Reply(Session* session,
-                            const Session_Close_Reply_Message* message)
+                            const Session_Close_Reply_Message*)
 {
     LOG_DEBUG("process session close reply");
 
     // disconnect session
-    SessionHandler::m_sessionHandler->removeSession(message->sessionId);
+    SessionHandler::m_sessionHandler->removeSession(session->m_localSessionId);
     session->disconnectSession();
 }
 
+/**
+ * @brief process_Session_Stripe_Join
+ *
+ * @param session pointer to the temporary session, which was created for the new connection
+ * @param message pointer to the complete message within the message-ring-buffer
+ */
+inline void
+process_Session_Stripe_Join(Session* session,
+                            const Session_Stripe_Join_Message* message)
+{
+    LOG_DEBUG("process session stripe join");
+
+    Network::AbstractSocket* stripeSocket = session->m_socket;
+
+    // the stripe is only accepted with the secret token of the session and from the same host
+    // like the main-connection, so other connections can not hijack the session by its id
+    Session* mainSession = SessionController::m_sessionController->getSession(message->sessionId);
+    if(mainSession == nullptr
+            || mainSession->isClientSide()
+            || mainSession->m_stripeToken == 0
+            || mainSession->m_stripeToken != message->stripeToken
+            || hasSamePeerAddress(stripeSocket, mainSession->m_socket) == false)
+    {
+        LOG_ERROR("rejected stripe for session with id " + std::to_string(message->sessionId));
+        session->m_socket = nullptr;
+        stripeSocket->closeSocket();
+        stripeSocket->scheduleThreadForDeletion();
+        SessionHandler::m_sessionHandler->recycleSession(session);
+        return;
+    }
+
+    // move the socket from the temporary session to the existing session. All following
+    // messages on this connection are processed by the existing session.
+    session->m_socket = nullptr;
+    stripeSocket->setMessageCallback(mainSession, &processMessage_callback);
+    mainSession->addStripe(stripeSocket);
+
+    // the temporary session was never registered and can be reused for another connection
+    SessionHandler::m_sessionHandler->recycleSession(session);
+}
+
 /**
  * @brief process messages of session-type
  *
@@ -286,6 +550,10 @@ process_Session_Type(Session* session,
         //------------------------------------------------------------------------------------------
         case SESSION_INIT_REPLY_SUBTYPE:
             {
+                // size of this message has changed with protocol-version 0x2
+                if(header->totalMessageSize < sizeof(Session_Init_Reply_Message)) {
+                    break;
+                }
                 const Session_Init_Reply_Message* message =
                     static_cast<const Session_Init_Reply_Message*>(rawMessage);
                 process_Session_Init_Reply(session, message);
@@ -308,6 +576,26 @@ process_Session_Type(Session* session,
                 break;
             }
         //------------------------------------------------------------------------------------------
+        case SESSION_CHANNEL_INIT_START_SUBTYPE:
+            {
+                const Session_Init_Start_Message* message =
+                    static_cast<const Session_Init_Start_Message*>(rawMessage);
+                process_Session_Channel_Init_Start(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        case SESSION_STRIPE_JOIN_SUBTYPE:
+            {
+                // size of this message has changed with protocol-version 0x2
+                if(header->totalMessageSize < sizeof(Session_Stripe_Join_Message)) {
+                    break;
+                }
+                const Session_Stripe_Join_Message* message =
+                    static_cast<const Session_Stripe_Join_Message*>(rawMessage);
+                process_Session_Stripe_Join(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
         default:
             break;
     }
@@ -25,7 +25,10 @@
 
 #include <message_definitions.h>
 #include <handler/session_handler.h>
+#include <handler/request_scheduler.h>
+#include <handler/rpc_dispatcher.h>
 #include <multiblock_io.h>
+#include <messages_processing/multiblock_data_processing.h>
 
 #include <libKitsunemimiNetwork/abstract_socket.h>
 #include <libKitsunemimiCommon/buffer/ring_buffer.h>
@@ -45,13 +48,27 @@ namespace Sakura
 
 /**
  * @brief send_Data_SingleBlock
+ *
+ * @param session pointer to the session
+ * @param multiblockId id of the message
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param blockerId blocker-id, if the message is a response to a request
+ * @param replyExpected false to skip the transport-reply of the other side
+ * @param timeBudget remaining time until the deadline in milliseconds or 0 for no deadline
+ * @param isRequest true, if the other side has to answer the message with a response
+ * @param methodId id of the remote procedure of a request or 0 for the standalone-callback
  */
 inline void
 send_Data_SingleBlock(Session* session,
                       const uint64_t multiblockId,
                       const void* data,
                       uint32_t size,
-                      const uint64_t blockerId=0)
+                      const uint64_t blockerId=0,
+                      const bool replyExpected=true,
+                      const uint32_t timeBudget=0,
+                      const bool isRequest=false,
+                      const uint32_t methodId=0)
 {
     uint8_t messageBuffer[MESSAGE_CACHE_SIZE];
 
@@ -71,9 +88,17 @@ send_Data_SingleBlock(Session* session,
     header.commonHeader.payloadSize = size;
     header.blockerId = blockerId;
     header.multiblockId = multiblockId;
+    header.methodId = methodId;
+    header.commonHeader.additionalValues = timeBudget;
     if(blockerId != 0) {
         header.commonHeader.flags |= 0x8;
     }
+    if(replyExpected == false) {
+        header.commonHeader.flags &= ~0x1;
+    }
+    if(isRequest) {
+        header.commonHeader.flags |= 0x4;
+    }
 
     // fill buffer with all parts of the message
     memcpy(&messageBuffer[0], &header, sizeof(Data_SingleBlock_Header));
@@ -89,6 +114,58 @@ send_Data_SingleBlock(Session* session,
                                                   totalMessageSize);
 }
 
+/**
+ * @brief build a single-block-message for the data only once to send it to multiple sessions.
+ *        The session- and message-ids are set per target while sending.
+ *
+ * @param messageBuffer buffer, which is filled with the message
+ * @param messagePositions list, which is filled with the position of the message
+ * @param multiblockId id of the message
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param timeBudget remaining time until the deadline in milliseconds or 0 for no deadline
+ * @param isRequest true, if the other side has to answer the message with a response
+ * @param methodId id of the remote procedure of a request or 0 for the standalone-callback
+ */
+inline void
+build_Data_SingleBlock(std::vector<uint8_t> &messageBuffer,
+                       std::vector<uint64_t> &messagePositions,
+                       const uint64_t multiblockId,
+                       const void* data,
+                       const uint32_t size,
+                       const uint32_t timeBudget = 0,
+                       const bool isRequest = false,
+                       const uint32_t methodId = 0)
+{
+    // bring message-size to a multiple of 8
+    const uint32_t totalMessageSize = sizeof(Data_SingleBlock_Header)
+                                      + size
+                                      + (8-(size % 8)) % 8  // fill up to a multiple of 8
+                                      + sizeof(CommonMessageFooter);
+
+    CommonMessageFooter end;
+    Data_SingleBlock_Header header;
+    header.commonHeader.totalMessageSize = totalMessageSize;
+    header.commonHeader.payloadSize = size;
+    header.commonHeader.additionalValues = timeBudget;
+    header.multiblockId = multiblockId;
+    header.methodId = methodId;
+    if(isRequest) {
+        header.commonHeader.flags |= 0x4;
+    }
+
+    // fill buffer with all parts of the message
+    const uint64_t position = messageBuffer.size();
+    messageBuffer.resize(position + totalMessageSize, 0);
+    memcpy(&messageBuffer[position], &header, sizeof(Data_SingleBlock_Header));
+    memcpy(&messageBuffer[position + sizeof(Data_SingleBlock_Header)], data, size);
+    memcpy(&messageBuffer[position + totalMessageSize - sizeof(CommonMessageFooter)],
+           &end,
+           sizeof(CommonMessageFooter));
+
+    messagePositions.push_back(position);
+}
+
 /**
  * @brief send_Data_SingleBlock_Reply
  */
@@ -109,6 +186,57 @@ send_Data_SingleBlock_Reply(Session* session,
                                                   sizeof(message));
 }
 
+/**
+ * @brief send the cancellation of a request, which is not waited for anymore
+ *
+ * @param session pointer to the session
+ * @param blockerId id of the request
+ */
+inline void
+send_Data_SingleBlock_Cancel(Session* session,
+                             const uint64_t blockerId)
+{
+    Data_SingleBlockCancel_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.blockerId = blockerId;
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
+/**
+ * @brief reject a request immediately, for example because the request-queue of this side is full
+ *
+ * @param session pointer to the session
+ * @param blockerId id of the request
+ * @param reason reason of the rejection
+ */
+inline void
+send_Data_SingleBlock_Reject(Session* session,
+                             const uint64_t blockerId,
+                             const uint8_t reason)
+{
+    Data_SingleBlockReject_Message message;
+
+    // fill message
+    message.commonHeader.sessionId = session->sessionId();
+    message.commonHeader.messageId = session->increaseMessageIdCounter();
+    message.blockerId = blockerId;
+    message.reason = reason;
+
+    // send
+    SessionHandler::m_sessionHandler->sendMessage(session,
+                                                  message.commonHeader,
+                                                  &message,
+                                                  sizeof(message));
+}
+
 /**
  * @brief process_Data_SingleBlock
  */
@@ -117,6 +245,19 @@ process_Data_SingleBlock(Session* session,
                          const Data_SingleBlock_Header* header,
                          const void* rawMessage)
 {
+    // drop expired work before the callback, but confirm the transfer
+    const bool isResponse = header->commonHeader.flags & 0x8;
+    const std::chrono::steady_clock::time_point deadline =
+            session->convertDeadline(header->commonHeader.additionalValues);
+    if(isResponse == false
+            && Session::isExpired(deadline))
+    {
+        if(header->commonHeader.flags & 0x1) {
+            send_Data_SingleBlock_Reply(session, header->commonHeader.messageId);
+        }
+        return;
+    }
+
     // prepare buffer for payload
     const uint32_t allocateBlocks = (header->commonHeader.payloadSize / 4096) + 1;
     DataBuffer* buffer = new DataBuffer(allocateBlocks, 4096);
@@ -129,18 +270,38 @@ process_Data_SingleBlock(Session* session,
     addData_DataBuffer(*buffer, payloadData, header->commonHeader.payloadSize);
 
     // check if normal standalone-message or if message is response
-    if(header->commonHeader.flags & 0x8)
+    if(isResponse)
     {
         // release thread, which is related to the blocker-id
         SessionHandler::m_blockerHandler->releaseMessage(header->blockerId,
-                                                         buffer);
+                                                         buffer,
+                                                         session);
     }
     else
     {
-        // trigger callback
-        session->m_processStandaloneData(session,
-                                         header->multiblockId,
-                                         buffer);
+        // keep the deadline for the response
+        if(header->commonHeader.additionalValues != 0) {
+            session->addRequestDeadline(header->multiblockId, deadline);
+        }
+
+        // requests go over the request-scheduler, if enabled, which rejects them, if its queue
+        // is full. Other messages are dispatched directly.
+        if(header->commonHeader.flags & 0x4
+                && SessionHandler::m_requestScheduler->isEnabled())
+        {
+            SessionHandler::m_requestScheduler->addRequest(session,
+                                                           header->methodId,
+                                                           header->multiblockId,
+                                                           buffer,
+                                                           deadline);
+        }
+        else
+        {
+            SessionHandler::m_rpcDispatcher->dispatch(session,
+                                                      header->methodId,
+                                                      header->multiblockId,
+                                                      buffer);
+        }
     }
 
     // send reply, if requested
@@ -159,6 +320,69 @@ process_Data_SingleBlock_Reply(Session*,
     return;
 }
 
+/**
+ * @brief handle the cancellation of a request by marking it as cancelled for the callback, which
+ *        processes the request, and by aborting the transfer of the request and its response
+ *
+ * @param session pointer to the session
+ * @param message incoming message
+ */
+inline void
+process_Data_SingleBlock_Cancel(Session* session,
+                                const Data_SingleBlockCancel_Message* message)
+{
+    const uint64_t blockerId = message->blockerId;
+    if(blockerId == 0) {
+        return;
+    }
+
+    session->addCancelledRequest(blockerId);
+
+    // a large request has the blocker-id as multiblock-id and can be still incomplete
+    session->m_multiblockIo->removeIncomingMessage(blockerId);
+
+    // abort a large response. If it is not in transfer at the moment, the other side doesn't get
+    // an abort from the multiblock-thread and has to be informed here
+    const uint64_t multiblockId = session->m_multiblockIo->getOutgoingResponseId(blockerId);
+    if(multiblockId != 0
+            && session->m_multiblockIo->removeOutgoingMessage(multiblockId))
+    {
+        send_Data_Multi_Abort_Reply(session,
+                                    multiblockId,
+                                    session->increaseMessageIdCounter());
+    }
+}
+
+/**
+ * @brief handle the rejection of a request by the other side by releasing the waiting thread
+ *        without response
+ *
+ * @param session pointer to the session
+ * @param message incoming message
+ */
+inline void
+process_Data_SingleBlock_Reject(Session* session,
+                                const Data_SingleBlockReject_Message* message)
+{
+    if(SessionHandler::m_blockerHandler->rejectMessage(message->blockerId) == false) {
+        return;
+    }
+
+    const std::string id = std::to_string(message->blockerId);
+    if(message->reason == Data_SingleBlockReject_Message::UNKNOWN_METHOD)
+    {
+        session->m_processError(session,
+                                Session::errorCodes::UNKNOWN_METHOD,
+                                "request rejected because of unknown method: " + id);
+    }
+    else
+    {
+        session->m_processError(session,
+                                Session::errorCodes::REQUEST_OVERLOADED,
+                                "request rejected because of overload: " + id);
+    }
+}
+
 /**
  * @brief process messages of singleblock-message-type
  *
@@ -190,6 +414,22 @@ process_SingleBlock_Data_Type(Session* session,
                 break;
             }
         //------------------------------------------------------------------------------------------
+        case DATA_SINGLE_CANCEL_SUBTYPE:
+            {
+                const Data_SingleBlockCancel_Message* message =
+                    static_cast<const Data_SingleBlockCancel_Message*>(rawMessage);
+                process_Data_SingleBlock_Cancel(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
+        case DATA_SINGLE_REJECT_SUBTYPE:
+            {
+                const Data_SingleBlockReject_Message* message =
+                    static_cast<const Data_SingleBlockReject_Message*>(rawMessage);
+                process_Data_SingleBlock_Reject(session, message);
+                break;
+            }
+        //------------------------------------------------------------------------------------------
         default:
             break;
     }
@@ -125,6 +125,60 @@ send_Data_Stream(Session* session,
                                                          totalMessageSize);
 }
 
+/**
+ * @brief build the stream-messages for the data only once to send them to multiple sessions.
+ *        The session- and message-ids are set per target while sending.
+ *
+ * @param messageBuffer buffer, which is filled with all messages
+ * @param messagePositions list, which is filled with the positions of the messages
+ * @param data data-pointer
+ * @param size number of bytes
+ */
+inline void
+build_Data_Stream(std::vector<uint8_t> &messageBuffer,
+                  std::vector<uint64_t> &messagePositions,
+                  const void* data,
+                  const uint64_t size)
+{
+    uint64_t totalSize = size;
+    uint32_t partCounter = 0;
+    const uint8_t* dataPointer = static_cast<const uint8_t*>(data);
+
+    while(totalSize != 0)
+    {
+        uint32_t currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
+        if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
+            currentMessageSize = static_cast<uint32_t>(totalSize);
+        }
+        totalSize -= currentMessageSize;
+
+        // bring message-size to a multiple of 8
+        const uint32_t totalMessageSize = sizeof(Data_Stream_Header)
+                                          + currentMessageSize
+                                          + (8 - (currentMessageSize % 8)) % 8
+                                          + sizeof(CommonMessageFooter);
+
+        CommonMessageFooter end;
+        Data_Stream_Header header;
+        header.commonHeader.totalMessageSize = totalMessageSize;
+        header.commonHeader.payloadSize = currentMessageSize;
+
+        // append message to the buffer
+        const uint64_t position = messageBuffer.size();
+        messageBuffer.resize(position + totalMessageSize, 0);
+        memcpy(&messageBuffer[position], &header, sizeof(Data_Stream_Header));
+        memcpy(&messageBuffer[position + sizeof(Data_Stream_Header)],
+               dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter),
+               currentMessageSize);
+        memcpy(&messageBuffer[position + totalMessageSize - sizeof(CommonMessageFooter)],
+               &end,
+               sizeof(CommonMessageFooter));
+
+        messagePositions.push_back(position);
+        partCounter++;
+    }
+}
+
 /**
  * @brief send_Data_Stream_Reply
  */
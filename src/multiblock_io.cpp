@@ -25,6 +25,9 @@
 #include <libKitsunemimiSakuraNetwork/session.h>
 #include <libKitsunemimiPersistence/logger/logger.h>
 #include <messages_processing/multiblock_data_processing.h>
+#include <stripe_sender.h>
+
+#include <algorithm>
 
 namespace Kitsunemimi
 {
@@ -35,6 +38,7 @@ MultiblockIO::MultiblockIO(Session* session)
     : Kitsunemimi::Thread()
 {
     m_session = session;
+    m_aborCurrentMessage = false;
 }
 
 /**
@@ -45,6 +49,9 @@ MultiblockIO::MultiblockIO(Session* session)
  * @param size total size of the payload of the message (no header)
  * @param answerExpected true, if message is a request-message
  * @param blockerId blocker-id in case that the message is a response
+ * @param multiblockId predefined id of the message or 0 to create a new one
+ * @param deadline deadline of the message, after which it is dropped from the queue
+ * @param methodId id of the remote procedure of a request or 0 for the standalone-callback
  *
  * @return
  */
@@ -52,7 +59,10 @@ std::pair<DataBuffer*, uint64_t>
 MultiblockIO::createOutgoingBuffer(const void* data,
                                    const uint64_t size,
                                    const bool answerExpected,
-                                   const uint64_t blockerId)
+                                   const uint64_t blockerId,
+                                   const uint64_t multiblockId,
+                                   const std::chrono::steady_clock::time_point &deadline,
+                                   const uint32_t methodId)
 {
     std::pair<DataBuffer*, uint64_t> result;
 
@@ -60,7 +70,7 @@ MultiblockIO::createOutgoingBuffer(const void* data,
     const uint32_t numberOfBlocks = static_cast<uint32_t>(size / 4096) + 1;
 
     // set or create id
-    const uint64_t newMultiblockId = getRandValue();
+    const uint64_t newMultiblockId = multiblockId != 0 ? multiblockId : getRandValue();
 
     // init new multiblock-message
     MultiblockMessage newMultiblockMessage;
@@ -68,6 +78,7 @@ MultiblockIO::createOutgoingBuffer(const void* data,
     newMultiblockMessage.messageSize = size;
     newMultiblockMessage.multiblockId = newMultiblockId;
     newMultiblockMessage.blockerId = blockerId;
+    newMultiblockMessage.deadline = deadline;
 
     // check if memory allocation was successful
     if(newMultiblockMessage.multiBlockBuffer == nullptr)
@@ -81,29 +92,76 @@ MultiblockIO::createOutgoingBuffer(const void* data,
     Kitsunemimi::addData_DataBuffer(*newMultiblockMessage.multiBlockBuffer, data, size);
 
     // put buffer into message-queue to be send in the background
+    startSendThread();
     while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
     m_outgoing.push_back(newMultiblockMessage);
     m_outgoing_lock.clear(std::memory_order_release);
 
     // send init-message to initialize the transfer for the data
-    send_Data_Multi_Init(m_session, newMultiblockId, size, answerExpected);
+    send_Data_Multi_Init(m_session,
+                         newMultiblockId,
+                         size,
+                         answerExpected,
+                         Session::getTimeBudget(deadline),
+                         methodId);
 
     result.second = newMultiblockId;
 
     return result;
 }
 
+/**
+ * @brief initialize multiblock-message with a buffer, which is shared with the outgoing queues of
+ *        other sessions. The buffer is only read while sending and released with the last
+ *        reference.
+ *
+ * @param sharedBuffer buffer with the payload of the message
+ * @param size total size of the payload of the message (no header)
+ *
+ * @return id of the new multiblock-message
+ */
+uint64_t
+MultiblockIO::createOutgoingBuffer(const std::shared_ptr<DataBuffer> &sharedBuffer,
+                                   const uint64_t size)
+{
+    const uint64_t newMultiblockId = getRandValue();
+
+    // init new multiblock-message
+    MultiblockMessage newMultiblockMessage;
+    newMultiblockMessage.sharedBuffer = sharedBuffer;
+    newMultiblockMessage.multiBlockBuffer = sharedBuffer.get();
+    newMultiblockMessage.messageSize = size;
+    newMultiblockMessage.multiblockId = newMultiblockId;
+
+    // put buffer into message-queue to be send in the background
+    startSendThread();
+    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_outgoing.push_back(newMultiblockMessage);
+    m_outgoing_lock.clear(std::memory_order_release);
+
+    // send init-message to initialize the transfer for the data
+    send_Data_Multi_Init(m_session, newMultiblockId, size, false);
+
+    return newMultiblockId;
+}
+
 /**
  * @brief create new buffer for the message
  *
  * @param multiblockId id of the multiblock-message
  * @param size size for the new buffer
+ * @param deadline deadline of the message, if it is a request
+ * @param isRequest true, if the message is a request, which has to be answered
+ * @param methodId id of the remote procedure of a request or 0 for the standalone-callback
  *
  * @return false, if allocation failed, else true
  */
 bool
 MultiblockIO::createIncomingBuffer(const uint64_t multiblockId,
-                                   const uint64_t size)
+                                   const uint64_t size,
+                                   const std::chrono::steady_clock::time_point &deadline,
+                                   const bool isRequest,
+                                   const uint32_t methodId)
 {
     const uint32_t numberOfBlocks = static_cast<uint32_t>(size / 4096) + 1;
 
@@ -112,6 +170,9 @@ MultiblockIO::createIncomingBuffer(const uint64_t multiblockId,
     newMultiblockMessage.multiBlockBuffer = new Kitsunemimi::DataBuffer(numberOfBlocks);
     newMultiblockMessage.messageSize = size;
     newMultiblockMessage.multiblockId = multiblockId;
+    newMultiblockMessage.deadline = deadline;
+    newMultiblockMessage.isRequest = isRequest;
+    newMultiblockMessage.methodId = methodId;
 
     // check if memory allocation was successful
     if(newMultiblockMessage.multiBlockBuffer == nullptr) {
@@ -156,7 +217,13 @@ MultiblockIO::makeOutgoingReady(const uint64_t multiblockId)
 
     m_outgoing_lock.clear(std::memory_order_release);
 
-    if(found) {
+    if(found)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_readyMutex);
+            m_readyCounter++;
+            m_readyCv.notify_one();
+        }
         continueThread();
     }
 
@@ -173,35 +240,54 @@ MultiblockIO::makeOutgoingReady(const uint64_t multiblockId)
 bool
 MultiblockIO::sendOutgoingData(const MultiblockMessage& messageBuffer)
 {
-    // counter values
-    uint64_t totalSize = messageBuffer.messageSize;
-    uint64_t currentMessageSize = 0;
-    uint32_t partCounter = 0;
+    const std::vector<std::shared_ptr<StripeSender>> stripes = m_session->getStripeSenders();
 
-    // static values
-    const uint32_t totalPartNumber = static_cast<uint32_t>(totalSize / MAX_SINGLE_MESSAGE_SIZE) + 1;
-    const uint8_t* dataPointer = getBlock_DataBuffer(*messageBuffer.multiBlockBuffer, 0);
-
-    while(totalSize != 0
-          && m_aborCurrentMessage == false)
+    if(stripes.size() > 0)
     {
-        // get message-size base on the rest
-        currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
-        if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
-            currentMessageSize = totalSize;
+        // send parts in parallel over the additional connections of the session
+        sendOverStripes(messageBuffer, stripes);
+    }
+    else
+    {
+        // counter values
+        uint64_t totalSize = messageBuffer.messageSize;
+        uint64_t currentMessageSize = 0;
+        uint32_t partCounter = 0;
+
+        // channels share the connection of their parent-session
+        Session* connectionOwner = m_session;
+        if(m_session->m_parentSession != nullptr) {
+            connectionOwner = m_session->m_parentSession;
         }
-        totalSize -= currentMessageSize;
 
-        // send single packet
-        // TODO: check return value
-        send_Data_Multi_Static(m_session,
-                               messageBuffer.multiblockId,
-                               totalPartNumber,
-                               partCounter,
-                               dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter),
-                               static_cast<uint32_t>(currentMessageSize));
+        // static values
+        const uint32_t totalPartNumber = static_cast<uint32_t>(totalSize / MAX_SINGLE_MESSAGE_SIZE)
+                                         + 1;
+        const uint8_t* dataPointer = getBlock_DataBuffer(*messageBuffer.multiBlockBuffer, 0);
 
-        partCounter++;
+        while(totalSize != 0
+              && m_aborCurrentMessage == false)
+        {
+            // get message-size base on the rest
+            currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
+            if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
+                currentMessageSize = totalSize;
+            }
+            totalSize -= currentMessageSize;
+
+            // send single packet, alternating with the parts of the other channels
+            // TODO: check return value
+            connectionOwner->acquireSendTurn();
+            send_Data_Multi_Static(m_session,
+                                   messageBuffer.multiblockId,
+                                   totalPartNumber,
+                                   partCounter,
+                                   dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter),
+                                   static_cast<uint32_t>(currentMessageSize));
+            connectionOwner->releaseSendTurn();
+
+            partCounter++;
+        }
     }
 
     // send final message to other side
@@ -223,13 +309,129 @@ MultiblockIO::sendOutgoingData(const MultiblockMessage& messageBuffer)
 
     // remove message from outgoing buffer
     while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
-    delete messageBuffer.multiBlockBuffer;
-    m_outgoing.pop_front();
+    std::deque<MultiblockMessage>::iterator it;
+    for(it = m_outgoing.begin();
+        it != m_outgoing.end();
+        it++)
+    {
+        if(it->multiblockId == messageBuffer.multiblockId)
+        {
+            m_outgoing.erase(it);
+            break;
+        }
+    }
+    deleteOutgoingBuffer(messageBuffer);
     m_outgoing_lock.clear(std::memory_order_release);
 
     return true;
 }
 
+/**
+ * @brief delete the buffer of an outgoing message, if it is not shared with other sessions.
+ *        Shared buffers are released by the last reference.
+ *
+ * @param message outgoing message
+ */
+void
+MultiblockIO::deleteOutgoingBuffer(const MultiblockMessage &message)
+{
+    if(message.sharedBuffer == nullptr) {
+        delete message.multiBlockBuffer;
+    }
+}
+
+/**
+ * @brief distribute the parts of a multi-block message round-robin over the stripes of the
+ *        session. Each stripe sends and encrypts its parts in its own thread. The number of
+ *        queued parts is limited, so the stripes run as pipeline while this thread prepares the
+ *        next parts.
+ *
+ * @param messageBuffer message to send
+ * @param stripes stripes of the session
+ *
+ * @return false, if aborted, else true
+ */
+bool
+MultiblockIO::sendOverStripes(const MultiblockMessage &messageBuffer,
+                              const std::vector<std::shared_ptr<StripeSender>> &stripes)
+{
+    // counter values
+    uint64_t totalSize = messageBuffer.messageSize;
+    uint64_t currentMessageSize = 0;
+    uint32_t partCounter = 0;
+
+    // static values
+    const uint32_t maxPendingParts = 4 * static_cast<uint32_t>(stripes.size());
+    const uint32_t totalPartNumber = static_cast<uint32_t>(totalSize / MAX_SINGLE_MESSAGE_SIZE) + 1;
+    const uint8_t* dataPointer = getBlock_DataBuffer(*messageBuffer.multiBlockBuffer, 0);
+
+    while(totalSize != 0
+          && m_aborCurrentMessage == false)
+    {
+        // get message-size base on the rest
+        currentMessageSize = MAX_SINGLE_MESSAGE_SIZE;
+        if(totalSize <= MAX_SINGLE_MESSAGE_SIZE) {
+            currentMessageSize = totalSize;
+        }
+        totalSize -= currentMessageSize;
+
+        StripeSender::StripePart part;
+        part.source = this;
+        part.multiblockId = messageBuffer.multiblockId;
+        part.totalPartNumber = totalPartNumber;
+        part.partId = partCounter;
+        part.data = dataPointer + (MAX_SINGLE_MESSAGE_SIZE * partCounter);
+        part.size = static_cast<uint32_t>(currentMessageSize);
+
+        // wait until there is space in the pipeline
+        {
+            std::unique_lock<std::mutex> lock(m_stripeMutex);
+            m_stripeCv.wait(lock, [this, maxPendingParts] {
+                return m_pendingStripeParts < maxPendingParts;
+            });
+            m_pendingStripeParts++;
+        }
+
+        stripes.at(partCounter % stripes.size())->addPart(part);
+        partCounter++;
+    }
+
+    // wait until all parts are send, because the finish-message goes over the main-connection
+    std::unique_lock<std::mutex> lock(m_stripeMutex);
+    m_stripeCv.wait(lock, [this] { return m_pendingStripeParts == 0; });
+
+    return m_aborCurrentMessage == false;
+}
+
+/**
+ * @brief check if the currently sending message was aborted
+ *
+ * @return true, if aborted, else false
+ */
+bool
+MultiblockIO::isCurrentMessageAborted() const
+{
+    return m_aborCurrentMessage;
+}
+
+/**
+ * @brief register, that a stripe has finished a part of the current message. If the part
+ *        couldn't be send, the message is aborted.
+ *
+ * @param successful false, if the part was not send
+ */
+void
+MultiblockIO::finishStripePart(const bool successful)
+{
+    if(successful == false) {
+        m_aborCurrentMessage = true;
+    }
+
+    std::lock_guard<std::mutex> guard(m_stripeMutex);
+    m_pendingStripeParts--;
+    m_stripeCv.notify_all();
+}
+
 /**
  * @brief get incoming buffer by its id
  *
@@ -242,7 +444,7 @@ MultiblockIO::getIncomingBuffer(const uint64_t multiblockId)
 {
     MultiblockMessage tempBuffer;
 
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
@@ -257,30 +459,98 @@ MultiblockIO::getIncomingBuffer(const uint64_t multiblockId)
 }
 
 /**
- * @brief append data to the data-buffer for the multiblock-message
+ * @brief write a part of a multiblock-message to its position within the data-buffer of the
+ *        message. When the parts are transfered over multiple stripes, they can arrive in any
+ *        order and even after the finish-message.
  *
  * @param multiblockId id of the multiblock-message
+ * @param partId id of the part within the message
  * @param data pointer to the data
  * @param size number of bytes
+ * @param completedMessage reference to the message-object, which is filled with the complete
+ *                         message, if this part was the last missing one after the
+ *                         finish-message. In this case the message is removed from the buffer.
  *
- * @return false, if session is not in the multiblock-transfer-state
+ * @return false, if the message doesn't exist or the part doesn't fit into the buffer, else true
  */
 bool
 MultiblockIO::writeIntoIncomingBuffer(const uint64_t multiblockId,
+                                      const uint32_t partId,
                                       const void* data,
-                                      const uint64_t size)
+                                      const uint64_t size,
+                                      MultiblockMessage &completedMessage)
 {
     bool result = false;
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
 
     if(it != m_incoming.end())
     {
-        result = Kitsunemimi::addData_DataBuffer(*it->second.multiBlockBuffer,
-                                                 data,
-                                                 size);
+        MultiblockMessage* message = &it->second;
+        const uint64_t offset = static_cast<uint64_t>(partId) * MAX_SINGLE_MESSAGE_SIZE;
+
+        if(offset + size <= message->messageSize)
+        {
+            uint8_t* target = static_cast<uint8_t*>(message->multiBlockBuffer->data);
+            memcpy(&target[offset], data, size);
+            message->receivedSize += size;
+            result = true;
+
+            if(message->finishReceived
+                    && message->receivedSize == message->messageSize)
+            {
+                message->multiBlockBuffer->bufferPosition = message->messageSize;
+                completedMessage = *message;
+                m_incoming.erase(it);
+            }
+        }
+    }
+
+    m_incoming_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief register the finish-message of a multiblock-message
+ *
+ * @param multiblockId id of the multiblock-message
+ * @param blockerId blocker-id in case that the message is a response
+ * @param isResponse true, if the message is a response
+ * @param completedMessage reference to the message-object, which is filled with the complete
+ *                         message, if all parts were already received. In this case the message
+ *                         is removed from the buffer.
+ *
+ * @return false, if the message doesn't exist, else true
+ */
+bool
+MultiblockIO::finishIncomingBuffer(const uint64_t multiblockId,
+                                   const uint64_t blockerId,
+                                   const bool isResponse,
+                                   MultiblockMessage &completedMessage)
+{
+    bool result = false;
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<uint64_t, MultiblockMessage>::iterator it;
+    it = m_incoming.find(multiblockId);
+
+    if(it != m_incoming.end())
+    {
+        MultiblockMessage* message = &it->second;
+        message->finishReceived = true;
+        message->blockerId = blockerId;
+        message->isResponse = isResponse;
+        result = true;
+
+        if(message->receivedSize == message->messageSize)
+        {
+            message->multiBlockBuffer->bufferPosition = message->messageSize;
+            completedMessage = *message;
+            m_incoming.erase(it);
+        }
     }
 
     m_incoming_lock.clear(std::memory_order_release);
@@ -314,10 +584,42 @@ MultiblockIO::removeOutgoingMessage(const uint64_t multiblockId)
             }
             else
             {
+                deleteOutgoingBuffer(*it);
                 m_outgoing.erase(it);
-                delete it->multiBlockBuffer;
                 result = true;
             }
+
+            break;
+        }
+    }
+
+    m_outgoing_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get the multiblock-id of an outgoing response
+ *
+ * @param blockerId blocker-id of the request, which is answered by the response
+ *
+ * @return multiblock-id of the response or 0, if there is no outgoing response for the request
+ */
+uint64_t
+MultiblockIO::getOutgoingResponseId(const uint64_t blockerId)
+{
+    uint64_t result = 0;
+    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::deque<MultiblockMessage>::iterator it;
+    for(it = m_outgoing.begin();
+        it != m_outgoing.end();
+        it++)
+    {
+        if(it->blockerId == blockerId)
+        {
+            result = it->multiblockId;
+            break;
         }
     }
 
@@ -327,8 +629,7 @@ MultiblockIO::removeOutgoingMessage(const uint64_t multiblockId)
 }
 
 /**
- * @brief remove message form the incomind-message-buffer, but without deleting the internal
- *        allocated memory.
+ * @brief remove an incomplete message form the incomind-message-buffer and delete its buffer
  *
  * @param multiblockId it of the multiblock-message
 
@@ -338,18 +639,15 @@ bool
 MultiblockIO::removeIncomingMessage(const uint64_t multiblockId)
 {
     bool result = false;
-    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
 
     std::map<uint64_t, MultiblockMessage>::iterator it;
     it = m_incoming.find(multiblockId);
 
     if(it != m_incoming.end())
     {
-        if(it->second.currentSend) {
-            m_aborCurrentMessage = true;
-        } else {
-            m_incoming.erase(it);
-        }
+        delete it->second.multiBlockBuffer;
+        m_incoming.erase(it);
         result = true;
     }
 
@@ -358,6 +656,48 @@ MultiblockIO::removeIncomingMessage(const uint64_t multiblockId)
     return result;
 }
 
+/**
+ * @brief start the thread to send the outgoing messages in the background. It is started with the
+ *        first outgoing multiblock-message and not already with the session, because most
+ *        sessions never send one.
+ */
+void
+MultiblockIO::startSendThread()
+{
+    if(m_threadStarted.test_and_set(std::memory_order_acq_rel) == false) {
+        startThread();
+    }
+}
+
+/**
+ * @brief delete all outgoing and incoming messages to reuse the object for another session
+ */
+void
+MultiblockIO::reset()
+{
+    while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    for(const MultiblockMessage &message : m_outgoing) {
+        deleteOutgoingBuffer(message);
+    }
+    m_outgoing.clear();
+    m_outgoing_lock.clear(std::memory_order_release);
+
+    while(m_incoming_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::map<uint64_t, MultiblockMessage>::iterator it;
+    for(it = m_incoming.begin();
+        it != m_incoming.end();
+        it++)
+    {
+        delete it->second.multiBlockBuffer;
+    }
+    m_incoming.clear();
+    m_incoming_lock.clear(std::memory_order_release);
+
+    std::lock_guard<std::mutex> guard(m_stripeMutex);
+    m_pendingStripeParts = 0;
+    m_aborCurrentMessage = false;
+}
+
 /**
  * @brief generate a new random 64bit-value, which is not 0
  *
@@ -377,9 +717,11 @@ MultiblockIO::getRandValue()
 }
 
 /**
- * @brief Main-loop to send data async, if some exist within the outgoing-message-buffer. If no
+ * @brief Main-loop to send data async, if some exist within the outgoing-message-buffer. The
+ *        messages are send in the order, in which the other side became ready for them. If no
  *        messages exist within the buffer, the loop is blocked until the next incoming
- *        init-reply-message.
+ *        init-reply-message. If there are only messages, for which the other side is not ready
+ *        yet, the loop waits until one of them became ready or the next deadline is reached.
  */
 void
 MultiblockIO::run()
@@ -387,35 +729,73 @@ MultiblockIO::run()
     while(m_abort == false)
     {
         MultiblockMessage tempBuffer;
-        while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+        std::vector<uint64_t> expiredMessages;
+        std::chrono::steady_clock::time_point nextDeadline = std::chrono::steady_clock::now()
+                                                             + std::chrono::seconds(1);
 
-        if(m_outgoing.empty() == false)
+        // get counter before checking the messages, so no ready-signal can be lost
+        uint64_t readyCounter = 0;
         {
-            tempBuffer = m_outgoing.front();
+            std::lock_guard<std::mutex> guard(m_readyMutex);
+            readyCounter = m_readyCounter;
+        }
 
-            if(tempBuffer.isReady)
+        while(m_outgoing_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+        const bool isEmpty = m_outgoing.empty();
+        std::deque<MultiblockMessage>::iterator it = m_outgoing.begin();
+        while(it != m_outgoing.end())
+        {
+            // drop an expired message, which is not waited for anymore
+            if(Session::isExpired(it->deadline))
             {
-                tempBuffer.currentSend = true;
+                expiredMessages.push_back(it->multiblockId);
+                deleteOutgoingBuffer(*it);
+                it = m_outgoing.erase(it);
+                continue;
             }
-            else
+
+            if(it->isReady)
             {
-                m_outgoing.pop_front();
-                m_outgoing.push_back(tempBuffer);
+                it->currentSend = true;
+                tempBuffer = *it;
+                break;
             }
 
-            m_outgoing_lock.clear(std::memory_order_release);
+            if(it->deadline != std::chrono::steady_clock::time_point()) {
+                nextDeadline = std::min(nextDeadline, it->deadline);
+            }
+            it++;
         }
-        else
+
+        m_outgoing_lock.clear(std::memory_order_release);
+
+        // inform the other side to remove the incomplete incoming messages
+        for(const uint64_t multiblockId : expiredMessages)
         {
-            // if buffer is emply, then block the thread
-            m_outgoing_lock.clear(std::memory_order_release);
-            blockThread();
+            send_Data_Multi_Abort_Reply(m_session,
+                                        multiblockId,
+                                        m_session->increaseMessageIdCounter());
         }
 
         // if a valid message was taken, then send the message
-        if(tempBuffer.multiBlockBuffer != nullptr) {
+        if(tempBuffer.multiBlockBuffer != nullptr)
+        {
             sendOutgoingData(tempBuffer);
         }
+        else if(isEmpty)
+        {
+            // if buffer is emply, then block the thread
+            blockThread();
+        }
+        else if(expiredMessages.size() == 0)
+        {
+            // wait until the other side is ready for one of the messages
+            std::unique_lock<std::mutex> lock(m_readyMutex);
+            m_readyCv.wait_until(lock, nextDeadline, [this, readyCounter] {
+                return m_readyCounter != readyCounter;
+            });
+        }
     }
 }
 
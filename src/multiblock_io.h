@@ -31,6 +31,12 @@
 #include <map>
 #include <string>
 
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <chrono>
+
 #include <libKitsunemimiCommon/buffer/data_buffer.h>
 #include <libKitsunemimiCommon/threading/thread.h>
 
@@ -39,6 +45,7 @@ namespace Kitsunemimi
 namespace Sakura
 {
 class Session;
+class StripeSender;
 
 class MultiblockIO
         : public Kitsunemimi::Thread
@@ -49,12 +56,21 @@ public:
     {
         bool isReady = false;
         bool currentSend = false;
+        bool finishReceived = false;
+        bool isResponse = false;
+        bool isRequest = false;
+        uint32_t methodId = 0;
         uint64_t blockerId = 0;
         uint64_t multiblockId = 0;
         uint64_t messageSize = 0;
+        uint64_t receivedSize = 0;
         uint32_t numberOfPackages = 0;
         uint32_t courrentPackage = 0;
         Kitsunemimi::DataBuffer* multiBlockBuffer = nullptr;
+        // set, if the buffer is shared read-only with the outgoing queues of other sessions
+        std::shared_ptr<Kitsunemimi::DataBuffer> sharedBuffer;
+        // deadline of a request or response, default-value if there is no deadline
+        std::chrono::steady_clock::time_point deadline;
     };
 
     MultiblockIO(Session* session);
@@ -65,9 +81,20 @@ public:
     std::pair<DataBuffer*, uint64_t> createOutgoingBuffer(const void* data,
                                                           const uint64_t size,
                                                           const bool answerExpected=false,
-                                                          const uint64_t blockerId=0);
+                                                          const uint64_t blockerId=0,
+                                                          const uint64_t multiblockId=0,
+                                                          const std::chrono::steady_clock::time_point
+                                                              &deadline
+                                                              = std::chrono::steady_clock::time_point(),
+                                                          const uint32_t methodId=0);
+    uint64_t createOutgoingBuffer(const std::shared_ptr<DataBuffer> &sharedBuffer,
+                                  const uint64_t size);
     bool createIncomingBuffer(const uint64_t multiblockId,
-                              const uint64_t size);
+                              const uint64_t size,
+                              const std::chrono::steady_clock::time_point &deadline
+                                  = std::chrono::steady_clock::time_point(),
+                              const bool isRequest = false,
+                              const uint32_t methodId = 0);
 
     // process outgoing
     bool makeOutgoingReady(const uint64_t multiblockId);
@@ -76,24 +103,52 @@ public:
     // process incoming
     MultiblockMessage getIncomingBuffer(const uint64_t multiblockId);
     bool writeIntoIncomingBuffer(const uint64_t multiblockId,
+                                 const uint32_t partId,
                                  const void* data,
-                                 const uint64_t size);
+                                 const uint64_t size,
+                                 MultiblockMessage &completedMessage);
+    bool finishIncomingBuffer(const uint64_t multiblockId,
+                              const uint64_t blockerId,
+                              const bool isResponse,
+                              MultiblockMessage &completedMessage);
 
     // remove
     bool removeOutgoingMessage(const uint64_t multiblockId=0);
+    uint64_t getOutgoingResponseId(const uint64_t blockerId);
     bool removeIncomingMessage(const uint64_t multiblockId);
 
+    void startSendThread();
+    void reset();
+
+    // stripes
+    bool isCurrentMessageAborted() const;
+    void finishStripePart(const bool successful);
+
     uint64_t getRandValue();
 
 protected:
     void run();
 
 private:
-    bool m_aborCurrentMessage = false;
+    std::atomic<bool> m_aborCurrentMessage;
+    std::atomic_flag m_threadStarted = ATOMIC_FLAG_INIT;
+
+    std::mutex m_stripeMutex;
+    std::condition_variable m_stripeCv;
+    uint32_t m_pendingStripeParts = 0;
+
+    void deleteOutgoingBuffer(const MultiblockMessage &message);
+    bool sendOverStripes(const MultiblockMessage &messageBuffer,
+                         const std::vector<std::shared_ptr<StripeSender>> &stripes);
 
     std::atomic_flag m_outgoing_lock = ATOMIC_FLAG_INIT;
     std::deque<MultiblockMessage> m_outgoing;
 
+    // signal for the send-thread, that an outgoing message became ready
+    std::mutex m_readyMutex;
+    std::condition_variable m_readyCv;
+    uint64_t m_readyCounter = 0;
+
     std::atomic_flag m_incoming_lock = ATOMIC_FLAG_INIT;
     std::map<uint64_t, MultiblockMessage> m_incoming;
 };
@@ -0,0 +1,104 @@
+/**
+ * @file       reuse_port_tcp_server.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "reuse_port_tcp_server.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <libKitsunemimiPersistence/logger/logger.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param target target for the callback, which is triggered for each new connection
+ * @param processConnection callback for new incoming connections
+ */
+ReusePortTcpServer::ReusePortTcpServer(void* target,
+                                       void (*processConnection)(void*,
+                                                                 Network::AbstractSocket*))
+    : Network::TcpServer(target, processConnection) {}
+
+/**
+ * @brief create the listen-socket with SO_REUSEPORT and bind it to the port
+ *
+ * @param port port where the server should listen
+ *
+ * @return false, if creating, binding or listening failed, else true
+ */
+bool
+ReusePortTcpServer::initServer(const uint16_t port)
+{
+    // create socket
+    const int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(serverSocket < 0)
+    {
+        LOG_ERROR("Failed to create a tcp-socket");
+        return false;
+    }
+
+    // make the port shareable with the other acceptors of the same port
+    const int enable = 1;
+    if(setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0
+            || setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)) < 0)
+    {
+        LOG_ERROR("Failed set socket-options for tcp-server on port: " + std::to_string(port));
+        close(serverSocket);
+        return false;
+    }
+
+    // bind to port
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_ANY);
+    server.sin_port = htons(port);
+    if(bind(serverSocket, reinterpret_cast<struct sockaddr*>(&server), sizeof(server)) < 0)
+    {
+        LOG_ERROR("Failed to bind tcp-socket to port: " + std::to_string(port));
+        close(serverSocket);
+        return false;
+    }
+
+    // start listening for incoming connections
+    if(listen(serverSocket, SOMAXCONN) == -1)
+    {
+        LOG_ERROR("Failed listen on tcp-socket on port: " + std::to_string(port));
+        close(serverSocket);
+        return false;
+    }
+
+    m_serverSocket = serverSocket;
+    LOG_INFO("Successfully initialized reuse-port tcp-server on port: " + std::to_string(port));
+
+    return true;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
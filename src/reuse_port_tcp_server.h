@@ -0,0 +1,52 @@
+/**
+ * @file       reuse_port_tcp_server.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef REUSE_PORT_TCP_SERVER_H
+#define REUSE_PORT_TCP_SERVER_H
+
+#include <libKitsunemimiNetwork/tcp/tcp_server.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief tcp-server, which opens its listen-socket with SO_REUSEPORT, so multiple instances of
+ *        this server can listen on the same port. The kernel distributes the incoming connections
+ *        over all listeners of the port, so each of them only have to accept a part of them.
+ *        Accepting and the socket-handling is inherited from the normal tcp-server.
+ */
+class ReusePortTcpServer
+        : public Network::TcpServer
+{
+public:
+    ReusePortTcpServer(void* target,
+                       void (*processConnection)(void*, Network::AbstractSocket*));
+
+    bool initServer(const uint16_t port);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // REUSE_PORT_TCP_SERVER_H
@@ -28,11 +28,18 @@
 #include <messages_processing/stream_data_processing.h>
 #include <messages_processing/multiblock_data_processing.h>
 #include <messages_processing/singleblock_data_processing.h>
+#include <messages_processing/pubsub_processing.h>
 
 #include <multiblock_io.h>
+#include <stripe_sender.h>
+#include <handler/topic_handler.h>
+#include <handler/request_scheduler.h>
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 
+#include <algorithm>
+#include <thread>
+
 enum statemachineItems {
     NOT_CONNECTED = 1,
     CONNECTED = 2,
@@ -59,10 +66,10 @@ namespace Sakura
 Session::Session(Network::AbstractSocket* socket)
 {
     m_multiblockIo = new MultiblockIO(this);
-    m_multiblockIo->startThread();
     m_socket = socket;
-
-    initStatemachine();
+    m_minTimeout = DEFAULT_MIN_TIMEOUT;
+    m_maxTimeout = DEFAULT_MAX_TIMEOUT;
+    m_state.store(NOT_CONNECTED, std::memory_order_release);
 }
 
 /**
@@ -71,6 +78,23 @@ Session::Session(Network::AbstractSocket* socket)
 Session::~Session()
 {
     closeSession(false);
+
+    // a session, which was never ready, is not removed by the close
+    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
+    if(sessionHandler != nullptr
+            && m_localSessionId != 0
+            && sessionHandler->getSession(m_localSessionId) == this)
+    {
+        sessionHandler->removeSession(m_localSessionId);
+    }
+
+    // the remaining references are held only for a short time by internal handlers, which are
+    // working on the session at the moment, like a heartbeat-check or a running request
+    while(isReferenced()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    m_multiblockIo->scheduleThreadForDeletion();
 }
 
 /**
@@ -83,7 +107,7 @@ bool
 Session::sendStreamData(StackBuffer &stackBuffer,
                         const bool replyExpected)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    if(isInState(ACTIVE))
     {
         std::deque<DataBuffer*>::iterator it;
         for(it = stackBuffer.blocks.begin();
@@ -113,7 +137,7 @@ Session::sendStreamData(const void* data,
                         const uint64_t size,
                         const bool replyExpected)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    if(isInState(ACTIVE))
     {
         uint64_t totalSize = size;
         uint64_t currentMessageSize = 0;
@@ -135,6 +159,7 @@ Session::sendStreamData(const void* data,
                                          static_cast<uint32_t>(currentMessageSize),
                                          replyExpected);
             result = result && ret;
+            partCounter++;
         }
 
         return result;
@@ -148,19 +173,26 @@ Session::sendStreamData(const void* data,
  *
  * @param data data-pointer
  * @param size number of bytes
+ * @param assurance delivery-assurance, if the data fit into a single-block-message
  *
  * @return
  */
 uint64_t
 Session::sendStandaloneData(const void* data,
-                            const uint64_t size)
+                            const uint64_t size,
+                            const deliveryAssurances assurance)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    if(isInState(ACTIVE))
     {
         if(size <= MAX_SINGLE_MESSAGE_SIZE)
         {
             const uint64_t singleblockId = m_multiblockIo->getRandValue();
-            send_Data_SingleBlock(this, singleblockId, data, size);
+            send_Data_SingleBlock(this,
+                                  singleblockId,
+                                  data,
+                                  static_cast<uint32_t>(size),
+                                  0,
+                                  isReplyExpected(assurance));
             return singleblockId;
         }
         else
@@ -175,55 +207,254 @@ Session::sendStandaloneData(const void* data,
 }
 
 /**
- * @brief Session::sendRequest
- * @param data
- * @param size
- * @param timeout
- * @return
+ * @brief send a request and wait for the response
+ *
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param timeout timeout in seconds or 0 to use the adaptive timeout of the session, which is
+ *                based on the latency of the previous requests
+ * @param assurance delivery-assurance, if the data fit into a single-block-message
+ *
+ * @return response-data or nullptr in case of a timeout or if the other side has rejected the
+ *         request because of overload
  */
 DataBuffer*
 Session::sendRequest(const void *data,
                      const uint64_t size,
-                     const uint64_t timeout)
+                     const uint64_t timeout,
+                     const deliveryAssurances assurance)
+{
+    return sendRpcRequest(0, data, size, timeout, assurance);
+}
+
+/**
+ * @brief send a request for a remote procedure and wait for the response. The method-id is
+ *        transfered within the message-header and the other side gives the request to the handler,
+ *        which was registered for the id.
+ *
+ * @param methodId id of the remote procedure or 0 for the standalone-callback of the other side
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param timeout timeout in seconds or 0 to use the adaptive timeout of the session
+ * @param assurance delivery-assurance, if the data fit into a single-block-message
+ *
+ * @return response-data or nullptr in case of a timeout or if the other side has rejected the
+ *         request because of overload or an unknown method
+ */
+DataBuffer*
+Session::sendRpcRequest(const uint32_t methodId,
+                        const void* data,
+                        const uint64_t size,
+                        const uint64_t timeout,
+                        const deliveryAssurances assurance)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    if(isInState(ACTIVE))
     {
         uint64_t id = 0;
+        const uint64_t timeoutMs = timeout == 0 ? getRequestTimeout() : timeout * 1000;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point deadline = start
+                                                               + std::chrono::milliseconds(timeoutMs);
 
         if(size <= MAX_SINGLE_MESSAGE_SIZE)
         {
+            // register blocker before sending, because the response can arrive before this
+            // thread would reach the wait
             id = m_multiblockIo->getRandValue();
+            SessionHandler::m_blockerHandler->registerBlocker(id, timeoutMs, this);
             send_Data_SingleBlock(this,
                                   id,
                                   data,
-                                  static_cast<uint32_t>(size));
+                                  static_cast<uint32_t>(size),
+                                  0,
+                                  isReplyExpected(assurance),
+                                  getTimeBudget(deadline),
+                                  true,
+                                  methodId);
         }
         else
         {
+            // the response can not arrive before the handshake of the multi-block-message
             std::pair<DataBuffer*, uint64_t> result;
-            result = m_multiblockIo->createOutgoingBuffer(data, size, true);
+            result = m_multiblockIo->createOutgoingBuffer(data,
+                                                          size,
+                                                          true,
+                                                          0,
+                                                          0,
+                                                          deadline,
+                                                          methodId);
             id = result.second;
+            SessionHandler::m_blockerHandler->registerBlocker(id, timeoutMs, this);
+        }
+
+        bool rejected = false;
+        DataBuffer* response = SessionHandler::m_blockerHandler->waitForBlocker(id, &rejected);
+
+        // update the estimation of the request-latency. A request, which was rejected by the
+        // other side because of overload, is neither cancelled nor a reason for a backoff.
+        if(response != nullptr)
+        {
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            const uint64_t latency = static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+            addRequestLatency(latency);
+        }
+        else if(rejected == false)
+        {
+            cancelRequest(id);
+            if(timeout == 0) {
+                backoffRequestTimeout();
+            }
         }
 
-        return SessionHandler::m_blockerHandler->blockMessage(id, timeout, this);
+        return response;
     }
 
     return nullptr;
 }
 
+/**
+ * @brief send a batch of independent requests and wait for all responses. All single-block
+ *        requests are send with a single write and all blockers share the same deadline, so the
+ *        complete batch needs only one round-trip.
+ *
+ * @param batch list of requests, which get their response and state
+ * @param timeout timeout of the complete batch in seconds or 0 to use the adaptive timeout of
+ *                the session
+ * @param assurance delivery-assurance of the single-block-messages
+ *
+ * @return number of successful requests
+ */
+uint64_t
+Session::sendRequests(std::vector<RequestItem> &batch,
+                      const uint64_t timeout,
+                      const deliveryAssurances assurance)
+{
+    if(isInState(ACTIVE) == false
+            || batch.size() == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t timeoutMs = timeout == 0 ? getRequestTimeout() : timeout * 1000;
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+    std::vector<uint64_t> ids(batch.size(), 0);
+
+    // build all small requests into one buffer
+    std::vector<uint8_t> messageBuffer;
+    std::vector<uint64_t> messagePositions;
+    for(uint64_t i = 0; i < batch.size(); i++)
+    {
+        if(batch[i].size <= MAX_SINGLE_MESSAGE_SIZE)
+        {
+            ids[i] = m_multiblockIo->getRandValue();
+            build_Data_SingleBlock(messageBuffer,
+                                   messagePositions,
+                                   ids[i],
+                                   batch[i].data,
+                                   static_cast<uint32_t>(batch[i].size),
+                                   getTimeBudget(deadline),
+                                   true,
+                                   batch[i].methodId);
+        }
+    }
+
+    // register all blockers before sending, because the responses can arrive before this
+    // thread would reach the wait
+    std::vector<uint64_t> singleblockIds;
+    for(const uint64_t id : ids)
+    {
+        if(id != 0) {
+            singleblockIds.push_back(id);
+        }
+    }
+    SessionHandler::m_blockerHandler->registerBlockers(singleblockIds, timeoutMs, this);
+
+    if(messageBuffer.size() > 0)
+    {
+        SessionHandler::m_sessionHandler->sendPreparedMessages(this,
+                                                               &messageBuffer[0],
+                                                               messageBuffer.size(),
+                                                               messagePositions,
+                                                               assurance);
+    }
+
+    // large requests go over the multiblock-queue
+    for(uint64_t i = 0; i < batch.size(); i++)
+    {
+        if(batch[i].size > MAX_SINGLE_MESSAGE_SIZE)
+        {
+            std::pair<DataBuffer*, uint64_t> result;
+            result = m_multiblockIo->createOutgoingBuffer(batch[i].data,
+                                                          batch[i].size,
+                                                          true,
+                                                          0,
+                                                          0,
+                                                          deadline,
+                                                          batch[i].methodId);
+            ids[i] = result.second;
+            if(ids[i] != 0) {
+                SessionHandler::m_blockerHandler->registerBlocker(ids[i], timeoutMs, this);
+            }
+        }
+    }
+
+    // collect the responses. All blockers share the same deadline, so the complete wait is
+    // limited by the timeout
+    uint64_t numberOfSuccessful = 0;
+    for(uint64_t i = 0; i < batch.size(); i++)
+    {
+        if(ids[i] == 0)
+        {
+            batch[i].state = REQUEST_NOT_SEND;
+            continue;
+        }
+
+        bool rejected = false;
+        batch[i].response = SessionHandler::m_blockerHandler->waitForBlocker(ids[i], &rejected);
+        if(batch[i].response != nullptr)
+        {
+            batch[i].state = REQUEST_SUCCESSFUL;
+            numberOfSuccessful++;
+        }
+        else if(rejected)
+        {
+            batch[i].state = REQUEST_REJECTED;
+        }
+        else
+        {
+            batch[i].state = REQUEST_TIMEOUT;
+            cancelRequest(ids[i]);
+        }
+    }
+
+    return numberOfSuccessful;
+}
+
 /**
  * @brief Session::sendResponse
  * @param data
  * @param size
  * @param blockerId
+ * @param assurance delivery-assurance, if the data fit into a single-block-message
  * @return
  */
 uint64_t
 Session::sendResponse(const void *data,
                       const uint64_t size,
-                      const uint64_t blockerId)
+                      const uint64_t blockerId,
+                      const deliveryAssurances assurance)
 {
-    if(m_statemachine.isInState(ACTIVE))
+    // the other side doesn't wait for the response anymore
+    const std::chrono::steady_clock::time_point deadline = removeRequestDeadline(blockerId);
+    if(removeCancelledRequest(blockerId)
+            || isExpired(deadline))
+    {
+        return 0;
+    }
+
+    if(isInState(ACTIVE))
     {
         if(size < MAX_SINGLE_MESSAGE_SIZE)
         {
@@ -232,13 +463,20 @@ Session::sendResponse(const void *data,
                                   singleblockId,
                                   data,
                                   static_cast<uint32_t>(size),
-                                  blockerId);
+                                  blockerId,
+                                  isReplyExpected(assurance),
+                                  getTimeBudget(deadline));
             return singleblockId;
         }
         else
         {
             std::pair<DataBuffer*, uint64_t> result;
-            result = m_multiblockIo->createOutgoingBuffer(data, size, false, blockerId);
+            result = m_multiblockIo->createOutgoingBuffer(data,
+                                                          size,
+                                                          false,
+                                                          blockerId,
+                                                          0,
+                                                          deadline);
             return result.second;
         }
     }
@@ -246,6 +484,116 @@ Session::sendResponse(const void *data,
     return 0;
 }
 
+/**
+ * @brief check if the other side has cancelled a request, for example because of a timeout, or if
+ *        the deadline of the request has passed. This can be used as cancellation-token within the
+ *        callback for standalone-messages, to stop the processing of a request, which is not
+ *        waited for anymore.
+ *
+ * @param blockerId blocker-id of the request, which was given to the callback
+ *
+ * @return true, if the request was cancelled or is expired, else false
+ */
+bool
+Session::isRequestCancelled(const uint64_t blockerId)
+{
+    bool result = false;
+
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::unordered_map<uint64_t, RequestState>::const_iterator it;
+    it = m_requestStates.find(blockerId);
+    if(it != m_requestStates.end())
+    {
+        result = it->second.cancelled
+                 || isExpired(it->second.deadline);
+    }
+
+    m_cancel_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief subscribe to a topic on the other side of the session
+ *
+ * @param topic name of the topic (max 64 characters)
+ * @param policy behavior of the other side, if this subscriber is too slow: drop messages or
+ *               block the publisher until there is space in the queue
+ *
+ * @return false if session is NOT ready or topic is invalid, else true
+ */
+bool
+Session::subscribe(const std::string &topic,
+                   const subscriberPolicies policy)
+{
+    if(topic.size() > 64) {
+        return false;
+    }
+
+    if(isInState(ACTIVE)) {
+        return send_PubSub_Subscribe(this, topic, static_cast<uint8_t>(policy));
+    }
+
+    return false;
+}
+
+/**
+ * @brief unsubscribe from a topic on the other side of the session
+ *
+ * @param topic name of the topic (max 64 characters)
+ *
+ * @return false if session is NOT ready or topic is invalid, else true
+ */
+bool
+Session::unsubscribe(const std::string &topic)
+{
+    if(topic.size() > 64) {
+        return false;
+    }
+
+    if(isInState(ACTIVE)) {
+        return send_PubSub_Unsubscribe(this, topic);
+    }
+
+    return false;
+}
+
+/**
+ * @brief publish data to a topic. The other side forwards the message to all subscribers of
+ *        the topic.
+ *
+ * @param topic name of the topic (max 64 characters)
+ * @param data data-pointer
+ * @param size number of bytes (max 128 KiB)
+ *
+ * @return false if session is NOT ready or topic or size are invalid, else true
+ */
+bool
+Session::publish(const std::string &topic,
+                 const void* data,
+                 const uint64_t size)
+{
+    if(topic.size() > 64
+            || size > MAX_SINGLE_MESSAGE_SIZE)
+    {
+        return false;
+    }
+
+    if(isInState(ACTIVE))
+    {
+        std::shared_ptr<const std::vector<uint8_t>> message;
+        message = build_PubSub_Publish(sessionId(),
+                                       increaseMessageIdCounter(),
+                                       topic,
+                                       data,
+                                       static_cast<uint32_t>(size));
+        return m_socket->sendMessage(&(*message)[0], message->size());
+    }
+
+    return false;
+}
+
 /**
  * @brief abort a multi-block-message
  *
@@ -295,6 +643,20 @@ Session::setErrorCallback(void (*processError)(Session*,
     m_processError = processError;
 }
 
+/**
+ * @brief set callback for messages, which were published to a subscribed topic
+ *
+ * @param processPublish new callback
+ */
+void
+Session::setPublishMessageCallback(void (*processPublish)(Session*,
+                                                          const std::string,
+                                                          const void*,
+                                                          const uint64_t))
+{
+    m_processPublish = processPublish;
+}
+
 /**
  * @brief close the session inclusive multiblock-messages, statemachine, message to the other side
  *        and close the socket
@@ -307,9 +669,9 @@ bool
 Session::closeSession(const bool replyExpected)
 {
     LOG_DEBUG("close session with id " + std::to_string(m_sessionId));
-    if(m_statemachine.isInState(SESSION_READY))
+    if(isInState(SESSION_READY))
     {
-        SessionHandler::m_replyHandler->removeAllOfSession(m_sessionId);
+        SessionHandler::m_replyHandler->removeAllOfSession(this);
         m_multiblockIo->removeOutgoingMessage(0);
         if(replyExpected)
         {
@@ -349,158 +711,471 @@ Session::isClientSide() const
 }
 
 /**
- * @brief Session::getLinkedSession
- * @return
+ * @brief check if the session is ready to send data
+ *
+ * @return true, if session is active, else false
  */
-Session*
-Session::getLinkedSession()
+bool
+Session::isActive()
 {
-    Session* result = nullptr;
+    return isInState(ACTIVE);
+}
 
-    while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
-    }
-    result = m_linkedSession;
-    m_linkSession_lock.clear(std::memory_order_release);
+/**
+ * @brief get the number of heartbeats, which were send since the last heartbeat-reply of the
+ *        other side, to check the health of the connection
+ *
+ * @return number of unanswered heartbeats
+ */
+uint32_t
+Session::missedHeartbeats() const
+{
+    return m_missedHeartbeats.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief get the latency to the other side, which is estimated by the heartbeats
+ *
+ * @return smoothed round-trip-time, its variance and the clock-offset to the other side
+ */
+Session::LatencyInfo
+Session::getLatencyInfo()
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const LatencyInfo result = m_latency;
+    m_latency_lock.clear(std::memory_order_release);
 
     return result;
 }
 
 /**
- * @brief create the network connection of the session
+ * @brief set the delivery-assurance of single-block-messages for the complete session, which is
+ *        used, if the send-call doesn't define it by itself
  *
- * @param sessionId id for the session
- * @param sessionIdentifier session-identifier value to identify the session on server-side
- *                          before the first data-message was send
- * @param init true to start the initial message-transfer
+ * @param assurance new delivery-assurance
  *
- * @return false if session is already init or socker can not be connected, else true
+ * @return false, if assurance is SESSION_DEFAULT, else true
  */
 bool
-Session::connectiSession(const uint32_t sessionId)
+Session::setDeliveryAssurance(const deliveryAssurances assurance)
 {
-    LOG_DEBUG("CALL session connect: " + std::to_string(m_sessionId));
-
-    // check if already connected
-    if(m_statemachine.isInState(NOT_CONNECTED))
-    {
-        // connect socket
-        if(m_socket->initClientSide() == false)
-        {
-            m_cv.notify_one();
-            return false;
-        }
-
-        // git into connected state
-        if(m_statemachine.goToNextState(CONNECT) == false)
-        {
-            m_cv.notify_one();
-            return false;
-        }
-        m_sessionId = sessionId;
-        m_socket->startThread();
-
-        return true;
+    if(assurance == SESSION_DEFAULT) {
+        return false;
     }
 
-    m_cv.notify_one();
-
-    return false;
+    m_deliveryAssurance.store(assurance, std::memory_order_relaxed);
+    return true;
 }
 
 /**
- * @brief bring the session into ready-state after a successful initial message-transfer
+ * @brief check if a single-block-message has to be confirmed by the other side
  *
- * @param sessionId final id for the session
- * @param sessionIdentifier session-identifier value to identify the session on server-side
- *                          before the first data-message was send
+ * @param assurance delivery-assurance of the send-call
  *
- * @return false, if session is already in ready-state, else true
+ * @return true, if a transport-reply is expected, else false
  */
 bool
-Session::makeSessionReady(const uint32_t sessionId,
-                          const std::string &sessionIdentifier)
+Session::isReplyExpected(const deliveryAssurances assurance) const
 {
-    LOG_DEBUG("CALL make session ready: " + std::to_string(m_sessionId));
-
-    if(m_statemachine.goToNextState(START_SESSION, SESSION_NOT_READY))
-    {
-        m_sessionId = sessionId;
-        m_sessionIdentifier = sessionIdentifier;
-
-        m_processCreateSession(this, m_sessionIdentifier);
-
-        // release blocked session on client-side
-        m_cv.notify_one();
-
-        return true;
+    if(assurance != SESSION_DEFAULT) {
+        return assurance == TRANSPORT_REPLY;
     }
 
-    m_cv.notify_one();
-
-    return false;
+    return m_deliveryAssurance.load(std::memory_order_relaxed) == TRANSPORT_REPLY;
 }
 
 /**
- * @brief stop the session to prevent it from all data-transfers. Delete the session from the
- *        session-handler and close the socket.
+ * @brief set the bounds of the adaptive timeouts of the session
  *
- * @param init true, if the caller of the methods initialize the closing process for the session
+ * @param minTimeoutMs lower bound in milliseconds
+ * @param maxTimeoutMs upper bound in milliseconds
  *
- * @return true, if statechange and socket-disconnect were successful, else false
+ * @return false, if the bounds are invalid, else true
  */
 bool
-Session::endSession()
+Session::setTimeoutBounds(const uint32_t minTimeoutMs,
+                          const uint32_t maxTimeoutMs)
 {
-    LOG_DEBUG("CALL session close: " + std::to_string(m_sessionId));
-
-    // try to stop the session
-    if(m_statemachine.goToNextState(STOP_SESSION))
+    if(minTimeoutMs == 0
+            || minTimeoutMs > maxTimeoutMs)
     {
-        m_processCloseSession(this, m_sessionIdentifier);
-        SessionHandler::m_sessionHandler->removeSession(m_sessionId);
-        return disconnectSession();
+        return false;
     }
 
-    return false;
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_minTimeout = minTimeoutMs;
+    m_maxTimeout = maxTimeoutMs;
+    m_latency_lock.clear(std::memory_order_release);
+
+    return true;
 }
 
 /**
- * @brief disconnect the socket within the sesson
+ * @brief get the timeout for the reply of a tracked message, which is based on the latency of the
+ *        previous replies or, before the first reply, on the round-trip-time of the heartbeats
  *
- * @return true, is state-change of the statemachine and closing sthe socket were successful,
- *         else false
+ * @return timeout in milliseconds
  */
-bool
-Session::disconnectSession()
+uint32_t
+Session::getReplyTimeout()
 {
-    LOG_DEBUG("CALL session disconnect: " + std::to_string(m_sessionId));
-
-    if(m_statemachine.goToNextState(DISCONNECT))  {
-        const bool ret = m_socket->closeSocket();
-        if(ret == false) {
-            return false;
-        }
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const LatencyInfo &latency = m_replyLatency.numberOfSamples > 0 ? m_replyLatency : m_latency;
+    const uint32_t result = calculateTimeout(latency, INITIAL_REPLY_TIMEOUT, m_replyBackoff);
+    m_latency_lock.clear(std::memory_order_release);
 
-        m_socket->scheduleThreadForDeletion();
-
-        return true;
-    }
-
-    return false;
+    return result;
 }
 
 /**
- * @brief send a heartbeat-message
+ * @brief get the adaptive timeout for requests, which is based on the latency of the previous
+ *        requests. Before the first response, the upper bound is used.
  *
- * @return true, if session is ready, else false
+ * @return timeout in milliseconds
  */
-bool
-Session::sendHeartbeat()
+uint32_t
+Session::getRequestTimeout()
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    const uint32_t result = calculateTimeout(m_requestLatency, m_maxTimeout, m_requestBackoff);
+    m_latency_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get a percentile of the latest request-latencies
+ *
+ * @param percentile requested percentile (for example 95 for the p95)
+ * @param minNumberOfSamples minimum number of measured latencies
+ *
+ * @return latency in microseconds or 0, if there are not enough measurements
+ */
+uint64_t
+Session::getRequestLatencyPercentile(const uint32_t percentile,
+                                     const uint64_t minNumberOfSamples)
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<uint64_t> history = m_requestLatencyHistory;
+    m_latency_lock.clear(std::memory_order_release);
+
+    if(history.size() == 0
+            || history.size() < minNumberOfSamples)
+    {
+        return 0;
+    }
+
+    uint64_t pos = (history.size() * std::min(percentile, 100u)) / 100;
+    if(pos >= history.size()) {
+        pos = history.size() - 1;
+    }
+    std::nth_element(history.begin(), history.begin() + static_cast<long>(pos), history.end());
+
+    return history[pos];
+}
+
+/**
+ * @brief open a new logical session (channel), which shares the connection of this session. The
+ *        channel has its own session-id, callbacks and multi-block-queue, but no own socket,
+ *        receive-thread or heartbeats. Messages of the channel are demultiplexed by the
+ *        session-id within the header. The channel belongs to the library and must not be
+ *        deleted. It is released after it was closed by itself or together with this session.
+ *
+ * @param channelIdentifier additional identifier as help for an upper processing-layer
+ * @param timeoutMs time in milliseconds to wait for the reply of the other side
+ *
+ * @return new channel, if successful, else nullptr
+ */
+Session*
+Session::openChannel(const std::string &channelIdentifier,
+                     const uint32_t timeoutMs)
+{
+    // precheck
+    if(channelIdentifier.size() > 64
+            || m_parentSession != nullptr
+            || isInState(ACTIVE) == false)
+    {
+        return nullptr;
+    }
+
+    // create new channel with the callbacks of this session as default
+    Session* channel = SessionHandler::m_sessionHandler->createSession(m_socket);
+    channel->m_parentSession = this;
+    channel->m_processStreamData = m_processStreamData;
+    channel->m_processStandaloneData = m_processStandaloneData;
+    channel->m_processPublish = m_processPublish;
+
+    const uint32_t newId = SessionHandler::m_sessionHandler->allocateSessionId();
+    channel->connectChannel(newId);
+    SessionHandler::m_sessionHandler->addSession(newId, channel);
+    addChannel(newId, channel);
+    send_Session_Init_Start(channel, channelIdentifier, true);
+
+    // wait for the reply of the other side
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+    if(channel->waitUntilReady(deadline) == false)
+    {
+        LOG_ERROR("timeout while opening channel for session " + std::to_string(m_sessionId));
+
+        // if this session was closed in the meantime, the channel is already released
+        if(removeChannel(newId) != nullptr)
+        {
+            SessionHandler::m_sessionHandler->removeSession(newId);
+            channel->disconnectSession();
+            SessionHandler::m_sessionHandler->recycleSession(channel);
+        }
+        return nullptr;
+    }
+
+    return channel;
+}
+
+/**
+ * @brief check if session is a channel over the connection of another session
+ *
+ * @return true, if channel, else false
+ */
+bool
+Session::isChannel() const
+{
+    return m_parentSession != nullptr;
+}
+
+/**
+ * @brief Session::getLinkedSession
+ * @return
+ */
+Session*
+Session::getLinkedSession()
+{
+    Session* result = nullptr;
+
+    while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+        asm("");
+    }
+    result = m_linkedSession;
+    m_linkSession_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get a copy of all sessions, to which the incoming messages of this session are forwarded
+ *
+ * @return list of sessions of the link-group
+ */
+std::vector<Session*>
+Session::getLinkGroup()
+{
+    while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+        asm("");
+    }
+    std::vector<Session*> result = m_linkGroup;
+    m_linkSession_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief create the network connection of the session
+ *
+ * @param sessionId id for the session
+ * @param sessionIdentifier session-identifier value to identify the session on server-side
+ *                          before the first data-message was send
+ * @param init true to start the initial message-transfer
+ *
+ * @return false if session is already init or socker can not be connected, else true
+ */
+bool
+Session::connectiSession(const uint32_t sessionId)
+{
+    LOG_DEBUG("CALL session connect: " + std::to_string(m_sessionId));
+
+    // check if already connected
+    if(isInState(NOT_CONNECTED))
+    {
+        // connect socket
+        if(m_socket->initClientSide() == false)
+        {
+            m_cv.notify_one();
+            return false;
+        }
+
+        // git into connected state
+        if(goToNextState(CONNECT) == false)
+        {
+            m_cv.notify_one();
+            return false;
+        }
+        m_sessionId = sessionId;
+        m_localSessionId = sessionId;
+        m_socket->startThread();
+
+        return true;
+    }
+
+    m_cv.notify_one();
+
+    return false;
+}
+
+/**
+ * @brief bring a channel into connected state without connecting a socket, because it uses the
+ *        already connected socket of its parent-session
+ *
+ * @param sessionId id for the channel
+ *
+ * @return false, if already connected, else true
+ */
+bool
+Session::connectChannel(const uint32_t sessionId)
+{
+    if(goToNextState(CONNECT))
+    {
+        m_sessionId = sessionId;
+        m_localSessionId = sessionId;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief wait until the other side has replied to the init-message and the session is ready
+ *
+ * @param deadline point in time, until the session must be ready
+ *
+ * @return true, if ready, else false
+ */
+bool
+Session::waitUntilReady(const std::chrono::steady_clock::time_point &deadline)
+{
+    std::unique_lock<std::mutex> lock(m_cvMutex);
+    return m_cv.wait_until(lock, deadline, [this] {
+        return isInState(SESSION_READY);
+    });
+}
+
+/**
+ * @brief bring the session into ready-state after a successful initial message-transfer
+ *
+ * @param sessionId final id for the session
+ * @param sessionIdentifier session-identifier value to identify the session on server-side
+ *                          before the first data-message was send
+ *
+ * @return false, if session is already in ready-state, else true
+ */
+bool
+Session::makeSessionReady(const uint32_t sessionId,
+                          const std::string &sessionIdentifier)
+{
+    LOG_DEBUG("CALL make session ready: " + std::to_string(m_sessionId));
+
+    if(goToNextState(START_SESSION))
+    {
+        m_sessionId = sessionId;
+        m_sessionIdentifier = sessionIdentifier;
+
+        m_processCreateSession(this, m_sessionIdentifier);
+
+        // release blocked session on client-side
+        std::lock_guard<std::mutex> guard(m_cvMutex);
+        m_cv.notify_one();
+
+        return true;
+    }
+
+    std::lock_guard<std::mutex> guard(m_cvMutex);
+    m_cv.notify_one();
+
+    return false;
+}
+
+/**
+ * @brief stop the session to prevent it from all data-transfers. Delete the session from the
+ *        session-handler and close the socket.
+ *
+ * @param init true, if the caller of the methods initialize the closing process for the session
+ *
+ * @return true, if statechange and socket-disconnect were successful, else false
+ */
+bool
+Session::endSession()
 {
-    if(m_statemachine.isInState(SESSION_READY))
+    LOG_DEBUG("CALL session close: " + std::to_string(m_sessionId));
+
+    // try to stop the session
+    if(goToNextState(STOP_SESSION))
     {
-        send_Heartbeat_Start(this);
+        // remove from link-group to stop the forwarding to this session
+        while (m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+            asm("");
+        }
+        Session* linkGroupSource = m_linkGroupSource;
+        m_linkSession_lock.clear(std::memory_order_release);
+        if(linkGroupSource != nullptr) {
+            SessionController::m_sessionController->removeFromLinkGroup(linkGroupSource, this);
+        }
+
+        // detach all sessions of the own link-group, so they don't point to this session anymore
+        for(Session* target : getLinkGroup()) {
+            SessionController::m_sessionController->removeFromLinkGroup(this, target);
+        }
+
+        SessionHandler::m_topicHandler->removeSession(this);
+        SessionHandler::m_requestScheduler->removeSession(this);
+
+        m_processCloseSession(this, m_sessionIdentifier);
+        SessionHandler::m_sessionHandler->removeSession(m_localSessionId);
+
+        // the socket is already scheduled for deletion after the disconnect
+        const bool isLibraryOwned = m_socket->isClientSide() == false
+                                    || m_parentSession != nullptr;
+        if(disconnectSession() == false) {
+            return false;
+        }
+
+        // server-side sessions and channels are created by the library and so they are also
+        // reused by it
+        if(isLibraryOwned) {
+            SessionHandler::m_sessionHandler->recycleSession(this);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief disconnect the socket within the sesson
+ *
+ * @return true, is state-change of the statemachine and closing sthe socket were successful,
+ *         else false
+ */
+bool
+Session::disconnectSession()
+{
+    LOG_DEBUG("CALL session disconnect: " + std::to_string(m_sessionId));
+
+    if(goToNextState(DISCONNECT))  {
+        // channels share the socket of the parent-session, which stays open
+        if(m_parentSession != nullptr)
+        {
+            m_parentSession->removeChannel(m_sessionId);
+            return true;
+        }
+
+        closeChannels();
+        closeStripes();
+        const bool ret = m_socket->closeSocket();
+        if(ret == false) {
+            return false;
+        }
+
+        m_socket->scheduleThreadForDeletion();
+
         return true;
     }
 
@@ -508,32 +1183,844 @@ Session::sendHeartbeat()
 }
 
 /**
- * @brief init the statemachine
+ * @brief reset a closed session to reuse the object and its resources for a new connection
+ *
+ * @param socket socket of the new connection
+ */
+void
+Session::resetSession(Network::AbstractSocket* socket)
+{
+    m_socket = socket;
+    m_sessionId = 0;
+    m_localSessionId = 0;
+    m_sessionIdentifier = "";
+
+    while(m_linkSession_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_linkedSession = nullptr;
+    m_linkGroup.clear();
+    m_linkGroupSource = nullptr;
+    m_linkSession_lock.clear(std::memory_order_release);
+
+    m_processStreamData = nullptr;
+    m_processStandaloneData = nullptr;
+    m_processPublish = nullptr;
+
+    while(m_messageIdCounter_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_messageIdCounter = 0;
+    m_messageIdCounter_lock.clear(std::memory_order_release);
+    m_deliveryAssurance.store(TRANSPORT_REPLY, std::memory_order_relaxed);
+
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_requestStates.clear();
+    m_requestStatePurgeLimit = MIN_REQUEST_STATE_PURGE;
+    m_cancel_lock.clear(std::memory_order_release);
+    m_missedHeartbeats.store(0, std::memory_order_relaxed);
+    m_inboundTraffic.store(false, std::memory_order_relaxed);
+    m_nextHeartbeatTick = 0;
+    m_heartbeatInterval = 0;
+
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_latency = LatencyInfo();
+    m_replyLatency = LatencyInfo();
+    m_requestLatency = LatencyInfo();
+    m_replyBackoff = 1;
+    m_requestBackoff = 1;
+    m_requestLatencyHistory.clear();
+    m_requestLatencyPos = 0;
+    m_hasClockOffset = false;
+    m_minTimeout = DEFAULT_MIN_TIMEOUT;
+    m_maxTimeout = DEFAULT_MAX_TIMEOUT;
+    m_latency_lock.clear(std::memory_order_release);
+
+    while(m_stripe_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_stripeSenders.clear();
+    m_stripeToken = 0;
+    m_stripe_lock.clear(std::memory_order_release);
+
+    while(m_channel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_parentSession = nullptr;
+    m_channels.clear();
+    m_channel_lock.clear(std::memory_order_release);
+
+    m_multiblockIo->reset();
+    m_state.store(NOT_CONNECTED, std::memory_order_release);
+}
+
+/**
+ * @brief update the latency-estimation with the timestamps of a heartbeat-exchange. The
+ *        round-trip-time is smoothed like the rtt of tcp (RFC 6298) and the clock-offset is
+ *        calculated like in NTP.
+ *
+ * @param originSendTime own timestamp, when the heartbeat was send
+ * @param remoteReceiveTime timestamp of the other side, when the heartbeat was received
+ * @param remoteSendTime timestamp of the other side, when the reply was send
+ * @param receiveTime own timestamp, when the reply was received
+ */
+void
+Session::updateLatency(const uint64_t originSendTime,
+                       const uint64_t remoteReceiveTime,
+                       const uint64_t remoteSendTime,
+                       const uint64_t receiveTime)
+{
+    const int64_t t1 = static_cast<int64_t>(originSendTime);
+    const int64_t t2 = static_cast<int64_t>(remoteReceiveTime);
+    const int64_t t3 = static_cast<int64_t>(remoteSendTime);
+    const int64_t t4 = static_cast<int64_t>(receiveTime);
+
+    // round-trip-time without the processing-time on the other side
+    const int64_t rttSample = std::max((t4 - t1) - (t3 - t2), static_cast<int64_t>(0));
+    const int64_t offsetSample = ((t2 - t1) + (t3 - t4)) / 2;
+
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    if(m_hasClockOffset) {
+        m_latency.clockOffset = (7 * m_latency.clockOffset + offsetSample) / 8;
+    } else {
+        m_latency.clockOffset = offsetSample;
+    }
+    m_hasClockOffset = true;
+    addRttSample(m_latency, static_cast<uint64_t>(rttSample));
+
+    // the other side answers again, so the reply-tracking doesn't need the backoff anymore
+    m_replyBackoff = 1;
+
+    m_latency_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief add the measured latency of a tracked message, which was replied by the other side. The
+ *        latency contains the processing-time on the other side, so it is kept separate from the
+ *        round-trip-time of the heartbeats.
+ *
+ * @param latency time between sending the message and receiving the reply in microseconds
+ */
+void
+Session::addReplyLatency(const uint64_t latency)
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    addRttSample(m_replyLatency, latency);
+    m_replyBackoff = 1;
+    m_latency_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief add the measured latency of a request, which was answered by the other side
+ *
+ * @param latency time between sending the request and receiving the response in microseconds
  */
 void
-Session::initStatemachine()
-{
-    // init states
-    assert(m_statemachine.createNewState(NOT_CONNECTED, "not connected"));
-    assert(m_statemachine.createNewState(CONNECTED, "connected"));
-    assert(m_statemachine.createNewState(SESSION_NOT_READY, "session not ready"));
-    assert(m_statemachine.createNewState(SESSION_READY, "session ready"));
-    assert(m_statemachine.createNewState(ACTIVE, "active"));
-
-    // set child state
-    assert(m_statemachine.addChildState(CONNECTED,     SESSION_NOT_READY));
-    assert(m_statemachine.addChildState(CONNECTED,     SESSION_READY));
-    assert(m_statemachine.addChildState(SESSION_READY, ACTIVE));
-
-    // set initial states
-    assert(m_statemachine.setInitialChildState(CONNECTED,     SESSION_NOT_READY));
-    assert(m_statemachine.setInitialChildState(SESSION_READY, ACTIVE));
-
-    // init transitions
-    assert(m_statemachine.addTransition(NOT_CONNECTED,     CONNECT,       CONNECTED));
-    assert(m_statemachine.addTransition(CONNECTED,         DISCONNECT,    NOT_CONNECTED));
-    assert(m_statemachine.addTransition(SESSION_NOT_READY, START_SESSION, SESSION_READY));
-    assert(m_statemachine.addTransition(SESSION_READY,     STOP_SESSION,  SESSION_NOT_READY));
+Session::addRequestLatency(const uint64_t latency)
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    addRttSample(m_requestLatency, latency);
+    m_requestBackoff = 1;
+
+    // ring-buffer of the latest latencies for percentiles
+    if(m_requestLatencyHistory.size() < REQUEST_LATENCY_HISTORY) {
+        m_requestLatencyHistory.push_back(latency);
+    } else {
+        m_requestLatencyHistory[m_requestLatencyPos % REQUEST_LATENCY_HISTORY] = latency;
+    }
+    m_requestLatencyPos++;
+
+    m_latency_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief cancel an own request, which is not waited for anymore. A not completely send request is
+ *        aborted and the other side is informed to stop the processing and the response.
+ *
+ * @param blockerId id of the request
+ */
+void
+Session::cancelRequest(const uint64_t blockerId)
+{
+    m_multiblockIo->removeOutgoingMessage(blockerId);
+
+    if(isInState(ACTIVE)) {
+        send_Data_SingleBlock_Cancel(this, blockerId);
+    }
+}
+
+/**
+ * @brief mark a request of the other side as cancelled. The mark expires, because a cancel, which
+ *        arrives after the response was send, is never removed.
+ *
+ * @param blockerId id of the request
+ */
+void
+Session::addCancelledRequest(const uint64_t blockerId)
+{
+    const std::chrono::steady_clock::time_point expiry =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(REQUEST_STATE_LIFETIME);
+
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    RequestState &state = getRequestState(blockerId);
+    state.cancelled = true;
+    state.expiry = std::max(state.expiry, expiry);
+
+    m_cancel_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief remove the mark of a cancelled request of the other side
+ *
+ * @param blockerId id of the request
+ *
+ * @return true, if the request was cancelled, else false
+ */
+bool
+Session::removeCancelledRequest(const uint64_t blockerId)
+{
+    bool result = false;
+
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::unordered_map<uint64_t, RequestState>::iterator it;
+    it = m_requestStates.find(blockerId);
+    if(it != m_requestStates.end())
+    {
+        result = it->second.cancelled;
+        it->second.cancelled = false;
+        if(it->second.deadline == std::chrono::steady_clock::time_point()) {
+            m_requestStates.erase(it);
+        }
+    }
+
+    m_cancel_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief convert the time-budget of an incoming message into a local deadline. The half
+ *        round-trip-time is subtracted as estimation of the time for the transfer.
+ *
+ * @param timeBudget remaining time of the message at sending in milliseconds
+ *
+ * @return deadline or a default-value, if the message has no deadline
+ */
+std::chrono::steady_clock::time_point
+Session::convertDeadline(const uint32_t timeBudget)
+{
+    if(timeBudget == 0) {
+        return std::chrono::steady_clock::time_point();
+    }
+
+    const std::chrono::microseconds transferTime(getLatencyInfo().rtt / 2);
+    return std::chrono::steady_clock::now()
+           + std::chrono::milliseconds(timeBudget)
+           - transferTime;
+}
+
+/**
+ * @brief get the remaining time until a deadline for the header of an outgoing message
+ *
+ * @param deadline deadline or a default-value for no deadline
+ *
+ * @return remaining time in milliseconds, at least 1, or 0, if there is no deadline
+ */
+uint32_t
+Session::getTimeBudget(const std::chrono::steady_clock::time_point &deadline)
+{
+    if(deadline == std::chrono::steady_clock::time_point()) {
+        return 0;
+    }
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now).count();
+    if(remaining < 1) {
+        return 1;
+    }
+    if(remaining > 0xFFFFFFFF) {
+        return 0xFFFFFFFF;
+    }
+
+    return static_cast<uint32_t>(remaining);
+}
+
+/**
+ * @brief check if a deadline has passed
+ *
+ * @param deadline deadline or a default-value for no deadline
+ *
+ * @return true, if expired, else false
+ */
+bool
+Session::isExpired(const std::chrono::steady_clock::time_point &deadline)
+{
+    if(deadline == std::chrono::steady_clock::time_point()) {
+        return false;
+    }
+
+    return deadline <= std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief store the deadline of a request of the other side until the response is send. The state
+ *        expires some time after the deadline, because requests, which are not answered anymore,
+ *        are never removed.
+ *
+ * @param blockerId id of the request
+ * @param deadline deadline of the request
+ */
+void
+Session::addRequestDeadline(const uint64_t blockerId,
+                            const std::chrono::steady_clock::time_point &deadline)
+{
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    RequestState &state = getRequestState(blockerId);
+    state.deadline = deadline;
+    state.expiry = std::max(state.expiry,
+                            deadline + std::chrono::milliseconds(REQUEST_STATE_LIFETIME));
+
+    m_cancel_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief remove the deadline of a request of the other side
+ *
+ * @param blockerId id of the request
+ *
+ * @return deadline of the request or a default-value, if the request has no deadline
+ */
+std::chrono::steady_clock::time_point
+Session::removeRequestDeadline(const uint64_t blockerId)
+{
+    std::chrono::steady_clock::time_point result;
+
+    while(m_cancel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::unordered_map<uint64_t, RequestState>::iterator it;
+    it = m_requestStates.find(blockerId);
+    if(it != m_requestStates.end())
+    {
+        result = it->second.deadline;
+        it->second.deadline = std::chrono::steady_clock::time_point();
+        if(it->second.cancelled == false) {
+            m_requestStates.erase(it);
+        }
+    }
+
+    m_cancel_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get the state of a request of the other side and create it, if it doesn't exist yet
+ *        (must be called with held cancel-lock)
+ *
+ * @param blockerId id of the request
+ *
+ * @return reference to the state of the request
+ */
+Session::RequestState&
+Session::getRequestState(const uint64_t blockerId)
+{
+    if(m_requestStates.size() >= m_requestStatePurgeLimit
+            && m_requestStates.find(blockerId) == m_requestStates.end())
+    {
+        purgeRequestStates();
+    }
+
+    return m_requestStates[blockerId];
+}
+
+/**
+ * @brief remove expired request-states. The next purge is done, when the number of states has
+ *        doubled, so the costs are constant per added state. If there are still too many states,
+ *        the states with the earliest expiry are dropped. (must be called with held cancel-lock)
+ */
+void
+Session::purgeRequestStates()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    std::unordered_map<uint64_t, RequestState>::iterator it;
+    it = m_requestStates.begin();
+    while(it != m_requestStates.end())
+    {
+        if(it->second.expiry <= now) {
+            it = m_requestStates.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    if(m_requestStates.size() >= MAX_REQUEST_STATES)
+    {
+        std::vector<std::pair<std::chrono::steady_clock::time_point, uint64_t>> expiries;
+        expiries.reserve(m_requestStates.size());
+        for(const auto &entry : m_requestStates) {
+            expiries.push_back(std::make_pair(entry.second.expiry, entry.first));
+        }
+
+        const uint64_t numberOfDropped = m_requestStates.size() - MAX_REQUEST_STATES / 2;
+        std::nth_element(expiries.begin(),
+                         expiries.begin() + static_cast<int64_t>(numberOfDropped),
+                         expiries.end());
+        for(uint64_t i = 0; i < numberOfDropped; i++) {
+            m_requestStates.erase(expiries[i].second);
+        }
+    }
+
+    m_requestStatePurgeLimit = std::max(static_cast<uint64_t>(MIN_REQUEST_STATE_PURGE),
+                                        2 * static_cast<uint64_t>(m_requestStates.size()));
+    m_requestStatePurgeLimit = std::min(m_requestStatePurgeLimit,
+                                        static_cast<uint64_t>(MAX_REQUEST_STATES));
+}
+
+/**
+ * @brief double the timeout of the reply-tracking after a timeout, like the backoff of tcp. The
+ *        latency-estimations are not changed, so the backoff ends with the next measurement.
+ */
+void
+Session::backoffReplyTimeout()
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_replyBackoff = std::min(m_replyBackoff * 2, MAX_TIMEOUT_BACKOFF);
+    m_latency_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief double the adaptive timeout of requests after a timeout, like the backoff of tcp. The
+ *        latency-estimations are not changed, so the backoff ends with the next response.
+ */
+void
+Session::backoffRequestTimeout()
+{
+    while(m_latency_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_requestBackoff = std::min(m_requestBackoff * 2, MAX_TIMEOUT_BACKOFF);
+    m_latency_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief smooth a new sample into a latency-estimation like the rtt of tcp (RFC 6298)
+ *        (must be called with held latency-lock)
+ *
+ * @param latency estimation to update
+ * @param sample new measured latency in microseconds
+ */
+void
+Session::addRttSample(LatencyInfo &latency,
+                      const uint64_t sample)
+{
+    if(latency.numberOfSamples == 0)
+    {
+        latency.rtt = sample;
+        latency.rttVariance = sample / 2;
+    }
+    else
+    {
+        const int64_t rtt = static_cast<int64_t>(latency.rtt);
+        const int64_t rttVariance = static_cast<int64_t>(latency.rttVariance);
+        const int64_t deviation = std::abs(rtt - static_cast<int64_t>(sample));
+        latency.rttVariance = static_cast<uint64_t>((3 * rttVariance + deviation) / 4);
+        latency.rtt = (7 * latency.rtt + sample) / 8;
+    }
+
+    latency.numberOfSamples++;
+}
+
+/**
+ * @brief calculate a timeout out of a latency-estimation like the rto of tcp (RFC 6298)
+ *        (must be called with held latency-lock)
+ *
+ * @param latency estimation of the latency
+ * @param initialTimeout timeout in milliseconds, as long as there is no measurement
+ * @param backoff multiplier of the timeout after previous timeouts
+ *
+ * @return timeout in milliseconds within the bounds of the session
+ */
+uint32_t
+Session::calculateTimeout(const LatencyInfo &latency,
+                          const uint32_t initialTimeout,
+                          const uint32_t backoff)
+{
+    uint64_t timeout = initialTimeout;
+    if(latency.numberOfSamples > 0)
+    {
+        const uint64_t variance = std::max(4 * latency.rttVariance,
+                                           static_cast<uint64_t>(TIMEOUT_GRANULARITY));
+        timeout = (latency.rtt + variance + 999) / 1000;
+    }
+    timeout *= backoff;
+
+    timeout = std::max(timeout, static_cast<uint64_t>(m_minTimeout));
+    timeout = std::min(timeout, static_cast<uint64_t>(m_maxTimeout));
+
+    return static_cast<uint32_t>(timeout);
+}
+
+/**
+ * @brief check if a heartbeat is necessary and send it. Heartbeats are skipped, as long as the
+ *        other side has send any message since the last check, because this already shows, that
+ *        the connection is alive. The interval grows while the heartbeats are answered and falls
+ *        back to the minimum after a missing reply to detect a broken connection fast.
+ *
+ * @param tick current tick of the heartbeat-timer
+ *
+ * @return true, if a heartbeat was send, else false
+ */
+bool
+Session::checkHeartbeat(const uint64_t tick)
+{
+    // the heartbeats of the parent-session already cover the shared connection
+    if(m_parentSession != nullptr) {
+        return false;
+    }
+
+    if(isInState(SESSION_READY) == false) {
+        return false;
+    }
+
+    // first check of the session
+    if(m_nextHeartbeatTick == 0)
+    {
+        m_heartbeatInterval = HEARTBEAT_MIN_INTERVAL;
+        scheduleHeartbeat(tick);
+        return false;
+    }
+
+    if(tick < m_nextHeartbeatTick) {
+        return false;
+    }
+
+    // skip heartbeat, because of incoming traffic since the last check, but only after there
+    // is a first latency-estimation
+    if(m_inboundTraffic.exchange(false, std::memory_order_relaxed)
+            && getLatencyInfo().numberOfSamples > 0)
+    {
+        m_missedHeartbeats.store(0, std::memory_order_relaxed);
+        scheduleHeartbeat(tick);
+        return false;
+    }
+
+    // adjust interval
+    if(m_missedHeartbeats.load(std::memory_order_relaxed) > 0) {
+        m_heartbeatInterval = HEARTBEAT_MIN_INTERVAL;
+    } else {
+        m_heartbeatInterval = std::min(m_heartbeatInterval * 2, HEARTBEAT_MAX_INTERVAL);
+    }
+
+    m_missedHeartbeats.fetch_add(1, std::memory_order_relaxed);
+    send_Heartbeat_Start(this);
+    scheduleHeartbeat(tick);
+
+    return true;
+}
+
+/**
+ * @brief set the tick for the next heartbeat-check with a random jitter of +-25% of the
+ *        interval, so the heartbeats of sessions, which were created at the same time, don't
+ *        stay synchronized
+ *
+ * @param tick current tick of the heartbeat-timer
+ */
+void
+Session::scheduleHeartbeat(const uint64_t tick)
+{
+    const uint32_t jitterRange = (m_heartbeatInterval / 2) + 1;
+    const uint32_t jitter = static_cast<uint32_t>(rand()) % jitterRange;
+    m_nextHeartbeatTick = tick + m_heartbeatInterval - (m_heartbeatInterval / 4) + jitter;
+}
+
+/**
+ * @brief check the current state of the session. The state is only a single atomic value, so
+ *        the check on the send-path is only a relaxed load and a compare. The states are
+ *        hierarchical, so a session in ACTIVE-state is also in SESSION_READY- and
+ *        CONNECTED-state.
+ *
+ * @param state state to check
+ *
+ * @return true, if the session is in the requested state, else false
+ */
+bool
+Session::isInState(const uint8_t state) const
+{
+    const uint8_t currentState = m_state.load(std::memory_order_relaxed);
+
+    switch(state)
+    {
+        case CONNECTED:
+            return currentState != NOT_CONNECTED;
+        case SESSION_READY:
+            return currentState == ACTIVE;
+        default:
+            return currentState == state;
+    }
+}
+
+/**
+ * @brief change the state of the session by a transition. Only the transitions below are
+ *        allowed, so concurrent calls of the same transition are successful only once.
+ *
+ *        NOT_CONNECTED     -- CONNECT       --> SESSION_NOT_READY
+ *        SESSION_NOT_READY -- START_SESSION --> ACTIVE
+ *        ACTIVE            -- STOP_SESSION  --> SESSION_NOT_READY
+ *        any connected     -- DISCONNECT    --> NOT_CONNECTED
+ *
+ * @param transition transition to process
+ *
+ * @return true, if the transition is allowed in the current state, else false
+ */
+bool
+Session::goToNextState(const uint8_t transition)
+{
+    uint8_t currentState = m_state.load(std::memory_order_acquire);
+
+    while(true)
+    {
+        uint8_t nextState = 0;
+        switch(transition)
+        {
+            case CONNECT:
+                if(currentState == NOT_CONNECTED) {
+                    nextState = SESSION_NOT_READY;
+                }
+                break;
+            case START_SESSION:
+                if(currentState == SESSION_NOT_READY) {
+                    nextState = ACTIVE;
+                }
+                break;
+            case STOP_SESSION:
+                if(currentState == ACTIVE) {
+                    nextState = SESSION_NOT_READY;
+                }
+                break;
+            case DISCONNECT:
+                if(currentState != NOT_CONNECTED) {
+                    nextState = NOT_CONNECTED;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if(nextState == 0) {
+            return false;
+        }
+
+        if(m_state.compare_exchange_weak(currentState,
+                                         nextState,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire))
+        {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief add an additional connection to the session, which is used to send parts of
+ *        multi-block-messages in parallel to the main-connection. Each stripe gets its own
+ *        sender-thread.
+ *
+ * @param socket connected socket of the new stripe
+ */
+void
+Session::addStripe(Network::AbstractSocket* socket)
+{
+    // the stripe is deleted, when the last sending message has released it
+    std::shared_ptr<StripeSender> sender(
+                new StripeSender(this, socket),
+                [](StripeSender* stripe) {
+                    stripe->m_socket->scheduleThreadForDeletion();
+                    stripe->scheduleThreadForDeletion();
+                });
+    sender->startThread();
+
+    while(m_stripe_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_stripeSenders.push_back(sender);
+    m_stripe_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief get a copy of the list of all stripes of the session
+ *
+ * @return list of stripe-senders
+ */
+std::vector<std::shared_ptr<StripeSender>>
+Session::getStripeSenders()
+{
+    while(m_stripe_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<std::shared_ptr<StripeSender>> result = m_stripeSenders;
+    m_stripe_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief close all stripes of the session. Still queued parts are registered as failed, so a
+ *        currently sending message is aborted instead of waiting for them. The stripes are
+ *        deleted, when they are not used anymore by the sending message.
+ */
+void
+Session::closeStripes()
+{
+    while(m_stripe_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::vector<std::shared_ptr<StripeSender>> stripes;
+    stripes.swap(m_stripeSenders);
+    m_stripe_lock.clear(std::memory_order_release);
+
+    for(const std::shared_ptr<StripeSender> &sender : stripes)
+    {
+        sender->close();
+        sender->m_socket->closeSocket();
+    }
+}
+
+/**
+ * @brief register a channel, which shares the connection of this session
+ *
+ * @param id session-id of the channel
+ * @param channel pointer to the channel
+ */
+void
+Session::addChannel(const uint32_t id,
+                    Session* channel)
+{
+    while(m_channel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_channels.insert(std::make_pair(id, channel));
+    m_channel_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief remove a channel from the session, but doesn't close the channel
+ *
+ * @param id session-id of the channel
+ *
+ * @return pointer to the removed channel, if found, else nullptr
+ */
+Session*
+Session::removeChannel(const uint32_t id)
+{
+    Session* result = nullptr;
+    while(m_channel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<uint32_t, Session*>::iterator it;
+    it = m_channels.find(id);
+    if(it != m_channels.end())
+    {
+        result = it->second;
+        m_channels.erase(it);
+    }
+
+    m_channel_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief get a channel of the session by its id
+ *
+ * @param id session-id of the channel
+ *
+ * @return pointer to the channel, if found, else nullptr
+ */
+Session*
+Session::getChannel(const uint32_t id)
+{
+    Session* result = nullptr;
+    while(m_channel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+
+    std::map<uint32_t, Session*>::const_iterator it;
+    it = m_channels.find(id);
+    if(it != m_channels.end()) {
+        result = it->second;
+    }
+
+    m_channel_lock.clear(std::memory_order_release);
+
+    return result;
+}
+
+/**
+ * @brief close all channels of the session, because the shared connection is closed
+ */
+void
+Session::closeChannels()
+{
+    while(m_channel_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    std::map<uint32_t, Session*> channels = m_channels;
+    m_channels.clear();
+    m_channel_lock.clear(std::memory_order_release);
+
+    // a channel, which is not ready, can not be ended and is released here
+    std::map<uint32_t, Session*>::iterator it;
+    for(it = channels.begin();
+        it != channels.end();
+        it++)
+    {
+        Session* channel = it->second;
+        if(channel->endSession() == false)
+        {
+            SessionHandler::m_sessionHandler->removeSession(channel->m_localSessionId);
+            if(channel->disconnectSession()) {
+                SessionHandler::m_sessionHandler->recycleSession(channel);
+            }
+        }
+    }
+}
+
+/**
+ * @brief wait for the turn to send the next part of a multi-block-message over the connection
+ *        of the session. The turns are given in the order of the calls, so a channel, which
+ *        wants to send its next part, has to wait until all other channels have send one part.
+ *        Must be called on the session, which owns the connection.
+ */
+void
+Session::acquireSendTurn()
+{
+    std::unique_lock<std::mutex> lock(m_sendTurnMutex);
+    const uint64_t turn = m_nextSendTurn++;
+    m_sendTurnCv.wait(lock, [this, turn] { return m_currentSendTurn == turn; });
+}
+
+/**
+ * @brief release the turn, which was given by acquireSendTurn, to the next waiting channel
+ */
+void
+Session::releaseSendTurn()
+{
+    std::lock_guard<std::mutex> guard(m_sendTurnMutex);
+    m_currentSendTurn++;
+    m_sendTurnCv.notify_all();
+}
+
+/**
+ * @brief register, that an internal handler holds a pointer to the session
+ */
+void
+Session::addReference()
+{
+    m_references.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief release a reference, which was registered by addReference
+ */
+void
+Session::releaseReference()
+{
+    m_references.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * @brief check if an internal handler still holds a pointer to the session
+ *
+ * @return true, if referenced, else false
+ */
+bool
+Session::isReferenced() const
+{
+    return m_references.load(std::memory_order_acquire) != 0;
 }
 
 /**
@@ -24,8 +24,15 @@
 
 #include <handler/reply_handler.h>
 #include <handler/message_blocker_handler.h>
+#include <handler/topic_handler.h>
+#include <handler/request_scheduler.h>
+#include <handler/rpc_dispatcher.h>
 #include <handler/session_handler.h>
 #include <callbacks.h>
+#include <reuse_port_tcp_server.h>
+#include <kernel_tls.h>
+#include <kernel_tls_tcp_server.h>
+#include <kernel_tls_tcp_socket.h>
 #include <messages_processing/session_processing.h>
 
 #include <libKitsunemimiNetwork/tcp/tcp_server.h>
@@ -39,6 +46,12 @@
 
 #include <libKitsunemimiPersistence/logger/logger.h>
 
+#include <thread>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+
 namespace Kitsunemimi
 {
 namespace Sakura
@@ -56,6 +69,7 @@ SessionController::SessionController(void (*processCreateSession)(Session*, cons
                                                           const std::string))
 {
     m_sessionController = this;
+    m_hedgeBudget = DEFAULT_HEDGE_BUDGET;
 
     if(SessionHandler::m_sessionHandler == nullptr)
     {
@@ -102,7 +116,8 @@ SessionController::addUnixDomainServer(const std::string &socketFile)
     SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
     m_serverIdCounter++;
     sessionHandler->lockServerMap();
-    sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter, server));
+    sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter,
+                                                    std::vector<Network::AbstractServer*>{server}));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -112,23 +127,71 @@ SessionController::addUnixDomainServer(const std::string &socketFile)
  * @brief add new tcp-server
  *
  * @param port port where the server should listen
+ * @param numberOfAcceptors number of listeners on the port. If greater than 1, all listeners
+ *                          are bound to the same port with SO_REUSEPORT and each one has its own
+ *                          accept-thread, so the kernel can spread new connections over them.
+ * @param bindAcceptorsToCores true to pin the accept-thread of each listener to its own core.
+ *                             Socket-threads of accepted connections inherit this core.
  *
  * @return id of the new server if sussessful, else return 0
  */
 uint32_t
-SessionController::addTcpServer(const uint16_t port)
+SessionController::addTcpServer(const uint16_t port,
+                                const uint32_t numberOfAcceptors,
+                                const bool bindAcceptorsToCores)
 {
-    Network::TcpServer* server = new Network::TcpServer(this,
-                                                        &processConnection_Callback);
-    if(server->initServer(port) == false) {
-        return 0;
+    std::vector<Network::AbstractServer*> servers;
+
+    if(numberOfAcceptors <= 1)
+    {
+        Network::TcpServer* server = new Network::TcpServer(this,
+                                                            &processConnection_Callback);
+        if(server->initServer(port) == false)
+        {
+            delete server;
+            return 0;
+        }
+        servers.push_back(server);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < numberOfAcceptors; i++)
+        {
+            ReusePortTcpServer* server = new ReusePortTcpServer(this,
+                                                                &processConnection_Callback);
+            if(server->initServer(port) == false)
+            {
+                delete server;
+
+                // close and delete already initialized listeners of the port. Their
+                // accept-threads are not started yet.
+                for(uint32_t j = 0; j < servers.size(); j++)
+                {
+                    servers.at(j)->closeServer();
+                    delete servers.at(j);
+                }
+                return 0;
+            }
+            servers.push_back(server);
+        }
+    }
+
+    // start accept-threads
+    const uint32_t numberOfCores = std::thread::hardware_concurrency();
+    for(uint32_t i = 0; i < servers.size(); i++)
+    {
+        servers.at(i)->startThread();
+        if(bindAcceptorsToCores
+                && numberOfCores > 0)
+        {
+            servers.at(i)->bindThreadToCore(static_cast<int>(i % numberOfCores));
+        }
     }
-    server->startThread();
 
     SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
     m_serverIdCounter++;
     sessionHandler->lockServerMap();
-    sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter, server));
+    sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter, servers));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -140,19 +203,42 @@ SessionController::addTcpServer(const uint16_t port)
  * @param port port where the server should listen
  * @param certFile certificate-file for tls-encryption
  * @param keyFile key-file for tls-encryption
+ * @param useKernelTls true to move the record-encryption after the handshake into the kernel.
+ *                     If kTLS is not supported, the server falls back to user-space encryption.
  *
  * @return id of the new server if sussessful, else return 0
  */
 uint32_t
 SessionController::addTlsTcpServer(const uint16_t port,
                                    const std::string &certFile,
-                                   const std::string &keyFile)
+                                   const std::string &keyFile,
+                                   const bool useKernelTls)
 {
-    Network::TlsTcpServer* server = new Network::TlsTcpServer(this,
-                                                              &processConnection_Callback,
-                                                              certFile,
-                                                              keyFile);
-    if(server->initServer(port) == false) {
+    Network::AbstractServer* server = nullptr;
+    bool initSuccessful = false;
+    if(useKernelTls
+            && isKernelTlsSupported())
+    {
+        KernelTlsTcpServer* kernelTlsServer = new KernelTlsTcpServer(this,
+                                                                     &processConnection_Callback,
+                                                                     certFile,
+                                                                     keyFile);
+        initSuccessful = kernelTlsServer->initServer(port);
+        server = kernelTlsServer;
+    }
+    else
+    {
+        Network::TlsTcpServer* tlsServer = new Network::TlsTcpServer(this,
+                                                                     &processConnection_Callback,
+                                                                     certFile,
+                                                                     keyFile);
+        initSuccessful = tlsServer->initServer(port);
+        server = tlsServer;
+    }
+
+    if(initSuccessful == false)
+    {
+        delete server;
         return 0;
     }
     server->startThread();
@@ -160,8 +246,8 @@ SessionController::addTlsTcpServer(const uint16_t port,
     SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
     m_serverIdCounter++;
     sessionHandler->lockServerMap();
-    sessionHandler->m_servers.insert(std::pair<uint32_t, Network::AbstractServer*>(
-                                     m_serverIdCounter, server));
+    sessionHandler->m_servers.insert(std::make_pair(m_serverIdCounter,
+                                                    std::vector<Network::AbstractServer*>{server}));
     sessionHandler->unlockServerMap();
 
     return m_serverIdCounter;
@@ -180,18 +266,25 @@ SessionController::closeServer(const uint32_t id)
     SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
     sessionHandler->lockServerMap();
 
-    std::map<uint32_t, Network::AbstractServer*>::iterator it;
+    std::map<uint32_t, std::vector<Network::AbstractServer*>>::iterator it;
     it = sessionHandler->m_servers.find(id);
 
     if(it != sessionHandler->m_servers.end())
     {
-        Network::AbstractServer* server = it->second;
-        const bool ret = server->closeServer();
-        if(ret == false) {
-            return false;
+        // close all listeners, which belong to the server-id
+        for(uint32_t i = 0; i < it->second.size(); i++)
+        {
+            Network::AbstractServer* server = it->second.at(i);
+            const bool ret = server->closeServer();
+            if(ret == false)
+            {
+                sessionHandler->unlockServerMap();
+                return false;
+            }
+
+            server->scheduleThreadForDeletion();
         }
 
-        server->scheduleThreadForDeletion();
         sessionHandler->m_servers.erase(it);
         sessionHandler->unlockServerMap();
 
@@ -212,12 +305,14 @@ SessionController::cloesAllServers()
     SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
     sessionHandler->lockServerMap();
 
-    std::map<uint32_t, Network::AbstractServer*>::iterator it;
+    std::map<uint32_t, std::vector<Network::AbstractServer*>>::iterator it;
     for(it = sessionHandler->m_servers.begin();
         it != sessionHandler->m_servers.end();
         it++)
     {
-        it->second->closeServer();
+        for(uint32_t i = 0; i < it->second.size(); i++) {
+            it->second.at(i)->closeServer();
+        }
     }
 
     sessionHandler->unlockServerMap();
@@ -259,6 +354,179 @@ SessionController::startTcpSession(const std::string &address,
     return startSession(tcpSocket, sessionIdentifier);
 }
 
+/**
+ * @brief start new tcp-session in the background
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param timeoutMs time in milliseconds for connecting and waiting for the reply of the server
+ *
+ * @return future, which provides the new session or nullptr, if failed or timed out
+ */
+std::future<Session*>
+SessionController::startTcpSessionAsync(const std::string &address,
+                                        const uint16_t port,
+                                        const std::string &sessionIdentifier,
+                                        const uint32_t timeoutMs)
+{
+    return std::async(std::launch::async, [this, address, port, sessionIdentifier, timeoutMs] {
+        Network::TcpSocket* tcpSocket = new Network::TcpSocket(address, port);
+        return startSession(tcpSocket, sessionIdentifier, timeoutMs);
+    });
+}
+
+/**
+ * @brief start multiple tcp-sessions at once. The connects and init-messages are done in
+ *        parallel by multiple threads and afterwards all sessions wait for their replies with a
+ *        common deadline, so the total time is nearly the time of the slowest session and not
+ *        the sum of all sessions.
+ *
+ * @param targets list of servers to connect to
+ * @param timeoutMs time in milliseconds for connecting and waiting for the replies of all
+ *                  servers
+ * @param numberOfConnectThreads maximum number of threads for the parallel connects
+ *
+ * @return list of sessions in the order of the targets. Failed or timed out sessions are nullptr.
+ */
+std::vector<Session*>
+SessionController::startTcpSessions(const std::vector<SessionTarget> &targets,
+                                    const uint32_t timeoutMs,
+                                    const uint32_t numberOfConnectThreads)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+    std::vector<Session*> result(targets.size(), nullptr);
+    std::atomic<uint64_t> nextTarget(0);
+
+    // connect and send init-messages in parallel
+    const uint64_t numberOfThreads = std::min(static_cast<uint64_t>(numberOfConnectThreads),
+                                              static_cast<uint64_t>(targets.size()));
+    std::vector<std::thread> connectThreads;
+    for(uint64_t i = 0; i < numberOfThreads; i++)
+    {
+        connectThreads.push_back(std::thread([this, &targets, &result, &nextTarget] {
+            uint64_t pos = nextTarget++;
+            while(pos < targets.size())
+            {
+                const SessionTarget &target = targets.at(pos);
+                Network::TcpSocket* tcpSocket = new Network::TcpSocket(target.address,
+                                                                       target.port);
+                result[pos] = initSession(tcpSocket, target.sessionIdentifier);
+                pos = nextTarget++;
+            }
+        }));
+    }
+
+    for(std::thread &connectThread : connectThreads) {
+        connectThread.join();
+    }
+
+    // wait for the replies of all servers with a common deadline
+    for(uint64_t i = 0; i < result.size(); i++)
+    {
+        if(result[i] != nullptr) {
+            result[i] = finishSession(result[i], deadline);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief start new tcp-session and send a first request together with the init-message. The
+ *        server processes the request directly after the session is ready and its response
+ *        follows the init-reply, so the first response arrives after a single round-trip.
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ * @param data data-pointer of the request
+ * @param size number of bytes of the request (max 128 KiB)
+ * @param response reference for the response of the server, which is nullptr in case of an error
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param timeoutMs time in milliseconds for the session-start and for the response
+ *
+ * @return new session, if successful, else nullptr
+ */
+Session*
+SessionController::startTcpSessionWithRequest(const std::string &address,
+                                              const uint16_t port,
+                                              const void* data,
+                                              const uint64_t size,
+                                              DataBuffer* &response,
+                                              const std::string &sessionIdentifier,
+                                              const uint32_t timeoutMs)
+{
+    response = nullptr;
+    if(size > MAX_SINGLE_MESSAGE_SIZE) {
+        return nullptr;
+    }
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+
+    EarlyData earlyData;
+    earlyData.data = data;
+    earlyData.size = size;
+    earlyData.isRequest = true;
+    earlyData.blockerTimeout = timeoutMs;
+
+    Network::TcpSocket* tcpSocket = new Network::TcpSocket(address, port);
+    Session* session = initSession(tcpSocket, sessionIdentifier, &earlyData);
+    if(session == nullptr) {
+        return nullptr;
+    }
+
+    session = finishSession(session, deadline);
+    if(session == nullptr)
+    {
+        // remove blocker of the request
+        SessionHandler::m_blockerHandler->releaseMessage(earlyData.blockerId, nullptr);
+        SessionHandler::m_blockerHandler->waitForBlocker(earlyData.blockerId);
+        return nullptr;
+    }
+
+    response = SessionHandler::m_blockerHandler->waitForBlocker(earlyData.blockerId);
+
+    return session;
+}
+
+/**
+ * @brief start new tcp-session and send a first stream-message together with the init-message
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ * @param data data-pointer of the stream-message
+ * @param size number of bytes of the stream-message
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param timeoutMs time in milliseconds to wait for the reply of the server
+ *
+ * @return new session, if successful, else nullptr
+ */
+Session*
+SessionController::startTcpSessionWithStream(const std::string &address,
+                                             const uint16_t port,
+                                             const void* data,
+                                             const uint64_t size,
+                                             const std::string &sessionIdentifier,
+                                             const uint32_t timeoutMs)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+
+    EarlyData earlyData;
+    earlyData.data = data;
+    earlyData.size = size;
+
+    Network::TcpSocket* tcpSocket = new Network::TcpSocket(address, port);
+    Session* session = initSession(tcpSocket, sessionIdentifier, &earlyData);
+    if(session == nullptr) {
+        return nullptr;
+    }
+
+    return finishSession(session, deadline);
+}
+
 /**
  * @brief start new tls-tcp-session
  *
@@ -267,6 +535,11 @@ SessionController::startTcpSession(const std::string &address,
  * @param certFile path to the certificate-file
  * @param keyFile path to the key-file
  * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param useKernelTls true to move the record-encryption after the handshake into the kernel.
+ *                     If kTLS is not supported, the session falls back to user-space encryption.
+ * @param numberOfStripes number of additional tls-connections of the session. The parts of
+ *                        multi-block-messages are distributed over these connections, so they
+ *                        are encrypted and send in parallel by multiple threads.
  *
  * @return true, if session was successfully created and connected, else false
  */
@@ -275,17 +548,59 @@ SessionController::startTlsTcpSession(const std::string &address,
                                       const uint16_t port,
                                       const std::string &certFile,
                                       const std::string &keyFile,
-                                      const std::string &sessionIdentifier)
+                                      const std::string &sessionIdentifier,
+                                      const bool useKernelTls,
+                                      const uint32_t numberOfStripes)
 {
-    Network::TlsTcpSocket* tlsTcpSocket = new Network::TlsTcpSocket(address,
-                                                                    port,
-                                                                    certFile,
-                                                                    keyFile);
-    return startSession(tlsTcpSocket, sessionIdentifier);
+    const bool kernelTls = useKernelTls && isKernelTlsSupported();
+
+    Network::AbstractSocket* tlsTcpSocket = nullptr;
+    if(kernelTls) {
+        tlsTcpSocket = new KernelTlsTcpSocket(address, port, certFile, keyFile);
+    } else {
+        tlsTcpSocket = new Network::TlsTcpSocket(address, port, certFile, keyFile);
+    }
+    Session* session = startSession(tlsTcpSocket, sessionIdentifier);
+    if(session == nullptr) {
+        return nullptr;
+    }
+
+    // create the additional connections and bind them to the new session
+    for(uint32_t i = 0; i < numberOfStripes; i++)
+    {
+        Network::AbstractSocket* stripeSocket = nullptr;
+        if(kernelTls) {
+            stripeSocket = new KernelTlsTcpSocket(address, port, certFile, keyFile);
+        } else {
+            stripeSocket = new Network::TlsTcpSocket(address, port, certFile, keyFile);
+        }
+        stripeSocket->setMessageCallback(session, &processMessage_callback);
+        if(stripeSocket->initClientSide() == false)
+        {
+            LOG_WARNING("failed to create stripe " + std::to_string(i)
+                        + " for session " + std::to_string(session->sessionId()));
+            delete stripeSocket;
+            break;
+        }
+
+        stripeSocket->startThread();
+        if(send_Session_Stripe_Join(session, stripeSocket) == false)
+        {
+            stripeSocket->closeSocket();
+            stripeSocket->scheduleThreadForDeletion();
+            break;
+        }
+
+        session->addStripe(stripeSocket);
+    }
+
+    return session;
 }
 
 /**
- * @brief get a session by its id
+ * @brief get a session by its id. For server-side sessions this is the session-id and for
+ *        client-side sessions the initial id, which was created on this side, because the
+ *        session-id of client-side sessions comes from the server and is only unique there.
  *
  * @param id id of the requested session
  *
@@ -294,74 +609,425 @@ SessionController::startTlsTcpSession(const std::string &address,
 Session*
 SessionController::getSession(const uint32_t id)
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
-    sessionHandler->lockSessionMap();
+    return SessionHandler::m_sessionHandler->getSession(id);
+}
+
+/**
+ * @brief close a specific session
+ *
+ * @param id id of the session, which should be closed
+ *
+ * @return true, if id was found and session-close was successful, else false
+ */
+bool
+SessionController::closeSession(const uint32_t id)
+{
+    Session* session = SessionHandler::m_sessionHandler->getSession(id);
+    if(session == nullptr) {
+        return false;
+    }
+
+    return session->closeSession(true);
+}
+
+/**
+ * @brief close and remove all sessions
+ */
+void
+SessionController::closeAllSession()
+{
+    // use a snapshot, because the close-process removes the sessions from the registry
+    const std::vector<Session*> sessions = SessionHandler::m_sessionHandler->getSessions();
+    for(Session* session : sessions) {
+        session->closeSession();
+    }
+    SessionHandler::m_sessionHandler->releaseSessions(sessions);
+
+    SessionHandler::m_sessionHandler->m_sessions.clear();
+}
+
+/**
+ * @brief send the same data to multiple sessions. The messages are built only once and for each
+ *        session only the session- and message-ids are set. Large standalone-messages share one
+ *        read-only buffer between the outgoing queues of all sessions.
+ *
+ * @param sessions list of sessions, which should receive the data
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param type send data as stream- or as standalone-message
+ *
+ * @return number of sessions, to which the data were successfully send
+ */
+uint32_t
+SessionController::broadcast(const std::vector<Session*> &sessions,
+                             const void* data,
+                             const uint64_t size,
+                             const broadcastTypes type)
+{
+    uint32_t result = 0;
+    if(sessions.size() == 0) {
+        return 0;
+    }
+
+    // large standalone-messages go over the multiblock-queues of the sessions
+    if(type == STANDALONE_BROADCAST
+            && size > MAX_SINGLE_MESSAGE_SIZE)
+    {
+        const uint32_t numberOfBlocks = static_cast<uint32_t>(size / 4096) + 1;
+        std::shared_ptr<DataBuffer> sharedBuffer(new DataBuffer(numberOfBlocks));
+        addData_DataBuffer(*sharedBuffer, data, size);
+
+        for(Session* session : sessions)
+        {
+            if(session->isActive()
+                    && session->m_multiblockIo->createOutgoingBuffer(sharedBuffer, size) != 0)
+            {
+                result++;
+            }
+        }
 
-    std::map<uint32_t, Session*>::iterator it;
-    it = sessionHandler->m_sessions.find(id);
+        return result;
+    }
 
-    if(it != sessionHandler->m_sessions.end())
+    // build messages once
+    std::vector<uint8_t> messageBuffer;
+    std::vector<uint64_t> messagePositions;
+    if(type == STREAM_BROADCAST)
     {
-        Session* session = it->second;
-        sessionHandler->unlockSessionMap();
-        return session;
+        build_Data_Stream(messageBuffer, messagePositions, data, size);
+    }
+    else
+    {
+        const uint64_t singleblockId = sessions.front()->m_multiblockIo->getRandValue();
+        build_Data_SingleBlock(messageBuffer,
+                               messagePositions,
+                               singleblockId,
+                               data,
+                               static_cast<uint32_t>(size));
     }
 
-    sessionHandler->unlockSessionMap();
+    if(messageBuffer.size() == 0) {
+        return 0;
+    }
 
-    return nullptr;
+    // send to all sessions
+    for(Session* session : sessions)
+    {
+        if(session->isActive()
+                && SessionHandler::m_sessionHandler->sendPreparedMessages(session,
+                                                                          &messageBuffer[0],
+                                                                          messageBuffer.size(),
+                                                                          messagePositions))
+        {
+            result++;
+        }
+    }
+
+    return result;
 }
 
 /**
- * @brief close a specific session
+ * @brief send a request to the first active session of a list of equivalent sessions and send a
+ *        duplicate to the next active session, if there is no response after the hedge-delay and
+ *        the hedge-budget allows it. Both requests use the same id, so the first response
+ *        releases the blocker and the later one is dropped by the blocker-handler. The request
+ *        of the loser is cancelled.
  *
- * @param id id of the session, which should be closed
+ * @param sessions list of equivalent sessions
+ * @param data data-pointer
+ * @param size number of bytes
+ * @param hedgeDelayMs delay in milliseconds until the duplicate is send or 0 to use the p95 of the
+ *                     request-latency of the first session
+ * @param timeout timeout in seconds or 0 to use the adaptive timeout of the first session
  *
- * @return true, if id was found and session-close was successful, else false
+ * @return response-data or nullptr in case of a timeout
  */
-bool
-SessionController::closeSession(const uint32_t id)
+DataBuffer*
+SessionController::sendHedgedRequest(const std::vector<Session*> &sessions,
+                                     const void* data,
+                                     const uint64_t size,
+                                     const uint32_t hedgeDelayMs,
+                                     const uint64_t timeout)
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
-    sessionHandler->lockSessionMap();
+    // get the active sessions for the first request and the hedged duplicate
+    Session* primary = nullptr;
+    Session* secondary = nullptr;
+    for(Session* session : sessions)
+    {
+        if(session->isActive() == false) {
+            continue;
+        }
+
+        if(primary == nullptr) {
+            primary = session;
+        } else if(secondary == nullptr) {
+            secondary = session;
+        }
+    }
+
+    if(primary == nullptr) {
+        return nullptr;
+    }
+    if(secondary == nullptr) {
+        return primary->sendRequest(data, size, timeout);
+    }
 
-    std::map<uint32_t, Session*>::iterator it;
-    it = SessionHandler::m_sessionHandler->m_sessions.find(id);
+    addHedgeTokens();
 
-    if(it != SessionHandler::m_sessionHandler->m_sessions.end())
+    const uint64_t timeoutMs = timeout == 0 ? primary->getRequestTimeout() : timeout * 1000;
+
+    // get delay for the duplicate, which falls back to the half timeout, as long as there are not
+    // enough measurements for the percentile
+    uint64_t delayMs = hedgeDelayMs;
+    if(delayMs == 0)
     {
-        sessionHandler->unlockSessionMap();
-        return it->second->closeSession(true);
+        const uint64_t p95 = primary->getRequestLatencyPercentile(95, MIN_HEDGE_SAMPLES);
+        delayMs = p95 != 0 ? (p95 + 999) / 1000 : timeoutMs / 2;
     }
 
-    sessionHandler->unlockSessionMap();
+    // the same id is used for both requests to correlate them with the same blocker
+    const uint64_t id = primary->m_multiblockIo->getRandValue();
+    const bool isSingleBlock = size <= MAX_SINGLE_MESSAGE_SIZE;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point deadline = start
+                                                           + std::chrono::milliseconds(timeoutMs);
+    SessionHandler::m_blockerHandler->registerBlocker(id, timeoutMs, primary);
+
+    // send to the first session and if it is too slow and the budget allows it also to the
+    // second one
+    std::vector<Session*> usedSessions;
+    usedSessions.push_back(primary);
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        if(i == 1)
+        {
+            const uint32_t waitTime = static_cast<uint32_t>(delayMs);
+            if(delayMs >= timeoutMs
+                    || SessionHandler::m_blockerHandler->waitForRelease(id, waitTime)
+                    || takeHedgeToken() == false)
+            {
+                break;
+            }
+            usedSessions.push_back(secondary);
+        }
 
-    return false;
+        Session* target = usedSessions.back();
+        if(isSingleBlock)
+        {
+            send_Data_SingleBlock(target,
+                                  id,
+                                  data,
+                                  static_cast<uint32_t>(size),
+                                  0,
+                                  target->isReplyExpected(Session::SESSION_DEFAULT),
+                                  Session::getTimeBudget(deadline),
+                                  true);
+        }
+        else
+        {
+            target->m_multiblockIo->createOutgoingBuffer(data, size, true, 0, id, deadline);
+        }
+    }
+
+    Session* responder = nullptr;
+    DataBuffer* response = SessionHandler::m_blockerHandler->waitForBlocker(id,
+                                                                            nullptr,
+                                                                            &responder);
+
+    // cancel the request of the loser or of all sessions in case of a timeout. A later response
+    // is dropped by the blocker-handler, because the blocker doesn't exist anymore
+    for(Session* session : usedSessions)
+    {
+        if(response == nullptr
+                || session != responder)
+        {
+            session->cancelRequest(id);
+        }
+    }
+
+    // only a response of the first session is a measurement of its latency, because the
+    // response of the duplicate doesn't show, how long the first session would have needed
+    if(response != nullptr
+            && responder == primary)
+    {
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const uint64_t latency = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        primary->addRequestLatency(latency);
+    }
+
+    return response;
 }
 
 /**
- * @brief close and remove all sessions
+ * @brief set the budget of hedged requests, which limits the additional load of the duplicates
+ *
+ * @param percent maximum percentage of hedged requests, which send a duplicate (0 disables the
+ *                duplicates)
+ *
+ * @return false, if the percentage is greater than 100, else true
+ */
+bool
+SessionController::setHedgeBudget(const uint32_t percent)
+{
+    if(percent > 100) {
+        return false;
+    }
+
+    while(m_hedge_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_hedgeBudget = percent;
+    m_hedgeTokens = 0;
+    m_hedge_lock.clear(std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief increase the budget of duplicates for a new hedged request up to the maximum burst
  */
 void
-SessionController::closeAllSession()
+SessionController::addHedgeTokens()
 {
-    SessionHandler* sessionHandler = SessionHandler::m_sessionHandler;
+    while(m_hedge_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    m_hedgeTokens = std::min(m_hedgeTokens + m_hedgeBudget,
+                             static_cast<uint64_t>(MAX_HEDGE_BURST) * 100);
+    m_hedge_lock.clear(std::memory_order_release);
+}
+
+/**
+ * @brief take one duplicate from the budget of hedged requests
+ *
+ * @return true, if the budget allows a duplicate, else false
+ */
+bool
+SessionController::takeHedgeToken()
+{
+    bool result = false;
 
-    // copy to avoid problems, when the close-process reduce the list, while there is a iteration
-    // over the same list
-    sessionHandler->lockSessionMap();
-    std::map<uint32_t, Session*> copy = SessionHandler::m_sessionHandler->m_sessions;
-    sessionHandler->unlockSessionMap();
+    while(m_hedge_lock.test_and_set(std::memory_order_acquire)) { asm(""); }
+    if(m_hedgeTokens >= 100)
+    {
+        m_hedgeTokens -= 100;
+        result = true;
+    }
+    m_hedge_lock.clear(std::memory_order_release);
 
-    std::map<uint32_t, Session*>::iterator it;
-    for(it = copy.begin();
-        it != copy.end();
-        it++)
+    return result;
+}
+
+/**
+ * @brief publish data from the server-side to all subscribers of a topic. The message is encoded
+ *        only once and shared between all subscribers.
+ *
+ * @param topic name of the topic (max 64 characters)
+ * @param data data-pointer
+ * @param size number of bytes (max 128 KiB)
+ *
+ * @return number of subscribers, which got the message
+ */
+uint32_t
+SessionController::publish(const std::string &topic,
+                           const void* data,
+                           const uint64_t size)
+{
+    if(topic.size() > 64
+            || size > MAX_SINGLE_MESSAGE_SIZE)
     {
-        it->second->closeSession();
+        return 0;
     }
 
-    SessionHandler::m_sessionHandler->m_sessions.clear();
+    std::shared_ptr<const std::vector<uint8_t>> message;
+    message = build_PubSub_Publish(0, 0, topic, data, static_cast<uint32_t>(size));
+
+    return SessionHandler::m_topicHandler->publish(topic, message);
+}
+
+/**
+ * @brief set the maximum number of published messages, which can wait to be send to a single
+ *        subscriber, before the policy of the subscriber takes effect
+ *
+ * @param maxQueueSize new maximum queue-size for new subscribers
+ */
+void
+SessionController::setTopicQueueSize(const uint32_t maxQueueSize)
+{
+    SessionHandler::m_topicHandler->setMaxQueueSize(maxQueueSize);
+}
+
+/**
+ * @brief limit the processing of incoming requests. If enabled, requests are processed by a pool
+ *        of worker-threads, which serves the sessions fairly, instead of directly by the
+ *        socket-threads. If the queue is full, requests of the session with the longest queue
+ *        are rejected immediately and the requester gets an overload-error instead of a timeout.
+ *
+ * @param maxConcurrentRequests maximum number of requests of all sessions, which are processed at
+ *                              the same time, or 0 to disable the limits
+ * @param maxConcurrentRequestsPerSession maximum number of requests of a single session, which
+ *                                        are processed at the same time, or 0 for no own limit
+ * @param maxQueuedRequests maximum number of requests of all sessions, which can wait for their
+ *                          processing
+ *
+ * @return false, if the limits are invalid, else true
+ */
+bool
+SessionController::setRequestLimits(const uint32_t maxConcurrentRequests,
+                                    const uint32_t maxConcurrentRequestsPerSession,
+                                    const uint32_t maxQueuedRequests)
+{
+    return SessionHandler::m_requestScheduler->setLimits(maxConcurrentRequests,
+                                                         maxConcurrentRequestsPerSession,
+                                                         maxQueuedRequests);
+}
+
+/**
+ * @brief register the handler of a remote procedure. Requests, which are send with the method-id
+ *        by Session::sendRpcRequest, are given to the handler instead of the standalone-callback.
+ *        The method-id is part of the message-header, so the payload is not parsed for
+ *        dispatching. Like the other handlers, the method-table belongs to the process-wide
+ *        session-handler, so it is shared by all controllers of the process.
+ *
+ * @param methodId id of the remote procedure, which must not be 0
+ * @param processRequest handler, which gets the session, the blocker-id to send the response
+ *                       with Session::sendResponse and the request-data
+ *
+ * @return false, if the id is 0 or already registered, else true
+ */
+bool
+SessionController::registerRpcMethod(const uint32_t methodId,
+                                     void (*processRequest)(Session*,
+                                                            const uint64_t,
+                                                            DataBuffer*))
+{
+    return SessionHandler::m_rpcDispatcher->registerMethod(methodId, processRequest);
+}
+
+/**
+ * @brief remove the handler of a remote procedure. Following requests for this method are
+ *        rejected and the requester gets an error instead of a timeout.
+ *
+ * @param methodId id of the remote procedure
+ *
+ * @return false, if the id was not registered, else true
+ */
+bool
+SessionController::unregisterRpcMethod(const uint32_t methodId)
+{
+    return SessionHandler::m_rpcDispatcher->unregisterMethod(methodId);
+}
+
+/**
+ * @brief get the metrics of a remote procedure
+ *
+ * @param methodId id of the remote procedure
+ * @param metrics reference for the result
+ *
+ * @return false, if the id is not registered, else true
+ */
+bool
+SessionController::getRpcMetrics(const uint32_t methodId,
+                                 RpcMetrics &metrics)
+{
+    return SessionHandler::m_rpcDispatcher->getMetrics(methodId, metrics);
 }
 
 /**
@@ -377,25 +1043,23 @@ SessionController::linkSessions(Session* session1, Session* session2)
 {
     bool result = false;
 
-    // lock both spin-locks
-    while(session1->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
-    }
-    while(session2->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
+    if(session1 == session2) {
+        return false;
     }
 
+    // lock both spin-locks in the same order like the link-groups
+    lockLinkSessions(session1, session2);
+
     // check and link sessions
-    if(session1->m_linkedSession != nullptr
-            || session2->m_linkedSession != nullptr)
+    if(session1->m_linkedSession == nullptr
+            && session2->m_linkedSession == nullptr)
     {
-        session1->m_linkedSession = session2->m_linkedSession;
-        session2->m_linkedSession = session1->m_linkedSession;
+        session1->m_linkedSession = session2;
+        session2->m_linkedSession = session1;
+        result = true;
     }
 
-    // releads spin-locks
-    session2->m_linkSession_lock.clear(std::memory_order_release);
-    session1->m_linkSession_lock.clear(std::memory_order_release);
+    unlockLinkSessions(session1, session2);
 
     return result;
 }
@@ -410,66 +1074,223 @@ SessionController::linkSessions(Session* session1, Session* session2)
 bool
 SessionController::unlinkSession(Session* session)
 {
-    Session* session2 = nullptr;
+    while(true)
+    {
+        // get the linked session without holding its lock
+        while(session->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+            asm("");
+        }
+        Session* session2 = session->m_linkedSession;
+        session->m_linkSession_lock.clear(std::memory_order_release);
+
+        if(session2 == nullptr) {
+            return false;
+        }
+
+        // lock both spin-locks in the same order like linkSessions and retry, if the link was
+        // changed in the meantime
+        lockLinkSessions(session, session2);
+        if(session->m_linkedSession == session2)
+        {
+            session->m_linkedSession = nullptr;
+            session2->m_linkedSession = nullptr;
+            unlockLinkSessions(session, session2);
+            return true;
+        }
+        unlockLinkSessions(session, session2);
+    }
+}
+
+/**
+ * @brief add a session to the link-group of another session. All incoming messages of the source
+ *        are forwarded to all sessions of its link-group.
+ *
+ * @param source session, which receives the messages to forward
+ * @param target session, which should receive the forwarded messages
+ *
+ * @return false, if target is already in a link-group or the sessions are the same, else true
+ */
+bool
+SessionController::addToLinkGroup(Session* source, Session* target)
+{
+    if(source == target) {
+        return false;
+    }
 
-    while(session->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
-        asm("");
+    bool result = false;
+
+    lockLinkSessions(source, target);
+
+    if(target->m_linkGroupSource == nullptr)
+    {
+        source->m_linkGroup.push_back(target);
+        target->m_linkGroupSource = source;
+        result = true;
     }
 
-    if(session->m_linkedSession == nullptr)
+    unlockLinkSessions(source, target);
+
+    return result;
+}
+
+/**
+ * @brief remove a session from the link-group of another session
+ *
+ * @param source session, which owns the link-group
+ * @param target session, which should be removed from the link-group
+ *
+ * @return false, if target is not within the link-group of the source, else true
+ */
+bool
+SessionController::removeFromLinkGroup(Session* source, Session* target)
+{
+    bool result = false;
+
+    lockLinkSessions(source, target);
+
+    std::vector<Session*>::iterator it;
+    for(it = source->m_linkGroup.begin();
+        it != source->m_linkGroup.end();
+        it++)
     {
-        session->m_linkSession_lock.clear(std::memory_order_release);
-        return false;
+        if(*it == target)
+        {
+            source->m_linkGroup.erase(it);
+            target->m_linkGroupSource = nullptr;
+            result = true;
+            break;
+        }
     }
 
-    session2 = session->m_linkedSession;
+    unlockLinkSessions(source, target);
+
+    return result;
+}
+
+/**
+ * @brief lock the link-spin-locks of two sessions. The locks are always taken in the order of
+ *        the addresses of the sessions, so two calls with swapped sessions can not deadlock.
+ *
+ * @param session1 first session
+ * @param session2 second session
+ */
+void
+SessionController::lockLinkSessions(Session* session1, Session* session2)
+{
+    Session* first = std::min(session1, session2);
+    Session* second = std::max(session1, session2);
 
-    while(session2->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+    while(first->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
         asm("");
     }
+    while(second->m_linkSession_lock.test_and_set(std::memory_order_acquire))  {
+        asm("");
+    }
+}
 
-    // unlink both sessions
-    session->m_linkedSession = nullptr;
-    session2->m_linkedSession = nullptr;
-
-    // releads spin-locks
+/**
+ * @brief release the link-spin-locks of two sessions, which were locked by lockLinkSessions
+ *
+ * @param session1 first session
+ * @param session2 second session
+ */
+void
+SessionController::unlockLinkSessions(Session* session1, Session* session2)
+{
+    session1->m_linkSession_lock.clear(std::memory_order_release);
     session2->m_linkSession_lock.clear(std::memory_order_release);
-    session->m_linkSession_lock.clear(std::memory_order_release);
-
-    return true;
 }
 
 /**
- * @brief start a new session
+ * @brief start a new session and wait until it is ready
  *
  * @param socket socket of the new session
  * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param timeoutMs time in milliseconds to wait for the reply of the server
  *
  * @return true, if session was successfully created and connected, else false
  */
 Session*
 SessionController::startSession(Network::AbstractSocket *socket,
-                                const std::string &sessionIdentifier)
+                                const std::string &sessionIdentifier,
+                                const uint32_t timeoutMs)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+    Session* newSession = initSession(socket, sessionIdentifier);
+    if(newSession == nullptr) {
+        return nullptr;
+    }
+
+    return finishSession(newSession, deadline);
+}
+
+/**
+ * @brief connect a new session and send the init-message without waiting for the reply
+ *
+ * @param socket socket of the new session
+ * @param sessionIdentifier additional identifier as help for an upper processing-layer
+ * @param earlyData optional first message, which is send together with the init-message
+ *
+ * @return new session, if connected, else nullptr
+ */
+Session*
+SessionController::initSession(Network::AbstractSocket *socket,
+                               const std::string &sessionIdentifier,
+                               EarlyData* earlyData)
 {
     // precheck
-    if(sessionIdentifier.size() > 64) {
+    if(sessionIdentifier.size() > 64)
+    {
+        delete socket;
         return nullptr;
     }
 
     // create new session
     Session* newSession = new Session(socket);
-    const uint32_t newId = SessionHandler::m_sessionHandler->increaseSessionIdCounter();
+    const uint32_t newId = SessionHandler::m_sessionHandler->allocateSessionId();
     socket->setMessageCallback(newSession, &processMessage_callback);
 
     // connect session
     if(newSession->connectiSession(newId))
     {
         SessionHandler::m_sessionHandler->addSession(newId, newSession);
-        send_Session_Init_Start(newSession, sessionIdentifier);
 
-        std::unique_lock<std::mutex> lock(newSession->m_cvMutex);
-        newSession->m_cv.wait(lock);
+        if(earlyData == nullptr)
+        {
+            send_Session_Init_Start(newSession, sessionIdentifier);
+            return newSession;
+        }
+
+        // build first message and send it together with the init-message
+        std::vector<uint8_t> messageBuffer;
+        std::vector<uint64_t> messagePositions;
+        if(earlyData->isRequest)
+        {
+            earlyData->blockerId = newSession->m_multiblockIo->getRandValue();
+            build_Data_SingleBlock(messageBuffer,
+                                   messagePositions,
+                                   earlyData->blockerId,
+                                   earlyData->data,
+                                   static_cast<uint32_t>(earlyData->size),
+                                   static_cast<uint32_t>(earlyData->blockerTimeout),
+                                   true);
+            SessionHandler::m_blockerHandler->registerBlocker(earlyData->blockerId,
+                                                              earlyData->blockerTimeout,
+                                                              newSession);
+        }
+        else
+        {
+            build_Data_Stream(messageBuffer,
+                              messagePositions,
+                              earlyData->data,
+                              earlyData->size);
+        }
 
+        send_Session_Init_Start_With_Data(newSession,
+                                          sessionIdentifier,
+                                          messageBuffer,
+                                          messagePositions);
         return newSession;
     }
     else
@@ -481,6 +1302,34 @@ SessionController::startSession(Network::AbstractSocket *socket,
     return nullptr;
 }
 
+/**
+ * @brief wait until the server has replied to the init-message of a session
+ *
+ * @param session session, which was created by initSession
+ * @param deadline point in time, until the session must be ready
+ *
+ * @return session, if ready before the deadline, else nullptr
+ */
+Session*
+SessionController::finishSession(Session* session,
+                                 const std::chrono::steady_clock::time_point &deadline)
+{
+    if(session->waitUntilReady(deadline)) {
+        return session;
+    }
+
+    LOG_ERROR("timeout while starting session with id " + std::to_string(session->sessionId()));
+
+    // the session goes into disconnected state and the object is released by the session-handler
+    // and not deleted directly, because the receive-thread of the socket may still reference it,
+    // until the thread is stopped
+    SessionHandler::m_sessionHandler->removeSession(session->m_localSessionId);
+    session->disconnectSession();
+    SessionHandler::m_sessionHandler->recycleSession(session);
+
+    return nullptr;
+}
+
 //==================================================================================================
 
 } // namespace Sakura
@@ -0,0 +1,616 @@
+/**
+ * @file       session_pool.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <libKitsunemimiSakuraNetwork/session_pool.h>
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <handler/session_handler.h>
+
+#include <set>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param sessionController controller to start the sessions of the pool
+ * @param minIdleSessions number of warm sessions, which are held ready per endpoint in addition
+ *                        to the leased sessions
+ * @param maxSessions maximum number of idle and leased sessions per endpoint
+ * @param maxMissedHeartbeats number of unanswered heartbeats, until a session is unhealthy
+ * @param idleTimeoutMs time in milliseconds, after which unneeded idle sessions are closed
+ */
+SessionPool::SessionPool(SessionController* sessionController,
+                         const uint32_t minIdleSessions,
+                         const uint32_t maxSessions,
+                         const uint32_t maxMissedHeartbeats,
+                         const uint32_t idleTimeoutMs)
+    : Kitsunemimi::Thread()
+{
+    m_sessionController = sessionController;
+    m_minIdleSessions = minIdleSessions;
+    m_maxSessions = maxSessions;
+    m_maxMissedHeartbeats = maxMissedHeartbeats;
+    m_idleTimeout = std::chrono::milliseconds(idleTimeoutMs);
+
+    startThread();
+}
+
+/**
+ * @brief destructor, which closes all idle sessions. Sessions, which are leased at this moment,
+ *        are not closed and belong to the caller afterwards. Running lease-calls are woken up and
+ *        the destructor waits until they have released their endpoints.
+ */
+SessionPool::~SessionPool()
+{
+    stopThread();
+
+    std::vector<Session*> sessionsToClose;
+
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    // remove all endpoints like removeEndpoint. Pinned endpoints are deleted by the lease-call,
+    // which has pinned them.
+    std::map<std::string, Endpoint*>::iterator it;
+    for(it = m_endpoints.begin();
+        it != m_endpoints.end();
+        it++)
+    {
+        Endpoint* endpoint = it->second;
+        endpoint->removed = true;
+        for(const IdleSession &idle : endpoint->idleSessions) {
+            sessionsToClose.push_back(idle.session);
+        }
+        endpoint->idleSessions.clear();
+
+        if(isUnused(endpoint)) {
+            delete endpoint;
+        }
+    }
+    m_endpoints.clear();
+
+    m_poolCv.notify_all();
+    m_poolCv.wait(lock, [this] { return m_numberOfPins == 0; });
+
+    // endpoints with leased sessions are not deleted by anyone else
+    std::set<Endpoint*> leasedEndpoints;
+    std::map<Session*, Endpoint*>::const_iterator leasedIt;
+    for(leasedIt = m_leasedSessions.begin();
+        leasedIt != m_leasedSessions.end();
+        leasedIt++)
+    {
+        leasedEndpoints.insert(leasedIt->second);
+    }
+    for(Endpoint* endpoint : leasedEndpoints) {
+        delete endpoint;
+    }
+    m_leasedSessions.clear();
+    lock.unlock();
+
+    for(Session* session : sessionsToClose) {
+        closePooledSession(session);
+    }
+}
+
+/**
+ * @brief register a new endpoint to the pool. The warm sessions are started by the
+ *        maintenance-thread of the pool.
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ * @param sessionIdentifier additional identifier for all sessions to this endpoint
+ *
+ * @return false, if endpoint is already registered, else true
+ */
+bool
+SessionPool::addEndpoint(const std::string &address,
+                         const uint16_t port,
+                         const std::string &sessionIdentifier)
+{
+    std::lock_guard<std::mutex> guard(m_poolMutex);
+
+    const std::string key = address + ":" + std::to_string(port);
+    if(m_endpoints.find(key) != m_endpoints.end()) {
+        return false;
+    }
+
+    Endpoint* endpoint = new Endpoint();
+    endpoint->address = address;
+    endpoint->port = port;
+    endpoint->sessionIdentifier = sessionIdentifier;
+    m_endpoints.insert(std::make_pair(key, endpoint));
+
+    return true;
+}
+
+/**
+ * @brief remove an endpoint from the pool and close all of its idle sessions. Leased sessions
+ *        are closed, when they are released.
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ *
+ * @return false, if endpoint was not found, else true
+ */
+bool
+SessionPool::removeEndpoint(const std::string &address,
+                            const uint16_t port)
+{
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    const std::string key = address + ":" + std::to_string(port);
+    std::map<std::string, Endpoint*>::iterator it;
+    it = m_endpoints.find(key);
+    if(it == m_endpoints.end()) {
+        return false;
+    }
+
+    Endpoint* endpoint = it->second;
+    m_endpoints.erase(it);
+    endpoint->removed = true;
+
+    std::vector<IdleSession> idleSessions;
+    idleSessions.swap(endpoint->idleSessions);
+    if(isUnused(endpoint)) {
+        delete endpoint;
+    }
+
+    // wake up waiting lease-calls of the endpoint
+    m_poolCv.notify_all();
+    lock.unlock();
+
+    for(const IdleSession &idle : idleSessions) {
+        closePooledSession(idle.session);
+    }
+
+    return true;
+}
+
+/**
+ * @brief lease a session to an endpoint. The most recently used healthy idle session is taken.
+ *        If there is no one, a new session is started, as long as the maximum number of sessions
+ *        is not reached, else it waits until another session is released.
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ * @param timeoutMs time in milliseconds to wait for a free or new session
+ *
+ * @return leased session, which must be given back with release, or nullptr in case of an error
+ */
+Session*
+SessionPool::lease(const std::string &address,
+                   const uint16_t port,
+                   const uint32_t timeoutMs)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                                                           + std::chrono::milliseconds(timeoutMs);
+
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    Endpoint* endpoint = getEndpoint(address, port);
+    if(endpoint == nullptr) {
+        return nullptr;
+    }
+
+    // pin the endpoint, because the lock is released while waiting or starting a new session
+    endpoint->numberOfPins++;
+    m_numberOfPins++;
+    Session* session = nullptr;
+
+    while(session == nullptr
+          && endpoint->removed == false)
+    {
+        // take the warmest idle session
+        while(endpoint->idleSessions.size() > 0)
+        {
+            Session* idleSession = endpoint->idleSessions.back().session;
+            endpoint->idleSessions.pop_back();
+
+            if(isHealthy(idleSession))
+            {
+                session = idleSession;
+                break;
+            }
+
+            lock.unlock();
+            closePooledSession(idleSession);
+            lock.lock();
+        }
+
+        if(session != nullptr) {
+            break;
+        }
+
+        // start a new session, if the limit is not reached
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(now >= deadline) {
+            break;
+        }
+
+        const uint32_t totalSessions = endpoint->numberOfLeased + endpoint->numberOfStarting;
+        if(totalSessions < m_maxSessions)
+        {
+            const uint32_t remainingMs = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+
+            endpoint->numberOfStarting++;
+            const std::string endpointAddress = endpoint->address;
+            const std::string sessionIdentifier = endpoint->sessionIdentifier;
+            lock.unlock();
+
+            session = m_sessionController->startTcpSessionAsync(endpointAddress,
+                                                                port,
+                                                                sessionIdentifier,
+                                                                remainingMs).get();
+
+            lock.lock();
+            endpoint->numberOfStarting--;
+            break;
+        }
+
+        // wait for a released session
+        m_poolCv.wait_until(lock, deadline);
+    }
+
+    if(session != nullptr)
+    {
+        endpoint->numberOfLeased++;
+        endpoint->peakLeased = std::max(endpoint->peakLeased, endpoint->numberOfLeased);
+        m_leasedSessions.insert(std::make_pair(session, endpoint));
+    }
+
+    endpoint->numberOfPins--;
+    m_numberOfPins--;
+    if(isUnused(endpoint)) {
+        delete endpoint;
+    }
+
+    // release a waiting destructor
+    if(m_numberOfPins == 0) {
+        m_poolCv.notify_all();
+    }
+
+    return session;
+}
+
+/**
+ * @brief give a leased session back to the pool. Broken or unhealthy sessions are closed
+ *        instead of being reused.
+ *
+ * @param session leased session
+ * @param broken set to true, if the caller has detected an error on the session
+ *
+ * @return false, if the session was not leased from this pool, else true
+ */
+bool
+SessionPool::release(Session* session,
+                     const bool broken)
+{
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    std::map<Session*, Endpoint*>::iterator it;
+    it = m_leasedSessions.find(session);
+    if(it == m_leasedSessions.end()) {
+        return false;
+    }
+
+    Endpoint* endpoint = it->second;
+    m_leasedSessions.erase(it);
+    endpoint->numberOfLeased--;
+
+    if(broken == false
+            && endpoint->removed == false
+            && isHealthy(session))
+    {
+        IdleSession idle;
+        idle.session = session;
+        idle.idleSince = std::chrono::steady_clock::now();
+        endpoint->idleSessions.push_back(idle);
+        m_poolCv.notify_all();
+        return true;
+    }
+
+    if(isUnused(endpoint)) {
+        delete endpoint;
+    }
+
+    // the closed session frees a place for a new session
+    m_poolCv.notify_all();
+    lock.unlock();
+
+    closePooledSession(session);
+
+    return true;
+}
+
+/**
+ * @brief get number of idle sessions of an endpoint
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ *
+ * @return number of idle sessions
+ */
+uint32_t
+SessionPool::numberOfIdleSessions(const std::string &address,
+                                  const uint16_t port)
+{
+    std::lock_guard<std::mutex> guard(m_poolMutex);
+
+    Endpoint* endpoint = getEndpoint(address, port);
+    if(endpoint == nullptr) {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(endpoint->idleSessions.size());
+}
+
+/**
+ * @brief get number of leased sessions of an endpoint
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ *
+ * @return number of leased sessions
+ */
+uint32_t
+SessionPool::numberOfLeasedSessions(const std::string &address,
+                                    const uint16_t port)
+{
+    std::lock_guard<std::mutex> guard(m_poolMutex);
+
+    Endpoint* endpoint = getEndpoint(address, port);
+    if(endpoint == nullptr) {
+        return 0;
+    }
+
+    return endpoint->numberOfLeased;
+}
+
+/**
+ * @brief maintenance-loop, which checks the pool once per second
+ */
+void
+SessionPool::run()
+{
+    uint32_t counter = 0;
+
+    while(!m_abort)
+    {
+        sleepThread(100000);
+        counter += 1;
+
+        if(m_abort) {
+            break;
+        }
+
+        if(counter % 10 == 0)
+        {
+            std::unique_lock<std::mutex> lock(m_poolMutex);
+
+            // copy the list, because the lock is released while starting new sessions
+            std::vector<Endpoint*> endpoints;
+            std::map<std::string, Endpoint*>::iterator it;
+            for(it = m_endpoints.begin();
+                it != m_endpoints.end();
+                it++)
+            {
+                endpoints.push_back(it->second);
+                it->second->numberOfPins++;
+            }
+
+            for(Endpoint* endpoint : endpoints)
+            {
+                endpoint->numberOfPins--;
+                if(endpoint->removed)
+                {
+                    if(isUnused(endpoint)) {
+                        delete endpoint;
+                    }
+                    continue;
+                }
+
+                maintainEndpoint(lock, endpoint);
+            }
+
+            counter = 0;
+        }
+    }
+}
+
+/**
+ * @brief Close unhealthy idle sessions and adjust the number of sessions of an endpoint to the
+ *        demand. The target is the highest number of leased sessions since the last check plus
+ *        the minimum number of warm sessions. Idle sessions above this target are closed after
+ *        the idle-timeout, missing sessions are started in parallel.
+ *
+ * @param lock locked pool-lock, which is released while closing and starting sessions
+ * @param endpoint endpoint to check
+ */
+void
+SessionPool::maintainEndpoint(std::unique_lock<std::mutex> &lock,
+                              Endpoint* endpoint)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const uint32_t targetSize = std::min(m_maxSessions,
+                                         endpoint->peakLeased + m_minIdleSessions);
+    endpoint->peakLeased = endpoint->numberOfLeased;
+
+    // collect unhealthy sessions and the oldest expired sessions above the target
+    std::vector<Session*> sessionsToClose;
+    std::vector<IdleSession> keep;
+    uint32_t totalSessions = endpoint->numberOfLeased
+                             + endpoint->numberOfStarting
+                             + static_cast<uint32_t>(endpoint->idleSessions.size());
+    for(const IdleSession &idle : endpoint->idleSessions)
+    {
+        if(isHealthy(idle.session) == false
+                || (totalSessions > targetSize && now - idle.idleSince > m_idleTimeout))
+        {
+            sessionsToClose.push_back(idle.session);
+            totalSessions--;
+        }
+        else
+        {
+            keep.push_back(idle);
+        }
+    }
+    endpoint->idleSessions.swap(keep);
+
+    // fill up to the target
+    std::vector<SessionController::SessionTarget> targets;
+    if(totalSessions < targetSize)
+    {
+        SessionController::SessionTarget target;
+        target.address = endpoint->address;
+        target.port = endpoint->port;
+        target.sessionIdentifier = endpoint->sessionIdentifier;
+        targets.resize(targetSize - totalSessions, target);
+    }
+
+    if(sessionsToClose.size() == 0
+            && targets.size() == 0)
+    {
+        return;
+    }
+
+    const uint32_t numberOfNew = static_cast<uint32_t>(targets.size());
+    endpoint->numberOfStarting += numberOfNew;
+    lock.unlock();
+
+    for(Session* session : sessionsToClose) {
+        closePooledSession(session);
+    }
+
+    std::vector<Session*> newSessions;
+    if(numberOfNew > 0) {
+        newSessions = m_sessionController->startTcpSessions(targets);
+    }
+
+    lock.lock();
+    endpoint->numberOfStarting -= numberOfNew;
+
+    for(Session* session : newSessions)
+    {
+        if(session == nullptr) {
+            continue;
+        }
+
+        if(endpoint->removed) {
+            continue;
+        }
+
+        IdleSession idle;
+        idle.session = session;
+        idle.idleSince = std::chrono::steady_clock::now();
+        endpoint->idleSessions.push_back(idle);
+    }
+
+    if(numberOfNew > 0) {
+        m_poolCv.notify_all();
+    }
+
+    // close sessions, which were started for an endpoint, which was removed in the meantime
+    if(endpoint->removed)
+    {
+        lock.unlock();
+        for(Session* session : newSessions)
+        {
+            if(session != nullptr) {
+                closePooledSession(session);
+            }
+        }
+        lock.lock();
+    }
+}
+
+/**
+ * @brief check if a session can be used
+ *
+ * @param session session to check
+ *
+ * @return true, if session is active and has no more than the allowed unanswered heartbeats
+ */
+bool
+SessionPool::isHealthy(Session* session)
+{
+    return session->isActive()
+           && session->missedHeartbeats() <= m_maxMissedHeartbeats;
+}
+
+/**
+ * @brief close a session, which belongs to the pool. The session is not deleted directly, but
+ *        given to the session-handler, which releases it, when it isn't referenced anymore by the
+ *        internal handlers and the receive-thread of its socket.
+ *
+ * @param session session to close
+ */
+void
+SessionPool::closePooledSession(Session* session)
+{
+    session->closeSession(false);
+    SessionHandler::m_sessionHandler->recycleSession(session);
+}
+
+/**
+ * @brief check if a removed endpoint can be deleted
+ *
+ * @param endpoint endpoint to check
+ *
+ * @return true, if endpoint is removed and not used anymore
+ */
+bool
+SessionPool::isUnused(Endpoint* endpoint)
+{
+    return endpoint->removed
+           && endpoint->numberOfLeased == 0
+           && endpoint->numberOfStarting == 0
+           && endpoint->numberOfPins == 0;
+}
+
+/**
+ * @brief get a registered endpoint
+ *
+ * @param address ip-address of the server
+ * @param port port where the server is listening
+ *
+ * @return pointer to the endpoint, if found, else nullptr
+ */
+SessionPool::Endpoint*
+SessionPool::getEndpoint(const std::string &address,
+                         const uint16_t port)
+{
+    std::map<std::string, Endpoint*>::iterator it;
+    it = m_endpoints.find(address + ":" + std::to_string(port));
+    if(it == m_endpoints.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
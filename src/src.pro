@@ -28,6 +28,7 @@ INCLUDEPATH += $$PWD \
 HEADERS += \
     ../include/libKitsunemimiSakuraNetwork/session.h \
     ../include/libKitsunemimiSakuraNetwork/session_controller.h \
+    ../include/libKitsunemimiSakuraNetwork/session_pool.h \
     callbacks.h \
     message_definitions.h \
     messages_processing/session_processing.h \
@@ -40,13 +41,39 @@ HEADERS += \
     handler/reply_handler.h \
     handler/message_blocker_handler.h \
     messages_processing/stream_data_processing.h \
-    messages_processing/singleblock_data_processing.h
+    messages_processing/singleblock_data_processing.h \
+    reuse_port_tcp_server.h \
+    kernel_tls.h \
+    kernel_tls_tcp_socket.h \
+    kernel_tls_tcp_server.h \
+    stripe_sender.h \
+    messages_processing/pubsub_processing.h \
+    handler/topic_handler.h \
+    handler/topic_subscriber.h \
+    handler/topic_worker.h \
+    handler/session_registry.h \
+    handler/request_scheduler.h \
+    handler/request_worker.h \
+    handler/rpc_dispatcher.h
 
 SOURCES += \
     session.cpp \
     session_constroller.cpp \
+    session_pool.cpp \
     handler/session_handler.cpp \
     multiblock_io.cpp \
     handler/replay_handler.cpp \
-    handler/message_blocker_handler.cpp
+    handler/message_blocker_handler.cpp \
+    reuse_port_tcp_server.cpp \
+    kernel_tls.cpp \
+    kernel_tls_tcp_socket.cpp \
+    kernel_tls_tcp_server.cpp \
+    stripe_sender.cpp \
+    handler/topic_handler.cpp \
+    handler/topic_subscriber.cpp \
+    handler/topic_worker.cpp \
+    handler/session_registry.cpp \
+    handler/request_scheduler.cpp \
+    handler/request_worker.cpp \
+    handler/rpc_dispatcher.cpp
 
@@ -0,0 +1,155 @@
+/**
+ * @file       stripe_sender.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "stripe_sender.h"
+
+#include <libKitsunemimiSakuraNetwork/session.h>
+#include <messages_processing/multiblock_data_processing.h>
+#include <multiblock_io.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+/**
+ * @brief constructor
+ *
+ * @param session session, to which the stripe belongs
+ * @param socket connected socket of the stripe
+ */
+StripeSender::StripeSender(Session* session,
+                           Network::AbstractSocket* socket)
+    : Kitsunemimi::Thread()
+{
+    m_session = session;
+    m_socket = socket;
+    m_session->addReference();
+}
+
+/**
+ * @brief destructor
+ */
+StripeSender::~StripeSender()
+{
+    m_session->releaseReference();
+}
+
+/**
+ * @brief add a part of a multi-block-message to the queue of the stripe. If the stripe is
+ *        already closed, the part is directly registered as failed.
+ *
+ * @param part part to send
+ */
+void
+StripeSender::addPart(const StripePart &part)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+        if(m_closed == false)
+        {
+            m_queue.push_back(part);
+            m_queueCv.notify_one();
+            return;
+        }
+    }
+
+    part.source->finishStripePart(false);
+}
+
+/**
+ * @brief close the stripe and register all still queued parts as failed, so the sender of the
+ *        message doesn't wait for them
+ */
+void
+StripeSender::close()
+{
+    std::deque<StripePart> remainingParts;
+
+    {
+        std::lock_guard<std::mutex> guard(m_queueMutex);
+        m_closed = true;
+        remainingParts.swap(m_queue);
+    }
+
+    for(const StripePart &part : remainingParts) {
+        part.source->finishStripePart(false);
+    }
+}
+
+/**
+ * @brief Main-loop to send the queued parts. Each stripe has its own thread, so the encryption
+ *        of the parts, which is done by the socket while sending, runs in parallel on multiple
+ *        cores.
+ */
+void
+StripeSender::run()
+{
+    while(m_abort == false)
+    {
+        StripePart part;
+
+        // get next part from the queue and wait with timeout to check the abort-flag regularly
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            if(m_queue.empty())
+            {
+                m_queueCv.wait_for(lock, std::chrono::milliseconds(10));
+                continue;
+            }
+
+            part = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        // skip parts of an aborted message, but still register them as finished
+        bool success = true;
+        if(part.source->isCurrentMessageAborted() == false)
+        {
+            success = send_Data_Multi_Static(m_session,
+                                             part.multiblockId,
+                                             part.totalPartNumber,
+                                             part.partId,
+                                             part.data,
+                                             part.size,
+                                             m_socket);
+
+            // the other side identifies the parts by their id, so a part of a broken stripe can
+            // be send over the main-connection of the session instead
+            if(success == false
+                    && m_session->isActive())
+            {
+                success = send_Data_Multi_Static(m_session,
+                                                 part.multiblockId,
+                                                 part.totalPartNumber,
+                                                 part.partId,
+                                                 part.data,
+                                                 part.size);
+            }
+        }
+
+        part.source->finishStripePart(success);
+    }
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,83 @@
+/**
+ * @file       stripe_sender.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef STRIPE_SENDER_H
+#define STRIPE_SENDER_H
+
+#include <iostream>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include <libKitsunemimiCommon/threading/thread.h>
+
+namespace Kitsunemimi
+{
+namespace Network {
+class AbstractSocket;
+}
+namespace Sakura
+{
+class Session;
+class MultiblockIO;
+
+class StripeSender
+        : public Kitsunemimi::Thread
+{
+public:
+    // single part of a multi-block-message, which should be send over the stripe
+    struct StripePart
+    {
+        MultiblockIO* source = nullptr;
+        uint64_t multiblockId = 0;
+        uint32_t totalPartNumber = 0;
+        uint32_t partId = 0;
+        const uint8_t* data = nullptr;
+        uint32_t size = 0;
+    };
+
+    StripeSender(Session* session,
+                 Network::AbstractSocket* socket);
+    ~StripeSender();
+
+    Network::AbstractSocket* m_socket = nullptr;
+
+    void addPart(const StripePart &part);
+    void close();
+
+protected:
+    void run();
+
+private:
+    Session* m_session = nullptr;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::deque<StripePart> m_queue;
+    bool m_closed = false;
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // STRIPE_SENDER_H
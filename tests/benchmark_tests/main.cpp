@@ -38,7 +38,10 @@ int main(int argc, char *argv[])
     argParser.registerString("socket,s",
                              "type: tcp or uds (Default: tcp)");
     argParser.registerString("transfer-type,t",
-                             "type of transfer: stream, standalone or request (Default: stream)");
+                             "type of transfer: stream, standalone, request, request_batch, "
+                             "hedged_request, state_check or churn (Default: stream)");
+    argParser.registerFlag("no-reply",
+                           "disable the transport-replies of single-block-messages");
     argParser.registerInteger("package-size",
                               "Test-package-size in byte(Default: 128 KiB)",
                               true,
@@ -54,6 +57,7 @@ int main(int argc, char *argv[])
     std::string socket = "tcp";
     std::string transferType = "stream";
     long packageSize = 128*1024;
+    bool noReply = false;
 
     if(argParser.wasSet("address")) {
         address = argParser.getStringValues("address").at(0);
@@ -67,6 +71,9 @@ int main(int argc, char *argv[])
     if(argParser.wasSet("transfer-type")) {
         transferType = argParser.getStringValues("transfer-type").at(0);
     }
+    if(argParser.wasSet("no-reply")) {
+        noReply = true;
+    }
 
     packageSize = argParser.getIntValue("package-size");
 
@@ -82,10 +89,25 @@ int main(int argc, char *argv[])
     if(transferType != "stream"
             && transferType != "standalone"
             && transferType != "request"
-            && transferType != "stack_stream")
+            && transferType != "request_batch"
+            && transferType != "hedged_request"
+            && transferType != "stack_stream"
+            && transferType != "state_check"
+            && transferType != "churn")
     {
         std::cout<<"ERROR: transfer-type \""<<transferType<<"\" is unknown. "
-                   "Choose \"stream\", \"standalone\" or \"request\"."<<std::endl;;
+                   "Choose \"stream\", \"standalone\", \"request\", \"request_batch\", "
+                   "\"hedged_request\", \"state_check\" or \"churn\"."
+                 <<std::endl;;
+        exit(1);
+    }
+
+    // the churn-test and the hedged requests open new tcp-sessions
+    if((transferType == "churn" || transferType == "hedged_request")
+            && socket != "tcp")
+    {
+        std::cout<<"ERROR: transfer-type \""<<transferType<<"\" requires socket-type \"tcp\"."
+                 <<std::endl;
         exit(1);
     }
 
@@ -96,12 +118,14 @@ int main(int argc, char *argv[])
     std::cout<<"socket: "<<socket<<std::endl;
     std::cout<<"transfer-type: "<<transferType<<std::endl;
     std::cout<<"package-size: "<<packageSize<<std::endl;
+    std::cout<<"no-reply: "<<noReply<<std::endl;
     std::cout<<"--------------------------------------"<<std::endl;
 
     Kitsunemimi::Sakura::TestSession testSession(address,
                                                  port,
                                                  socket,
-                                                 transferType);
+                                                 transferType,
+                                                 noReply);
 
     testSession.runTest(packageSize);
 }
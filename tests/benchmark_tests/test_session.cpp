@@ -9,6 +9,8 @@
 #include <libKitsunemimiCommon/buffer/data_buffer.h>
 #include <libKitsunemimiCommon/common_items/table_item.h>
 
+#include <algorithm>
+
 namespace Kitsunemimi
 {
 namespace Sakura
@@ -48,8 +50,9 @@ void standaloneDataCallback(Kitsunemimi::Sakura::Session* session,
                             const uint64_t blockerId,
                             Kitsunemimi::DataBuffer* data)
 {
-    // handling for request transfer-type
-    if(TestSession::m_instance->m_transferType == "request")
+    // handling for request transfer-types
+    if(TestSession::m_instance->m_transferType == "request"
+            || TestSession::m_instance->m_transferType == "request_batch")
     {
         if(session->isClientSide() == false)
         {
@@ -60,6 +63,21 @@ void standaloneDataCallback(Kitsunemimi::Sakura::Session* session,
         }
     }
 
+    // handling for hedged requests with a synthetic slow responder, which delays every 50th
+    // response of a session
+    if(TestSession::m_instance->m_transferType == "hedged_request")
+    {
+        if(session->isClientSide() == false)
+        {
+            delete data;
+            if(TestSession::m_instance->m_requestCounter.fetch_add(1) % 50 == 49) {
+                usleep(20000);
+            }
+            uint8_t data[10];
+            session->sendResponse(data, 10, blockerId);
+        }
+    }
+
     // handling for standalone transfer-type
     if(TestSession::m_instance->m_transferType == "standalone")
     {
@@ -97,6 +115,14 @@ void sessionCreateCallback(Kitsunemimi::Sakura::Session* session,
 {
     session->setStreamMessageCallback(&streamDataCallback);
     session->setStandaloneMessageCallback(&standaloneDataCallback);
+    if(TestSession::m_instance->m_noReply) {
+        session->setDeliveryAssurance(Session::NO_TRANSPORT_REPLY);
+    }
+
+    // the churn-test creates too many sessions for an output and doesn't use the pointers
+    if(TestSession::m_instance->m_transferType == "churn") {
+        return;
+    }
 
     std::cout<<"session-callback for id: "<<session->m_sessionId<<"\n"<<std::endl;
 
@@ -117,6 +143,10 @@ void sessionCreateCallback(Kitsunemimi::Sakura::Session* session,
 void sessionCloseCallback(Kitsunemimi::Sakura::Session*,
                           const std::string)
 {
+    if(TestSession::m_instance->m_transferType == "churn") {
+        return;
+    }
+
     std::cout<<"end session"<<std::endl;
     TestSession::m_instance->m_clientSession = nullptr;
     TestSession::m_instance->m_serverSession = nullptr;
@@ -129,11 +159,13 @@ void sessionCloseCallback(Kitsunemimi::Sakura::Session*,
  * @param port port-number
  * @param socket socket-type (tcp or uds)
  * @param transferType transfer-type (stream, standalone or request)
+ * @param noReply true to disable the transport-replies of single-block-messages
  */
 TestSession::TestSession(const std::string &address,
                          const uint16_t port,
                          const std::string &socket,
-                         const std::string &transferType)
+                         const std::string &transferType,
+                         const bool noReply)
 {
     TestSession::m_instance = this;
 
@@ -142,6 +174,9 @@ TestSession::TestSession(const std::string &address,
     m_dataBuffer = new uint8_t[128*1024*1024];
 
     m_transferType = transferType;
+    m_noReply = noReply;
+    m_address = address;
+    m_port = port;
     if(socket == "tcp") {
         m_isTcp = true;
     } else {
@@ -283,6 +318,133 @@ TestSession::runTest(const long packageSize)
             }
         }
 
+        // send request-messages in batches, which need only one round-trip per batch
+        if(m_transferType == "request_batch")
+        {
+            const long batchSize = 100;
+            std::vector<Session::RequestItem> batch(batchSize);
+            for(Session::RequestItem &item : batch)
+            {
+                item.data = m_dataBuffer;
+                item.size = static_cast<uint64_t>(packageSize);
+            }
+
+            m_timeSlot.name = "request_batch-speed";
+            for(int j = 0; j < 10; j++)
+            {
+                std::cout<<"request_batch"<<std::endl;
+                m_timeSlot.startTimer();
+                for(long i = 0; i < (10l*1024l*1024l*1024l) / packageSize; i += batchSize)
+                {
+                    m_clientSession->sendRequests(batch, 10000);
+                    for(Session::RequestItem &item : batch)
+                    {
+                        assert(item.state == Session::REQUEST_SUCCESSFUL);
+                        delete item.response;
+                        item.response = nullptr;
+                    }
+                }
+                m_sizeCounter = 0;
+                m_timeSlot.stopTimer();
+                m_timeSlot.values.push_back(calculateSpeed(m_timeSlot.getDuration(MICRO_SECONDS)));
+            }
+        }
+
+        // compare the tail-latency of requests with and without hedging over a second session
+        if(m_transferType == "hedged_request")
+        {
+            Session* firstSession = m_clientSession;
+            Session* secondSession = m_controller->startTcpSession(m_address, m_port);
+            assert(secondSession != nullptr);
+            const std::vector<Session*> sessions = {firstSession, secondSession};
+            const uint64_t size = static_cast<uint64_t>(packageSize);
+            const uint32_t numberOfRequests = 1000;
+
+            TimerSlot plainSlot;
+            plainSlot.name = "request-p99";
+            plainSlot.unitName = "ms";
+            m_timeSlot.name = "hedged_request-p99";
+            m_timeSlot.unitName = "ms";
+            for(int j = 0; j < 10; j++)
+            {
+                std::cout<<"hedged_request"<<std::endl;
+                std::vector<double> plainLatencies;
+                std::vector<double> hedgedLatencies;
+                for(uint32_t i = 0; i < numberOfRequests; i++)
+                {
+                    plainSlot.startTimer();
+                    delete firstSession->sendRequest(m_dataBuffer, size, 10);
+                    plainSlot.stopTimer();
+                    plainLatencies.push_back(plainSlot.getDuration(MICRO_SECONDS) / 1000.0);
+
+                    m_timeSlot.startTimer();
+                    delete m_controller->sendHedgedRequest(sessions, m_dataBuffer, size, 0, 10);
+                    m_timeSlot.stopTimer();
+                    hedgedLatencies.push_back(m_timeSlot.getDuration(MICRO_SECONDS) / 1000.0);
+                }
+
+                const uint64_t pos = (numberOfRequests * 99) / 100;
+                std::sort(plainLatencies.begin(), plainLatencies.end());
+                std::sort(hedgedLatencies.begin(), hedgedLatencies.end());
+                plainSlot.values.push_back(plainLatencies[pos]);
+                m_timeSlot.values.push_back(hedgedLatencies[pos]);
+            }
+
+            addToResult(plainSlot);
+        }
+
+        // open and close sessions as fast as possible
+        if(m_transferType == "churn")
+        {
+            const uint32_t numberOfSessions = 10000;
+            m_timeSlot.name = "session-churn";
+            m_timeSlot.unitName = "sessions/s";
+            for(int j = 0; j < 10; j++)
+            {
+                std::cout<<"churn"<<std::endl;
+                m_timeSlot.startTimer();
+                for(uint32_t i = 0; i < numberOfSessions; i++)
+                {
+                    Session* session = m_controller->startTcpSession(m_address, m_port);
+                    assert(session != nullptr);
+
+                    // the close removes the session from all internal handlers and the
+                    // destructor waits for the references, which are still in use
+                    session->closeSession(false);
+                    delete session;
+                }
+                m_timeSlot.stopTimer();
+
+                const double duration = m_timeSlot.getDuration(MICRO_SECONDS) / 1000000.0;
+                m_timeSlot.values.push_back(static_cast<double>(numberOfSessions) / duration);
+            }
+        }
+
+        // check the session-state in the same way like every send-call
+        if(m_transferType == "state_check")
+        {
+            const uint64_t numberOfChecks = 100000000;
+            m_timeSlot.name = "state-check-speed";
+            m_timeSlot.unitName = "M checks/s";
+            for(int j = 0; j < 10; j++)
+            {
+                std::cout<<"state_check"<<std::endl;
+                uint64_t activeCounter = 0;
+                m_timeSlot.startTimer();
+                for(uint64_t i = 0; i < numberOfChecks; i++)
+                {
+                    if(m_clientSession->isActive()) {
+                        activeCounter++;
+                    }
+                }
+                m_timeSlot.stopTimer();
+
+                assert(activeCounter == numberOfChecks);
+                const double duration = m_timeSlot.getDuration(MICRO_SECONDS);
+                m_timeSlot.values.push_back(static_cast<double>(numberOfChecks) / duration);
+            }
+        }
+
         // create output of the test-result
         addToResult(m_timeSlot);
         printResult();
@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 
 #include <libKitsunemimiCommon/test_helper/speed_test_helper.h>
@@ -32,7 +33,8 @@ public:
     TestSession(const std::string &address,
                 const uint16_t port,
                 const std::string &socket,
-                const std::string &transferType);
+                const std::string &transferType,
+                const bool noReply);
     void runTest(const long packageSize);
     double calculateSpeed(double duration);
 
@@ -41,10 +43,14 @@ public:
     bool m_isClient = false;
     bool m_isTcp = false;
     std::string m_transferType = "";
+    bool m_noReply = false;
+    std::string m_address = "";
+    uint16_t m_port = 0;
 
     uint64_t m_size = 0;
     uint64_t m_totalSize = 0;
     uint64_t m_sizeCounter = 0;
+    std::atomic<uint64_t> m_requestCounter{0};
     uint8_t* m_dataBuffer = nullptr;
     Kitsunemimi::StackBuffer* m_stackBuffer = nullptr;
 
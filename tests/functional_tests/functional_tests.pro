@@ -29,7 +29,12 @@ LIBS +=  -lboost_filesystem -lboost_system
 
 SOURCES += \
     main.cpp \
-    session_test.cpp
+    request_test.cpp \
+    session_test.cpp \
+    transfer_test.cpp
 
 HEADERS += \
-    session_test.h
+    cert_init.h \
+    request_test.h \
+    session_test.h \
+    transfer_test.h
@@ -23,6 +23,8 @@
 #include <libKitsunemimiPersistence/logger/logger.h>
 
 #include <session_test.h>
+#include <transfer_test.h>
+#include <request_test.h>
 
 using Kitsunemimi::Persistence::initConsoleLogger;
 
@@ -32,4 +34,6 @@ int main()
     initConsoleLogger(true);
 
     Kitsunemimi::Sakura::Session_Test();
+    Kitsunemimi::Sakura::Transfer_Test();
+    Kitsunemimi::Sakura::Request_Test();
 }
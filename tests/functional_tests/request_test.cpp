@@ -0,0 +1,322 @@
+/**
+ * @file       request_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "request_test.h"
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::Request_Test* Request_Test::m_instance = nullptr;
+
+/**
+ * @brief wait until the other side has cancelled the request
+ */
+void waitForCancel(Session* session,
+                   const uint64_t blockerId)
+{
+    for(uint32_t i = 0; i < 500; i++)
+    {
+        if(session->isRequestCancelled(blockerId))
+        {
+            Request_Test::m_instance->m_cancelDetected = true;
+            break;
+        }
+        usleep(10000);
+    }
+}
+
+/**
+ * @brief requestStandaloneCallback
+ */
+void requestStandaloneCallback(Session* session,
+                               const uint64_t blockerId,
+                               DataBuffer* data)
+{
+    const std::string receivedMessage(static_cast<const char*>(data->data),
+                                      data->bufferPosition);
+
+    // the request is never answered. The waiting happens in another thread, because the
+    // cancel-message is processed by the thread of the socket.
+    if(receivedMessage == Request_Test::m_instance->m_cancelMessage)
+    {
+        Request_Test::m_instance->m_cancelThread = std::thread(&waitForCancel,
+                                                               session,
+                                                               blockerId);
+        delete data;
+        return;
+    }
+
+    // request, which needs some time for the response
+    if(receivedMessage == Request_Test::m_instance->m_slowMessage) {
+        usleep(50000);
+    }
+
+    session->sendResponse(data->data, data->bufferPosition, blockerId);
+    delete data;
+}
+
+/**
+ * @brief remote procedure, which sends the request back as response
+ */
+void rpcEchoCallback(Session* session,
+                     const uint64_t blockerId,
+                     DataBuffer* data)
+{
+    session->sendResponse(data->data, data->bufferPosition, blockerId);
+    delete data;
+}
+
+/**
+ * @brief requestErrorCallback
+ */
+void requestErrorCallback(Kitsunemimi::Sakura::Session*,
+                          const uint8_t errorCode,
+                          const std::string)
+{
+    if(errorCode == Session::errorCodes::REQUEST_OVERLOADED) {
+        Request_Test::m_instance->m_numberOfOverloads++;
+    }
+    if(errorCode == Session::errorCodes::UNKNOWN_METHOD) {
+        Request_Test::m_instance->m_numberOfUnknownMethods++;
+    }
+}
+
+/**
+ * @brief requestCreateCallback
+ */
+void requestCreateCallback(Kitsunemimi::Sakura::Session* session,
+                           const std::string)
+{
+    session->setStandaloneMessageCallback(&requestStandaloneCallback);
+}
+
+/**
+ * @brief requestCloseCallback
+ */
+void requestCloseCallback(Kitsunemimi::Sakura::Session*,
+                          const std::string)
+{
+}
+
+/**
+ * @brief Request_Test::Request_Test
+ */
+Request_Test::Request_Test() :
+    Kitsunemimi::CompareTestHelper("Request_Test")
+{
+    Request_Test::m_instance = this;
+
+    initTestCase();
+    runTest();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+Request_Test::initTestCase()
+{
+    m_requestMessage = "poi-request";
+    m_cancelMessage = "poi-cancel";
+    m_slowMessage = "poi-slow";
+}
+
+/**
+ * @brief runTest
+ */
+void
+Request_Test::runTest()
+{
+    SessionController* controller = new SessionController(&requestCreateCallback,
+                                                          &requestCloseCallback,
+                                                          &requestErrorCallback);
+
+    TEST_EQUAL(controller->addTcpServer(1235), 1);
+    Session* session = controller->startTcpSession("127.0.0.1", 1235, "request");
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete controller;
+        return;
+    }
+
+    batchTest(session);
+    cancelTest(session);
+    schedulerTest(controller, session);
+    rpcTest(controller, session);
+
+    TEST_EQUAL(session->closeSession(), true);
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief send a batch of requests and wait for all responses together
+ */
+void
+Request_Test::batchTest(Session* session)
+{
+    std::vector<Session::RequestItem> batch(3);
+    for(Session::RequestItem &item : batch)
+    {
+        item.data = m_requestMessage.c_str();
+        item.size = m_requestMessage.size();
+    }
+
+    TEST_EQUAL(session->sendRequests(batch), 3);
+
+    for(Session::RequestItem &item : batch)
+    {
+        TEST_EQUAL(item.state, Session::REQUEST_SUCCESSFUL);
+        if(item.response != nullptr)
+        {
+            std::string responseMessage(static_cast<const char*>(item.response->data),
+                                        item.response->bufferPosition);
+            TEST_EQUAL(responseMessage, m_requestMessage);
+            delete item.response;
+        }
+    }
+}
+
+/**
+ * @brief let a request run into its timeout, which cancels it on the other side
+ */
+void
+Request_Test::cancelTest(Session* session)
+{
+    DataBuffer* response = session->sendRequest(m_cancelMessage.c_str(),
+                                                m_cancelMessage.size(),
+                                                1);
+    const bool isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, true);
+
+    if(m_cancelThread.joinable()) {
+        m_cancelThread.join();
+    }
+    TEST_EQUAL(m_cancelDetected.load(), true);
+}
+
+/**
+ * @brief process requests by the request-scheduler and reject requests, which don't fit into
+ *        the queue
+ */
+void
+Request_Test::schedulerTest(SessionController* controller,
+                            Session* session)
+{
+    TEST_EQUAL(controller->setRequestLimits(1, 0, 0), false);
+    TEST_EQUAL(controller->setRequestLimits(1, 0, 2), true);
+
+    // with one worker and two queue-slots, the other requests of the batch are rejected
+    std::vector<Session::RequestItem> batch(8);
+    for(Session::RequestItem &item : batch)
+    {
+        item.data = m_slowMessage.c_str();
+        item.size = m_slowMessage.size();
+    }
+
+    const uint64_t numberOfSuccessful = session->sendRequests(batch, 5);
+
+    uint64_t numberOfRejected = 0;
+    for(Session::RequestItem &item : batch)
+    {
+        if(item.state == Session::REQUEST_REJECTED) {
+            numberOfRejected++;
+        }
+        delete item.response;
+    }
+
+    const bool hasSuccessful = numberOfSuccessful > 0;
+    const bool hasRejected = numberOfRejected > 0;
+    TEST_EQUAL(hasSuccessful, true);
+    TEST_EQUAL(hasRejected, true);
+    TEST_EQUAL(numberOfSuccessful + numberOfRejected, 8);
+    usleep(10000);
+    TEST_EQUAL(m_numberOfOverloads.load(), numberOfRejected);
+
+    TEST_EQUAL(controller->setRequestLimits(0, 0, 0), true);
+}
+
+/**
+ * @brief register remote procedures, dispatch requests to them, also over a channel, reject
+ *        unknown methods and check the metrics
+ */
+void
+Request_Test::rpcTest(SessionController* controller,
+                      Session* session)
+{
+    TEST_EQUAL(controller->registerRpcMethod(1, &rpcEchoCallback), true);
+    TEST_EQUAL(controller->registerRpcMethod(1, &rpcEchoCallback), false);
+    TEST_EQUAL(controller->registerRpcMethod(0, &rpcEchoCallback), false);
+
+    // dispatch
+    DataBuffer* response = session->sendRpcRequest(1,
+                                                   m_requestMessage.c_str(),
+                                                   m_requestMessage.size());
+    bool isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        std::string responseMessage(static_cast<const char*>(response->data),
+                                    response->bufferPosition);
+        TEST_EQUAL(responseMessage, m_requestMessage);
+        delete response;
+    }
+
+    // dispatch over a channel, which shares the connection of the session
+    Session* channel = session->openChannel("channel");
+    isNullptr = channel == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        response = channel->sendRpcRequest(1, m_requestMessage.c_str(), m_requestMessage.size());
+        isNullptr = response == nullptr;
+        TEST_EQUAL(isNullptr, false);
+        delete response;
+    }
+
+    // unknown method is rejected instead of a timeout
+    response = session->sendRpcRequest(42, m_requestMessage.c_str(), m_requestMessage.size());
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, true);
+    usleep(10000);
+    TEST_EQUAL(m_numberOfUnknownMethods.load(), 1);
+
+    // metrics
+    SessionController::RpcMetrics metrics;
+    TEST_EQUAL(controller->getRpcMetrics(1, metrics), true);
+    TEST_EQUAL(metrics.numberOfCalls, 2);
+    TEST_EQUAL(metrics.receivedBytes, 2 * m_requestMessage.size());
+    TEST_EQUAL(controller->getRpcMetrics(42, metrics), false);
+
+    // unregister
+    TEST_EQUAL(controller->unregisterRpcMethod(42), false);
+    TEST_EQUAL(controller->unregisterRpcMethod(1), true);
+    TEST_EQUAL(controller->getRpcMetrics(1, metrics), false);
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
@@ -0,0 +1,77 @@
+/**
+ * @file       request_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef REQUEST_TEST_H
+#define REQUEST_TEST_H
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <libKitsunemimiPersistence/logger/logger.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <handler/session_handler.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+class Request_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    Request_Test();
+
+    void initTestCase();
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static Request_Test* m_instance;
+
+    std::string m_requestMessage = "";
+    std::string m_cancelMessage = "";
+    std::string m_slowMessage = "";
+
+    std::thread m_cancelThread;
+    std::atomic<bool> m_cancelDetected{false};
+    std::atomic<uint32_t> m_numberOfOverloads{0};
+    std::atomic<uint32_t> m_numberOfUnknownMethods{0};
+
+private:
+    void batchTest(Session* session);
+    void cancelTest(Session* session);
+    void schedulerTest(SessionController* controller, Session* session);
+    void rpcTest(SessionController* controller, Session* session);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // REQUEST_TEST_H
@@ -109,7 +109,7 @@ void sessionCreateCallback(Kitsunemimi::Sakura::Session* session,
     session->setStreamMessageCallback(&streamDataCallback);
     session->setStandaloneMessageCallback(&standaloneDataCallback);
 
-    Session_Test::m_instance->compare(session->sessionId(), (uint32_t)131073);
+    Session_Test::m_instance->compare(session->sessionId(), (uint32_t)2);
     Session_Test::m_instance->m_numberOfInitSessions++;
     Session_Test::m_instance->compare(sessionIdentifier, std::string("test"));
 
@@ -237,8 +237,8 @@ Session_Test::runTest()
     bool isNullptr = m_controller->startTcpSession("127.0.0.1", 1234, "test") == nullptr;
     TEST_EQUAL(isNullptr, false);
 
-    TEST_EQUAL(m_controller->getSession(131073)->closeSession(), true);
-    const bool isNull = m_controller->getSession(131073) == nullptr;
+    TEST_EQUAL(m_controller->getSession(2)->closeSession(), true);
+    const bool isNull = m_controller->getSession(2) == nullptr;
     TEST_EQUAL(isNull, true);
 
     usleep(100000);
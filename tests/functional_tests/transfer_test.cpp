@@ -0,0 +1,555 @@
+/**
+ * @file       transfer_test.cpp
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "transfer_test.h"
+#include "cert_init.h"
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+Kitsunemimi::Sakura::Transfer_Test* Transfer_Test::m_instance = nullptr;
+
+/**
+ * @brief transferStreamCallback
+ */
+void transferStreamCallback(Session* session,
+                            const void* data,
+                            const uint64_t dataSize)
+{
+    const std::string receivedMessage(static_cast<const char*>(data), dataSize);
+    Transfer_Test::m_instance->addReceivedMessage(session, receivedMessage);
+}
+
+/**
+ * @brief transferStandaloneCallback
+ */
+void transferStandaloneCallback(Session* session,
+                                const uint64_t blockerId,
+                                DataBuffer* data)
+{
+    const std::string receivedMessage(static_cast<const char*>(data->data),
+                                      data->bufferPosition);
+
+    // requests are answered with their own content
+    if(receivedMessage == Transfer_Test::m_instance->m_requestMessage)
+    {
+        session->sendResponse(data->data, data->bufferPosition, blockerId);
+        delete data;
+        return;
+    }
+
+    Transfer_Test::m_instance->addReceivedMessage(session, receivedMessage);
+    delete data;
+}
+
+/**
+ * @brief transferPublishCallback
+ */
+void transferPublishCallback(Session* session,
+                             const std::string topic,
+                             const void* data,
+                             const uint64_t dataSize)
+{
+    const std::string receivedMessage(static_cast<const char*>(data), dataSize);
+
+    Transfer_Test::m_instance->compare(topic, std::string("test-topic"));
+    Transfer_Test::m_instance->addReceivedMessage(session, receivedMessage);
+}
+
+/**
+ * @brief transferErrorCallback
+ */
+void transferErrorCallback(Kitsunemimi::Sakura::Session*,
+                           const uint8_t,
+                           const std::string message)
+{
+    std::cout<<"ERROR: "<<message<<std::endl;
+}
+
+/**
+ * @brief transferCreateCallback
+ */
+void transferCreateCallback(Kitsunemimi::Sakura::Session* session,
+                            const std::string sessionIdentifier)
+{
+    session->setStreamMessageCallback(&transferStreamCallback);
+    session->setStandaloneMessageCallback(&transferStandaloneCallback);
+    session->setPublishMessageCallback(&transferPublishCallback);
+
+    if(session->isClientSide() == false) {
+        Transfer_Test::m_instance->addServerSession(sessionIdentifier, session);
+    }
+}
+
+/**
+ * @brief transferCloseCallback
+ */
+void transferCloseCallback(Kitsunemimi::Sakura::Session*,
+                           const std::string)
+{
+}
+
+/**
+ * @brief Transfer_Test::Transfer_Test
+ */
+Transfer_Test::Transfer_Test() :
+    Kitsunemimi::CompareTestHelper("Transfer_Test")
+{
+    Transfer_Test::m_instance = this;
+
+    initTestCase();
+    runTest();
+}
+
+/**
+ * @brief initTestCase
+ */
+void
+Transfer_Test::initTestCase()
+{
+    m_certFile = "/tmp/sakura_test_cert.pem";
+    m_keyFile = "/tmp/sakura_test_key.pem";
+    writeTestCerts(m_certFile, m_keyFile);
+
+    m_streamMessage = "poi-stream";
+    m_topicMessage = "poi-topic";
+    m_requestMessage = "poi-request";
+
+    // larger than a single-block-message, so it is split into multiple parts
+    for(uint32_t i = 0; i < 512*1024; i++) {
+        m_multiBlockMessage.push_back(static_cast<char>('a' + (i % 26)));
+    }
+}
+
+/**
+ * @brief runTest
+ */
+void
+Transfer_Test::runTest()
+{
+    SessionController* controller = new SessionController(&transferCreateCallback,
+                                                          &transferCloseCallback,
+                                                          &transferErrorCallback);
+
+    TEST_EQUAL(controller->addTlsTcpServer(1237, m_certFile, m_keyFile), 1);
+    TEST_EQUAL(controller->addTcpServer(1236), 2);
+
+    stripeTest(controller);
+    linkGroupTest(controller);
+    broadcastTest(controller);
+    publishTest(controller);
+    channelTest(controller);
+    earlyDataTest(controller);
+    sessionPoolTest(controller);
+
+    usleep(100000);
+
+    delete controller;
+}
+
+/**
+ * @brief register the server-side session of a new connection
+ */
+void
+Transfer_Test::addServerSession(const std::string &identifier,
+                                Session* session)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_serverSessions[identifier] = session;
+}
+
+/**
+ * @brief store an incoming message of a session
+ */
+void
+Transfer_Test::addReceivedMessage(Session* session,
+                                  const std::string &message)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_receivedMessages[session].push_back(message);
+}
+
+/**
+ * @brief wait until the server-side session with the given identifier was created
+ *
+ * @return server-side session or nullptr, if not created within one second
+ */
+Session*
+Transfer_Test::waitForServerSession(const std::string &identifier)
+{
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            std::map<std::string, Session*>::const_iterator it;
+            it = m_serverSessions.find(identifier);
+            if(it != m_serverSessions.end()) {
+                return it->second;
+            }
+        }
+        usleep(10000);
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief wait until a session has received a number of messages
+ *
+ * @return false, if the messages were not received within one second, else true
+ */
+bool
+Transfer_Test::waitForMessages(Session* session,
+                               const uint32_t numberOfMessages)
+{
+    for(uint32_t i = 0; i < 100; i++)
+    {
+        if(getReceivedMessages(session).size() >= numberOfMessages) {
+            return true;
+        }
+        usleep(10000);
+    }
+
+    return false;
+}
+
+/**
+ * @brief get all messages, which were received by a session
+ */
+std::vector<std::string>
+Transfer_Test::getReceivedMessages(Session* session)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_receivedMessages[session];
+}
+
+/**
+ * @brief send a multi-block-message, whose parts are distributed over the stripes of a
+ *        tls-session, and check that it is complete on the other side
+ */
+void
+Transfer_Test::stripeTest(SessionController* controller)
+{
+    Session* session = controller->startTlsTcpSession("127.0.0.1",
+                                                      1237,
+                                                      m_certFile,
+                                                      m_keyFile,
+                                                      "stripes",
+                                                      false,
+                                                      2);
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    Session* serverSession = waitForServerSession("stripes");
+    isNullptr = serverSession == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    const bool isSend = session->sendStandaloneData(m_multiBlockMessage.c_str(),
+                                                    m_multiBlockMessage.size()) != 0;
+    TEST_EQUAL(isSend, true);
+    TEST_EQUAL(waitForMessages(serverSession, 1), true);
+
+    const std::vector<std::string> messages = getReceivedMessages(serverSession);
+    TEST_EQUAL(messages.size(), 1);
+    if(messages.size() == 1)
+    {
+        const bool isEqual = messages.at(0) == m_multiBlockMessage;
+        TEST_EQUAL(isEqual, true);
+    }
+}
+
+/**
+ * @brief forward the messages of one session to all sessions of its link-group
+ */
+void
+Transfer_Test::linkGroupTest(SessionController* controller)
+{
+    Session* source = controller->startTcpSession("127.0.0.1", 1236, "source");
+    Session* target1 = controller->startTcpSession("127.0.0.1", 1236, "target1");
+    Session* target2 = controller->startTcpSession("127.0.0.1", 1236, "target2");
+    bool isNullptr = source == nullptr || target1 == nullptr || target2 == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    Session* serverSource = waitForServerSession("source");
+    Session* serverTarget1 = waitForServerSession("target1");
+    Session* serverTarget2 = waitForServerSession("target2");
+    isNullptr = serverSource == nullptr || serverTarget1 == nullptr || serverTarget2 == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    // the messages, which arrive at the server-side of the source, are forwarded to the
+    // client-sides of the targets
+    TEST_EQUAL(controller->addToLinkGroup(serverSource, serverTarget1), true);
+    TEST_EQUAL(controller->addToLinkGroup(serverSource, serverTarget2), true);
+    TEST_EQUAL(controller->addToLinkGroup(serverSource, serverTarget2), false);
+    TEST_EQUAL(controller->addToLinkGroup(serverSource, serverSource), false);
+    TEST_EQUAL(serverSource->getLinkGroup().size(), 2);
+
+    TEST_EQUAL(source->sendStreamData(m_streamMessage.c_str(), m_streamMessage.size()), true);
+    TEST_EQUAL(waitForMessages(target1, 1), true);
+    TEST_EQUAL(waitForMessages(target2, 1), true);
+    TEST_EQUAL(getReceivedMessages(serverSource).size(), 0);
+
+    const std::vector<std::string> messages = getReceivedMessages(target2);
+    if(messages.size() == 1) {
+        TEST_EQUAL(messages.at(0), m_streamMessage);
+    }
+
+    // removed targets don't get the following messages
+    TEST_EQUAL(controller->removeFromLinkGroup(serverSource, serverTarget2), true);
+    TEST_EQUAL(controller->removeFromLinkGroup(serverSource, serverTarget2), false);
+
+    TEST_EQUAL(source->sendStreamData(m_streamMessage.c_str(), m_streamMessage.size()), true);
+    TEST_EQUAL(waitForMessages(target1, 2), true);
+    TEST_EQUAL(getReceivedMessages(target2).size(), 1);
+
+    TEST_EQUAL(controller->removeFromLinkGroup(serverSource, serverTarget1), true);
+    TEST_EQUAL(serverSource->getLinkGroup().size(), 0);
+}
+
+/**
+ * @brief send the same stream- and standalone-message to multiple sessions
+ */
+void
+Transfer_Test::broadcastTest(SessionController* controller)
+{
+    Session* session1 = controller->startTcpSession("127.0.0.1", 1236, "broadcast1");
+    Session* session2 = controller->startTcpSession("127.0.0.1", 1236, "broadcast2");
+    bool isNullptr = session1 == nullptr || session2 == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    const std::vector<Session*> sessions = {session1, session2};
+    TEST_EQUAL(controller->broadcast(sessions,
+                                     m_streamMessage.c_str(),
+                                     m_streamMessage.size(),
+                                     SessionController::STREAM_BROADCAST), 2);
+    TEST_EQUAL(controller->broadcast(sessions,
+                                     m_streamMessage.c_str(),
+                                     m_streamMessage.size(),
+                                     SessionController::STANDALONE_BROADCAST), 2);
+
+    Session* serverSession1 = waitForServerSession("broadcast1");
+    Session* serverSession2 = waitForServerSession("broadcast2");
+    isNullptr = serverSession1 == nullptr || serverSession2 == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    TEST_EQUAL(waitForMessages(serverSession1, 2), true);
+    TEST_EQUAL(waitForMessages(serverSession2, 2), true);
+
+    for(const std::string &message : getReceivedMessages(serverSession1)) {
+        TEST_EQUAL(message, m_streamMessage);
+    }
+    for(const std::string &message : getReceivedMessages(serverSession2)) {
+        TEST_EQUAL(message, m_streamMessage);
+    }
+}
+
+/**
+ * @brief subscribe to a topic and publish to the subscriber
+ */
+void
+Transfer_Test::publishTest(SessionController* controller)
+{
+    Session* session = controller->startTcpSession("127.0.0.1", 1236, "subscriber");
+    const bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    TEST_EQUAL(session->subscribe("test-topic"), true);
+    usleep(100000);
+
+    TEST_EQUAL(controller->publish("test-topic", m_topicMessage.c_str(), m_topicMessage.size()), 1);
+    TEST_EQUAL(waitForMessages(session, 1), true);
+
+    const std::vector<std::string> messages = getReceivedMessages(session);
+    if(messages.size() == 1) {
+        TEST_EQUAL(messages.at(0), m_topicMessage);
+    }
+
+    TEST_EQUAL(session->unsubscribe("test-topic"), true);
+    usleep(100000);
+    TEST_EQUAL(controller->publish("test-topic", m_topicMessage.c_str(), m_topicMessage.size()), 0);
+}
+
+/**
+ * @brief send messages over a channel and its parent-session, which share the same connection
+ */
+void
+Transfer_Test::channelTest(SessionController* controller)
+{
+    Session* session = controller->startTcpSession("127.0.0.1", 1236, "parent");
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    Session* channel = session->openChannel("channel");
+    isNullptr = channel == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    TEST_EQUAL(channel->isChannel(), true);
+    TEST_EQUAL(session->isChannel(), false);
+
+    Session* serverSession = waitForServerSession("parent");
+    Session* serverChannel = waitForServerSession("channel");
+    isNullptr = serverSession == nullptr || serverChannel == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    TEST_EQUAL(serverChannel->isChannel(), true);
+
+    // the messages are demultiplexed by their session-id on the other side
+    TEST_EQUAL(channel->sendStreamData(m_streamMessage.c_str(), m_streamMessage.size()), true);
+    TEST_EQUAL(waitForMessages(serverChannel, 1), true);
+    TEST_EQUAL(getReceivedMessages(serverSession).size(), 0);
+
+    TEST_EQUAL(session->sendStreamData(m_streamMessage.c_str(), m_streamMessage.size()), true);
+    TEST_EQUAL(waitForMessages(serverSession, 1), true);
+    TEST_EQUAL(getReceivedMessages(serverChannel).size(), 1);
+}
+
+/**
+ * @brief send the first request and the first stream-message together with the init-message
+ *        of new sessions
+ */
+void
+Transfer_Test::earlyDataTest(SessionController* controller)
+{
+    DataBuffer* response = nullptr;
+    Session* session = controller->startTcpSessionWithRequest("127.0.0.1",
+                                                              1236,
+                                                              m_requestMessage.c_str(),
+                                                              m_requestMessage.size(),
+                                                              response,
+                                                              "early-request");
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        std::string responseMessage(static_cast<const char*>(response->data),
+                                    response->bufferPosition);
+        TEST_EQUAL(responseMessage, m_requestMessage);
+        delete response;
+    }
+
+    session = controller->startTcpSessionWithStream("127.0.0.1",
+                                                    1236,
+                                                    m_streamMessage.c_str(),
+                                                    m_streamMessage.size(),
+                                                    "early-stream");
+    isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+
+    Session* serverSession = waitForServerSession("early-stream");
+    isNullptr = serverSession == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr) {
+        return;
+    }
+
+    TEST_EQUAL(waitForMessages(serverSession, 1), true);
+    const std::vector<std::string> messages = getReceivedMessages(serverSession);
+    if(messages.size() == 1) {
+        TEST_EQUAL(messages.at(0), m_streamMessage);
+    }
+}
+
+/**
+ * @brief lease a session of the session-pool for a request and give it back
+ */
+void
+Transfer_Test::sessionPoolTest(SessionController* controller)
+{
+    SessionPool* pool = new SessionPool(controller, 1, 4);
+
+    TEST_EQUAL(pool->addEndpoint("127.0.0.1", 1236, "pool"), true);
+    TEST_EQUAL(pool->addEndpoint("127.0.0.1", 1236, "pool"), false);
+
+    Session* session = pool->lease("127.0.0.1", 1236);
+    bool isNullptr = session == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr)
+    {
+        delete pool;
+        return;
+    }
+    TEST_EQUAL(pool->numberOfLeasedSessions("127.0.0.1", 1236), 1);
+
+    DataBuffer* response = session->sendRequest(m_requestMessage.c_str(),
+                                                m_requestMessage.size(),
+                                                10);
+    isNullptr = response == nullptr;
+    TEST_EQUAL(isNullptr, false);
+    if(isNullptr == false)
+    {
+        std::string responseMessage(static_cast<const char*>(response->data),
+                                    response->bufferPosition);
+        TEST_EQUAL(responseMessage, m_requestMessage);
+        delete response;
+    }
+
+    // the released session is kept warm for the next lease
+    TEST_EQUAL(pool->release(session), true);
+    TEST_EQUAL(pool->release(session), false);
+    TEST_EQUAL(pool->numberOfLeasedSessions("127.0.0.1", 1236), 0);
+    const bool hasIdleSessions = pool->numberOfIdleSessions("127.0.0.1", 1236) > 0;
+    TEST_EQUAL(hasIdleSessions, true);
+
+    TEST_EQUAL(pool->removeEndpoint("127.0.0.1", 1236), true);
+    isNullptr = pool->lease("127.0.0.1", 1236, 100) == nullptr;
+    TEST_EQUAL(isNullptr, true);
+
+    delete pool;
+}
+
+} // namespace Sakura
+} // namespace Kitsunemimi
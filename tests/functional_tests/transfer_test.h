@@ -0,0 +1,91 @@
+/**
+ * @file       transfer_test.h
+ *
+ * @author     Tobias Anker <tobias.anker@kitsunemimi.moe>
+ *
+ * @copyright  Apache License Version 2.0
+ *
+ *      Copyright 2019 Tobias Anker
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#ifndef TRANSFER_TEST_H
+#define TRANSFER_TEST_H
+
+#include <iostream>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <libKitsunemimiPersistence/logger/logger.h>
+#include <libKitsunemimiSakuraNetwork/session_controller.h>
+#include <libKitsunemimiSakuraNetwork/session_pool.h>
+#include <handler/session_handler.h>
+#include <libKitsunemimiSakuraNetwork/session.h>
+
+#include <libKitsunemimiCommon/test_helper/compare_test_helper.h>
+
+namespace Kitsunemimi
+{
+namespace Sakura
+{
+
+class Transfer_Test
+        : public Kitsunemimi::CompareTestHelper
+{
+public:
+    Transfer_Test();
+
+    void initTestCase();
+    void runTest();
+
+    template<typename  T>
+    void compare(T isValue, T shouldValue)
+    {
+        TEST_EQUAL(isValue, shouldValue);
+    }
+
+    static Transfer_Test* m_instance;
+
+    std::string m_certFile = "";
+    std::string m_keyFile = "";
+    std::string m_streamMessage = "";
+    std::string m_multiBlockMessage = "";
+    std::string m_topicMessage = "";
+    std::string m_requestMessage = "";
+
+    void addServerSession(const std::string &identifier, Session* session);
+    void addReceivedMessage(Session* session, const std::string &message);
+
+private:
+    std::mutex m_lock;
+    std::map<std::string, Session*> m_serverSessions;
+    std::map<Session*, std::vector<std::string>> m_receivedMessages;
+
+    Session* waitForServerSession(const std::string &identifier);
+    bool waitForMessages(Session* session, const uint32_t numberOfMessages);
+    std::vector<std::string> getReceivedMessages(Session* session);
+
+    void stripeTest(SessionController* controller);
+    void linkGroupTest(SessionController* controller);
+    void broadcastTest(SessionController* controller);
+    void publishTest(SessionController* controller);
+    void channelTest(SessionController* controller);
+    void earlyDataTest(SessionController* controller);
+    void sessionPoolTest(SessionController* controller);
+};
+
+} // namespace Sakura
+} // namespace Kitsunemimi
+
+#endif // TRANSFER_TEST_H